@@ -1,9 +1,12 @@
 #include <AdvancedADC.h>
+#include <AdvancedCSV.h>
 
 AdvancedADC adc(1, A0, A1); // Use ADC1 with pins A0 and A1
-uint64_t last_millis = 0;
+AdvancedCSV csv(Serial);    // Prints one line of comma-separated values per sample frame
 
 void setup() {
+    // Serial is USB CDC on the Giga, which runs at USB speed whatever the baud
+    // rate; a 9600 baud UART couldn't carry the ~12 KB/s printed below.
     Serial.begin(9600);
 
     // Resolution, sample rate, number of samples per channel, queue depth.
@@ -17,12 +20,9 @@ void setup() {
 void loop() {
     if (adc.available()) {
         SampleBuffer buf = adc.read();
-        // Process the buffer.
-        if ((millis() - last_millis) > 20) {
-            Serial.println(buf[0]); // Sample from first channel
-            Serial.println(buf[1]); // Sample from second channel
-            last_millis = millis();
-        }
+        // Print every 16th sample frame of both channels, 1000 lines per second,
+        // formatted into one string and written at once.
+        csv.print(buf, 16);
         // Release the buffer to return it to the pool.
         buf.release();
     }
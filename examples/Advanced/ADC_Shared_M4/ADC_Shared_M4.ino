@@ -0,0 +1,25 @@
+// Upload to the M4 core (Tools > Target core > Flash split, then select the M4 co-processor).
+// Acquires on ADC1 and publishes every buffer to the M7, see ADC_Shared_M7.
+#include <AdvancedADC.h>
+#include <AdvancedShared.h>
+
+AdvancedADC adc(1, A0, A1); // Use ADC1 with pins A0 and A1
+AdvancedSharedWriter shared;
+
+void setup() {
+    // Resolution, sample rate, number of samples per channel, queue depth.
+    if (!adc.begin(AN_RESOLUTION_16, 16000, 32, 32) || !shared.begin(adc, 32)) {
+        while (1)
+            ;
+    }
+}
+
+void loop() {
+    if (adc.available()) {
+        SampleBuffer buf = adc.read();
+        // Copy the buffer to shared memory; if the M7 falls behind, it's dropped and counted.
+        shared.write(buf);
+        // Release the buffer to return it to the pool.
+        buf.release();
+    }
+}
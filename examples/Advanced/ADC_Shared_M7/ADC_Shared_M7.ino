@@ -0,0 +1,38 @@
+// Upload to the M7 core, and ADC_Shared_M4 to the M4 core.
+// Reads the buffers acquired on the M4, while the ADC interrupts stay off this core.
+#include <AdvancedShared.h>
+#include <RPC.h>
+
+AdvancedSharedADC adc;
+uint64_t last_millis = 0;
+
+void setup() {
+    Serial.begin(9600);
+
+    // Boot the M4 core.
+    RPC.begin();
+
+    // Number of local buffers, and how long to wait for the M4 to start.
+    if (!adc.begin(8, 5000)) {
+        Serial.println("Failed to attach to the M4!");
+        while (1)
+            ;
+    }
+}
+
+void loop() {
+    if (adc.available()) {
+        SampleBuffer buf = adc.read();
+        // Process the buffer.
+        if (millis() - last_millis > 1000) {
+            Serial.print(buf[0]);
+            Serial.print(" ");
+            Serial.print(buf[1]);
+            Serial.print(" dropped: ");
+            Serial.println(adc.dropped());
+            last_millis = millis();
+        }
+        // Release the buffer to return it to the pool.
+        buf.release();
+    }
+}
@@ -0,0 +1,86 @@
+/*
+  Converts the six FSR channels of the ADC1 + ADC3 layout to force using
+  precomputed per-channel tables (one table load per sample).
+
+  - ADC1: LEFT_CENTER, RIGHT_CENTER, RIGHT_BOTTOM
+  - ADC3: LEFT_TOP, RIGHT_TOP, LEFT_BOTTOM
+*/
+
+#include <AdvancedADC.h>
+#include <AdvancedFSR.h>
+
+// FSRs addresses
+#define ANALOG_PORT_FSR_LEFT_TOP PC_2C     // Default Pin A8
+#define ANALOG_PORT_FSR_LEFT_CENTER PA_0   // Default Pin A7
+#define ANALOG_PORT_FSR_LEFT_BOTTOM PC_0   // Default Pin A6
+#define ANALOG_PORT_FSR_RIGHT_TOP PC_3C    // Default Pin A9
+#define ANALOG_PORT_FSR_RIGHT_CENTER PA_1C // Default Pin A10
+#define ANALOG_PORT_FSR_RIGHT_BOTTOM PA_0C // Default Pin A11
+
+AdvancedADC adc1(1, ANALOG_PORT_FSR_LEFT_CENTER, ANALOG_PORT_FSR_RIGHT_CENTER, ANALOG_PORT_FSR_RIGHT_BOTTOM);
+AdvancedADC adc3(3, ANALOG_PORT_FSR_LEFT_TOP, ANALOG_PORT_FSR_RIGHT_TOP, ANALOG_PORT_FSR_LEFT_BOTTOM);
+
+const uint32_t SAMPLE_RATE = 1000;
+const size_t SAMPLES_PER_BUFFER = 50;
+const size_t NUM_BUFFERS = 8;
+
+// Divider reference resistor and conductance model (F = a * G^b, G in uS).
+const float R_REF = 10000.0f;
+const float FSR_A = 0.08f; // Newtons at 1uS, adjust for your sensors.
+const float FSR_B = 1.0f;
+
+// Forces in 0.01N units.
+AdvancedFSR fsr1(3, AN_RESOLUTION_12, 0.01f);
+AdvancedFSR fsr3(3, AN_RESOLUTION_12, 0.01f);
+
+uint16_t force[3 * SAMPLES_PER_BUFFER];
+uint64_t last_millis = 0;
+
+void printForces(const char *name, size_t n) {
+    Serial.print(name);
+    for (size_t ch = 0; ch < 3; ch++) {
+        // Print the last frame of the buffer, in newtons.
+        Serial.print(" ");
+        Serial.print(force[(n - 3) + ch] * fsr1.unit(), 2);
+    }
+    Serial.println();
+}
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) {
+    }
+
+    for (size_t ch = 0; ch < 3; ch++) {
+        fsr1.conductance(ch, R_REF, FSR_A, FSR_B);
+        fsr3.conductance(ch, R_REF, FSR_A, FSR_B);
+    }
+
+    if (!adc1.begin(AN_RESOLUTION_12, SAMPLE_RATE, SAMPLES_PER_BUFFER, NUM_BUFFERS) ||
+        !adc3.begin(AN_RESOLUTION_12, SAMPLE_RATE, SAMPLES_PER_BUFFER, NUM_BUFFERS)) {
+        Serial.println("Failed to start analog acquisition!");
+        while (1)
+            ;
+    }
+}
+
+void loop() {
+    if (adc1.available()) {
+        SampleBuffer buf = adc1.read();
+        size_t n = fsr1.convert(buf, force);
+        buf.release();
+        if (n && (millis() - last_millis) > 200) {
+            printForces("ADC1 N:", n);
+        }
+    }
+
+    if (adc3.available()) {
+        SampleBuffer buf = adc3.read();
+        size_t n = fsr3.convert(buf, force);
+        buf.release();
+        if (n && (millis() - last_millis) > 200) {
+            printForces("ADC3 N:", n);
+            last_millis = millis();
+        }
+    }
+}
@@ -0,0 +1,89 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Prints the description of a capture file and per-channel statistics.
+//
+// Build:  g++ -O2 -std=c++17 -I../../src an_capinfo.cpp ../../src/AdvancedPack.cpp ../../src/AdvancedCodec.cpp -o an_capinfo
+// Usage:  an_capinfo file
+#include <stdio.h>
+#include "an_capture.h"
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s file\n", argv[0]);
+        return 2;
+    }
+    an::CaptureFile cap;
+    if (!cap.open(argv[1])) {
+        fprintf(stderr, "%s: not a capture file\n", argv[1]);
+        return 1;
+    }
+
+    const capture_header_t &h = cap.header();
+    printf("adc:          %u\n", h.adc_id);
+    printf("channels:     %u\n", h.channels);
+    printf("resolution:   %u bits\n", 8 + 2 * h.resolution);
+    printf("encoding:     %u\n", h.encoding);
+    printf("sample rate:  %.3f Hz\n", h.sample_rate);
+    printf("sample time:  %.1f cycles\n", h.sample_time / 2.0);
+    printf("chunks:       %zu%s\n", cap.chunks(), h.index_entries ? "" : " (no index, file not closed)");
+    printf("dropped:      %u\n", h.dropped);
+
+    // Statistics per channel; raw chunks are read in place, others decoded.
+    size_t n_ch = cap.channels();
+    std::vector<uint64_t> sum(n_ch, 0);
+    std::vector<uint16_t> lo(n_ch, 0xFFFF), hi(n_ch, 0);
+    std::vector<uint16_t> tmp;
+    uint64_t frames = 0;
+    for (size_t k = 0; k < cap.chunks(); k++) {
+        const capture_chunk_t *c = cap.chunk(k);
+        if (c == nullptr) {
+            fprintf(stderr, "chunk %zu: corrupt\n", k);
+            return 1;
+        }
+        for (size_t ch = 0; ch < n_ch; ch++) {
+            an::strided_view<uint16_t> v = cap.view(k, ch);
+            if (v.size() == 0) {
+                if (ch == 0) {
+                    tmp.resize(c->n_samples);
+                    if (cap.decode(k, tmp.data()) == 0) {
+                        fprintf(stderr, "chunk %zu: can't decode\n", k);
+                        return 1;
+                    }
+                }
+                v.data = tmp.data() + ch;
+                v.stride = n_ch;
+                v.n = c->n_samples / n_ch;
+            }
+            for (size_t i = 0; i < v.size(); i++) {
+                uint16_t s = v[i];
+                sum[ch] += s;
+                lo[ch] = (s < lo[ch]) ? s : lo[ch];
+                hi[ch] = (s > hi[ch]) ? s : hi[ch];
+            }
+        }
+        frames += c->n_samples / n_ch;
+    }
+    printf("frames:       %llu\n", (unsigned long long)frames);
+    for (size_t ch = 0; ch < n_ch && frames; ch++) {
+        printf("ch%-2zu pin %-5u min %-5u max %-5u mean %.2f\n", ch, h.pins[ch], lo[ch], hi[ch],
+               (double)sum[ch] / frames);
+    }
+    return 0;
+}
@@ -0,0 +1,229 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __AN_CAPTURE_H__
+#define __AN_CAPTURE_H__
+
+// Host-side reader for capture files written by AdvancedLogger, header only.
+// The file is memory-mapped, and raw chunks are exposed as per-channel
+// strided views straight into the mapping, without copying. Decoding packed
+// or compressed chunks with decode() needs AdvancedPack.cpp and
+// AdvancedCodec.cpp to be linked in.
+#include <fcntl.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "AdvancedCapture.h"
+#include "AdvancedPack.h"
+#include "AdvancedCodec.h"
+
+namespace an {
+
+template <typename T> struct strided_view {
+    const T *data = nullptr;
+    size_t stride = 0;
+    size_t n = 0;
+
+    size_t size() const {
+        return n;
+    }
+
+    const T &operator[](size_t i) const {
+        return data[i * stride];
+    }
+};
+
+class CaptureFile {
+  private:
+    const uint8_t *map = nullptr;
+    size_t map_size = 0;
+    const capture_header_t *hdr = nullptr;
+    const capture_index_t *index = nullptr;
+    size_t n_chunks = 0;
+    std::vector<uint64_t> offsets;  // Only used when the file has no index.
+
+    // Returns the offset of the chunk after the one at off, or 0 at the end.
+    uint64_t next(uint64_t off) const {
+        const capture_chunk_t *c = at(off);
+        if (c == nullptr) {
+            return 0;
+        }
+        uint64_t end = off + AN_CAPTURE_CHUNK_SIZE + ((c->payload_bytes + 3) & ~3ULL);
+        return (at(end) != nullptr) ? end : 0;
+    }
+
+    const capture_chunk_t *at(uint64_t off) const {
+        if (off < hdr->header_bytes || off + AN_CAPTURE_CHUNK_SIZE > map_size) {
+            return nullptr;
+        }
+        const capture_chunk_t *c = (const capture_chunk_t *)(map + off);
+        if (c->magic != AN_CAPTURE_CHUNK_MAGIC || off + AN_CAPTURE_CHUNK_SIZE + c->payload_bytes > map_size) {
+            return nullptr;
+        }
+        return c;
+    }
+
+    uint64_t locate(size_t k) const {
+        if (index == nullptr) {
+            return offsets[k];
+        }
+        // Walk from the closest index entry.
+        uint64_t off = index[k / hdr->index_stride].offset;
+        for (size_t i = k % hdr->index_stride; i && off; i--) {
+            off = next(off);
+        }
+        return off;
+    }
+
+  public:
+    CaptureFile() = default;
+    CaptureFile(const CaptureFile &) = delete;
+    CaptureFile &operator=(const CaptureFile &) = delete;
+
+    ~CaptureFile() {
+        close();
+    }
+
+    bool open(const char *path) {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < AN_CAPTURE_HEADER_SIZE) {
+            ::close(fd);
+            return false;
+        }
+        void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            return false;
+        }
+        map = (const uint8_t *)p;
+        map_size = st.st_size;
+        hdr = (const capture_header_t *)map;
+        if (hdr->magic != AN_CAPTURE_MAGIC || hdr->version != AN_CAPTURE_VERSION
+                || hdr->header_bytes < sizeof(capture_header_t) || hdr->channels == 0
+                || hdr->channels > AN_CAPTURE_MAX_CHANNELS) {
+            close();
+            return false;
+        }
+
+        uint64_t index_end = hdr->index_offset + (uint64_t)hdr->index_entries * sizeof(capture_index_t);
+        if (hdr->index_offset && hdr->index_entries && hdr->index_stride && index_end <= map_size
+                && hdr->chunks <= (uint64_t)hdr->index_entries * hdr->index_stride) {
+            index = (const capture_index_t *)(map + hdr->index_offset);
+            n_chunks = hdr->chunks;
+        } else {
+            // Not closed properly: find the chunks by walking them.
+            for (uint64_t off = hdr->header_bytes; at(off) != nullptr; off = next(off)) {
+                offsets.push_back(off);
+            }
+            n_chunks = offsets.size();
+        }
+        return true;
+    }
+
+    void close() {
+        if (map) {
+            munmap((void *)map, map_size);
+        }
+        map = nullptr;
+        map_size = 0;
+        hdr = nullptr;
+        index = nullptr;
+        n_chunks = 0;
+        offsets.clear();
+    }
+
+    const capture_header_t &header() const {
+        return *hdr;
+    }
+
+    size_t channels() const {
+        return hdr->channels;
+    }
+
+    size_t chunks() const {
+        return n_chunks;
+    }
+
+    // Chunk header k, or nullptr if it can't be found.
+    const capture_chunk_t *chunk(size_t k) const {
+        return (k < n_chunks) ? at(locate(k)) : nullptr;
+    }
+
+    const uint8_t *payload(const capture_chunk_t *c) const {
+        return (const uint8_t *)c + AN_CAPTURE_CHUNK_SIZE;
+    }
+
+    // Samples of channel ch in chunk k, in place. Only raw chunks can be
+    // viewed; the view is empty otherwise, or if the chunk's sizes don't
+    // agree, as in decode().
+    strided_view<uint16_t> view(size_t k, size_t ch) const {
+        strided_view<uint16_t> v;
+        const capture_chunk_t *c = chunk(k);
+        if (c && hdr->encoding == AN_FRAME_RAW && ch < hdr->channels
+                && c->payload_bytes == c->n_samples * sizeof(uint16_t) && c->n_samples % hdr->channels == 0) {
+            v.data = (const uint16_t *)payload(c) + ch;
+            v.stride = hdr->channels;
+            v.n = c->n_samples / hdr->channels;
+        }
+        return v;
+    }
+
+    // Decodes chunk k into out, which must hold n_samples samples. Returns the
+    // number of samples, 0 on error.
+    size_t decode(size_t k, uint16_t *out) const {
+        const capture_chunk_t *c = chunk(k);
+        if (c == nullptr) {
+            return 0;
+        }
+        const uint8_t *p = payload(c);
+        switch (hdr->encoding) {
+            case AN_FRAME_RAW:
+                if (c->payload_bytes != c->n_samples * sizeof(uint16_t)) {
+                    return 0;
+                }
+                memcpy(out, p, c->payload_bytes);
+                return c->n_samples;
+            case AN_FRAME_PACKED:
+                if (c->payload_bytes != an_packed_bytes(hdr->resolution, c->n_samples)) {
+                    return 0;
+                }
+                return an_unpack(hdr->resolution, p, 0, c->n_samples, out);
+            case AN_FRAME_RICE:
+                if (c->n_samples % hdr->channels
+                        || an_decode(p, c->payload_bytes, hdr->channels, c->n_samples / hdr->channels, out) != c->payload_bytes) {
+                    return 0;
+                }
+                return c->n_samples;
+        }
+        return 0;
+    }
+};
+
+} // namespace an
+
+#endif // __AN_CAPTURE_H__
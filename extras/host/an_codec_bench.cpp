@@ -0,0 +1,249 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Measures the compression ratio and speed of AdvancedCodec on the host.
+//
+// Build:  g++ -O2 -std=c++17 -I../../src an_codec_bench.cpp ../../src/AdvancedCodec.cpp
+//             ../../src/AdvancedPack.cpp -o an_codec_bench
+// Usage:  an_codec_bench [-r resolution] [-c channels] [-n frames] [-m MHz] [file]
+//
+//   -r  AN_RESOLUTION_x of the test signals, 0 to 4 (default: 2, 12 bits).
+//   -c  Interleaved channels (default: 4).
+//   -n  Frames per buffer (default: 1024).
+//   -m  Host core clock in MHz, to report cycles per sample instead of ns.
+//
+// Each test signal is encoded one buffer at a time, like AN_FRAME_RICE
+// frames. With a capture file (e.g. recorded FSR data from AdvancedLogger),
+// its chunks are used instead, each one as a buffer, with the capture's
+// resolution and channels; raw, packed and compressed captures all work. The
+// ratio is the size of the 16-bit samples over the encoded size. Every buffer
+// is decoded back, checked against the input, and checked to fit in
+// an_codec_max_bytes(); the tool exits with status 1 on a mismatch.
+//
+// Speed is in nanoseconds per sample of host time, or in cycles per sample
+// of the host core with -m (at a fixed clock, so turn off frequency scaling).
+// Only relative numbers carry over to the target, whose core does less per
+// cycle; absolute numbers have to be measured on the board.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include "AdvancedCodec.h"
+#include "an_capture.h"
+
+static const uint8_t RES_BITS[] = {8, 10, 12, 14, 16};
+
+enum {
+    SIG_SILENCE,
+    SIG_SINE,
+    SIG_SINE_NOISE,
+    SIG_STEPS,
+    SIG_NOISE,
+    SIG_COUNT,
+};
+
+static const char *SIG_NAMES[] = {
+    "silence", "sine", "sine + 4 LSB noise", "steps", "full-scale noise",
+};
+
+static uint32_t rnd(uint32_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// Fills n_frames frames of n_ch channels; every channel gets its own phase.
+static void generate(int sig, uint32_t res, size_t n_ch, size_t n_frames, std::vector<uint16_t> &out) {
+    const double max_code = (1UL << RES_BITS[res]) - 1;
+    uint32_t state = 0x9e3779b9;
+    size_t step = 0;
+    out.resize(n_ch * n_frames);
+    for (size_t n = 0; n < n_frames; n++) {
+        if (n % 1000 == 0) {
+            step = rnd(&state) % 8;
+        }
+        for (size_t c = 0; c < n_ch; c++) {
+            double s = sin(2.0 * M_PI * n / 500.0 + c);
+            double v = 0.0;
+            switch (sig) {
+                case SIG_SILENCE: v = max_code / 2.0; break;
+                case SIG_SINE: v = max_code / 2.0 * (1.0 + 0.9 * s); break;
+                case SIG_SINE_NOISE: v = max_code / 2.0 * (1.0 + 0.9 * s) + (int)(rnd(&state) % 9) - 4; break;
+                case SIG_STEPS: v = max_code * (step + c) / 16.0; break;
+                case SIG_NOISE: v = rnd(&state) & (uint32_t)max_code; break;
+            }
+            v = v < 0.0 ? 0.0 : (v > max_code ? max_code : v);
+            out[n * n_ch + c] = (uint16_t)lround(v);
+        }
+    }
+}
+
+// A buffer of a test: n_frames frames, off samples into the interleaved data.
+struct buffer_t {
+    size_t off;
+    size_t n_frames;
+};
+
+// Encodes and decodes every buffer, and prints one line of results. Returns
+// the number of buffers that failed to round-trip.
+static size_t bench(const char *name, const std::vector<uint16_t> &in, size_t n_ch,
+                    const std::vector<buffer_t> &bufs, double mhz) {
+    size_t max_bytes = 0, max_samples = 0, n_samples = 0;
+    for (const buffer_t &b : bufs) {
+        size_t m = an_codec_max_bytes(n_ch, b.n_frames);
+        max_bytes = (m > max_bytes) ? m : max_bytes;
+        max_samples = (b.n_frames * n_ch > max_samples) ? b.n_frames * n_ch : max_samples;
+        n_samples += b.n_frames * n_ch;
+    }
+    const size_t n_buffers = bufs.size();
+    std::vector<uint16_t> out(max_samples);
+    std::vector<uint8_t> enc(n_buffers * max_bytes);
+    std::vector<size_t> len(n_buffers);
+
+    // Encode and decode all buffers until 0.2 s have passed, so the
+    // timings cover the whole signal rather than one buffer in the cache.
+    size_t total = 0, passes = 0;
+    auto start = std::chrono::steady_clock::now();
+    double enc_secs = 0.0;
+    do {
+        total = 0;
+        for (size_t b = 0; b < n_buffers; b++) {
+            len[b] = an_encode(&in[bufs[b].off], n_ch, bufs[b].n_frames, &enc[b * max_bytes]);
+            total += len[b];
+        }
+        passes++;
+        enc_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (enc_secs < 0.2);
+    double enc_ns = enc_secs * 1e9 / (passes * n_samples);
+
+    size_t bad = 0;
+    for (size_t b = 0; b < n_buffers; b++) {
+        size_t n = bufs[b].n_frames * n_ch;
+        if (len[b] > an_codec_max_bytes(n_ch, bufs[b].n_frames)
+                || an_decode(&enc[b * max_bytes], len[b], n_ch, bufs[b].n_frames, out.data()) != len[b]
+                || memcmp(out.data(), &in[bufs[b].off], n * sizeof(uint16_t))) {
+            bad++;
+        }
+    }
+
+    passes = 0;
+    start = std::chrono::steady_clock::now();
+    double dec_secs = 0.0;
+    do {
+        for (size_t b = 0; b < n_buffers; b++) {
+            an_decode(&enc[b * max_bytes], len[b], n_ch, bufs[b].n_frames, out.data());
+        }
+        passes++;
+        dec_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (dec_secs < 0.2);
+    double dec_ns = dec_secs * 1e9 / (passes * n_samples);
+
+    if (bad) {
+        printf("%-20s %zu of %zu buffers failed to round-trip\n", name, bad, n_buffers);
+        return bad;
+    }
+    // ns times MHz / 1000 is cycles.
+    double scale = (mhz > 0.0) ? mhz / 1000.0 : 1.0;
+    printf("%-20s %8.2f %16.2f %16.2f\n", name, (double)(n_samples * sizeof(uint16_t)) / total,
+           enc_ns * scale, dec_ns * scale);
+    return 0;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-r resolution] [-c channels] [-n frames] [-m MHz] [file]\n", name);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    uint32_t res = 2;
+    size_t n_ch = 4;
+    size_t n_frames = 1024;
+    double mhz = 0.0;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:c:n:m:")) != -1) {
+        switch (opt) {
+            case 'r': res = strtoul(optarg, nullptr, 0); break;
+            case 'c': n_ch = strtoul(optarg, nullptr, 0); break;
+            case 'n': n_frames = strtoul(optarg, nullptr, 0); break;
+            case 'm': mhz = strtod(optarg, nullptr); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (res >= sizeof(RES_BITS) || n_ch == 0 || n_frames == 0 || mhz < 0.0 || optind + 1 < argc) {
+        usage(argv[0]);
+    }
+    const char *unit = (mhz > 0.0) ? "cycles/sample" : "ns/sample";
+
+    if (optind < argc) {
+        an::CaptureFile cap;
+        if (!cap.open(argv[optind])) {
+            fprintf(stderr, "%s: not a capture file\n", argv[optind]);
+            return 1;
+        }
+        const capture_header_t &h = cap.header();
+        std::vector<uint16_t> in;
+        std::vector<buffer_t> bufs;
+        for (size_t k = 0; k < cap.chunks(); k++) {
+            const capture_chunk_t *c = cap.chunk(k);
+            if (c == nullptr || c->n_samples % h.channels) {
+                fprintf(stderr, "%s: chunk %zu is corrupt\n", argv[optind], k);
+                return 1;
+            }
+            size_t off = in.size();
+            in.resize(off + c->n_samples);
+            if (c->n_samples && cap.decode(k, &in[off]) != c->n_samples) {
+                fprintf(stderr, "%s: chunk %zu is corrupt\n", argv[optind], k);
+                return 1;
+            }
+            if (c->n_samples) {
+                bufs.push_back({off, c->n_samples / h.channels});
+            }
+        }
+        if (bufs.empty()) {
+            fprintf(stderr, "%s: no samples\n", argv[optind]);
+            return 1;
+        }
+        printf("resolution %u bits, %u channels, %zu chunks, %zu samples\n",
+               (h.resolution < sizeof(RES_BITS)) ? RES_BITS[h.resolution] : 16, h.channels, bufs.size(), in.size());
+        printf("%-20s %8s %16s %16s\n", "signal", "ratio", "encode", "decode");
+        printf("%-20s %8s %16s %16s\n", "", "", unit, unit);
+        const char *base = strrchr(argv[optind], '/');
+        return bench(base ? base + 1 : argv[optind], in, h.channels, bufs, mhz) ? 1 : 0;
+    }
+
+    const size_t n_buffers = 64;
+    std::vector<buffer_t> bufs;
+    for (size_t b = 0; b < n_buffers; b++) {
+        bufs.push_back({b * n_ch * n_frames, n_frames});
+    }
+    size_t errors = 0;
+    printf("resolution %u bits, %zu channels, %zu frames per buffer\n", RES_BITS[res], n_ch, n_frames);
+    printf("%-20s %8s %16s %16s\n", "signal", "ratio", "encode", "decode");
+    printf("%-20s %8s %16s %16s\n", "", "", unit, unit);
+    for (int sig = 0; sig < SIG_COUNT; sig++) {
+        std::vector<uint16_t> in;
+        generate(sig, res, n_ch, n_frames * n_buffers, in);
+        errors += bench(SIG_NAMES[sig], in, n_ch, bufs, mhz);
+    }
+    return errors ? 1 : 0;
+}
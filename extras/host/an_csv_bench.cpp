@@ -0,0 +1,169 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Compares AdvancedCSV with the print() per value pattern it replaces, and
+// checks that both produce the same text.
+//
+// Build:  g++ -O2 -std=c++17 -I../../src an_csv_bench.cpp ../../src/AdvancedCSV.cpp -o an_csv_bench
+// Usage:  an_csv_bench [-c channels] [-n frames]
+//
+//   -c  Channels per frame (default: 2).
+//   -n  Sample frames per buffer (default: 32).
+//
+// The per-value path does what a sketch calling Serial.print(value),
+// Serial.print(',') and Serial.println() does through Arduino's Print: one
+// digit per division into a small buffer, and one write() per value, per
+// separator and per line ending. Both paths write into a Print that copies
+// into memory, so the numbers are formatting cost plus call overhead only.
+//
+// Throughput is in bytes per second of host time, so only relative numbers
+// carry over to the target. On the board each write() into USB CDC also
+// takes a lock and may schedule a transfer, which the write() counts stand
+// for; the CPU time there has to be measured on the board itself.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include "AdvancedCSV.h"
+
+class MemPrint : public Print {
+  public:
+    std::vector<uint8_t> text;
+    size_t n_calls = 0;
+
+    size_t write(uint8_t c) override {
+        n_calls++;
+        text.push_back(c);
+        return 1;
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) override {
+        n_calls++;
+        text.insert(text.end(), buffer, buffer + size);
+        return size;
+    }
+
+    void clear() {
+        text.clear();
+        n_calls = 0;
+    }
+};
+
+// Print::print(unsigned) and Print::print(char), as in the Arduino core.
+static size_t print_value(Print &port, uint32_t value) {
+    char buf[11];
+    char *p = &buf[sizeof(buf)];
+    do {
+        *--p = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    return port.write((const uint8_t *)p, &buf[sizeof(buf)] - p);
+}
+
+static size_t print_lines(Print &port, const Sample *in, size_t n_channels, size_t n_frames) {
+    size_t n = 0;
+    for (size_t i = 0; i < n_frames; i++) {
+        for (size_t ch = 0; ch < n_channels; ch++) {
+            n += print_value(port, in[i * n_channels + ch]);
+            if (ch + 1 < n_channels) {
+                n += port.write(',');
+            }
+        }
+        n += port.write((const uint8_t *)"\r\n", 2);
+    }
+    return n;
+}
+
+template <class F> static double rate(MemPrint &port, F fn) {
+    size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    double secs = 0.0;
+    do {
+        for (int k = 0; k < 256; k++) {
+            port.clear();
+            bytes += fn();
+        }
+        secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (secs < 0.2);
+    return bytes / secs;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-c channels] [-n frames]\n", name);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    size_t n_channels = 2, n_frames = 32;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:n:")) != -1) {
+        switch (opt) {
+            case 'c': n_channels = strtoul(optarg, nullptr, 0); break;
+            case 'n': n_frames = strtoul(optarg, nullptr, 0); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (n_channels == 0 || n_frames == 0) {
+        usage(argv[0]);
+    }
+
+    // Check an_utoa() at every digit count boundary.
+    size_t errors = 0;
+    for (uint32_t v = 1, k = 0; k < 10; v *= 10, k++) {
+        const uint32_t values[] = {v - 1, v, v + 1, 0xFFFFFFFFU};
+        for (uint32_t x : values) {
+            char a[16], b[16];
+            *an_utoa(x, a) = '\0';
+            snprintf(b, sizeof(b), "%u", x);
+            if (strcmp(a, b)) {
+                printf("an_utoa(%u) = \"%s\"\n", x, a);
+                errors++;
+            }
+        }
+    }
+
+    printf("%6s %12s %8s %16s %16s\n", "bits", "bytes/line", "text", "per-value MB/s", "AdvancedCSV MB/s");
+    static const uint8_t RES_BITS[] = {8, 12, 16};
+    for (uint8_t bits : RES_BITS) {
+        std::vector<Sample> in(n_channels * n_frames);
+        for (size_t i = 0; i < in.size(); i++) {
+            in[i] = (Sample)(((uint32_t)i * 2654435761U) >> (32 - bits));
+        }
+
+        MemPrint port;
+        AdvancedCSV csv(port, n_frames * AN_CSV_FRAME_BYTES(n_channels));
+        print_lines(port, in.data(), n_channels, n_frames);
+        std::vector<uint8_t> ref = port.text;
+        size_t ref_calls = port.n_calls;
+        port.clear();
+        csv.print(in.data(), n_channels, n_frames);
+        bool same = port.text == ref;
+        size_t csv_calls = port.n_calls;
+        errors += !same;
+
+        double p = rate(port, [&] { return print_lines(port, in.data(), n_channels, n_frames); });
+        double c = rate(port, [&] { return csv.print(in.data(), n_channels, n_frames); });
+        printf("%6u %12.1f %8s %16.1f %16.1f\n", bits, (double)ref.size() / n_frames, same ? "same" : "FAIL",
+               p / 1e6, c / 1e6);
+        printf("%6s write() calls per buffer: %zu per value, %zu AdvancedCSV\n", "", ref_calls, csv_calls);
+    }
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,62 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Decodes a frame stream captured from AdvancedStream and prints statistics.
+//
+// Build:  g++ -O2 -std=c++17 -I../../src an_decode.cpp ../../src/AdvancedFrame.cpp ../../src/AdvancedPack.cpp
+//             ../../src/AdvancedCodec.cpp -o an_decode
+// Usage:  an_decode [file]   (reads stdin if no file is given, e.g. cat /dev/ttyACM0 | an_decode)
+#include <stdio.h>
+#include <chrono>
+#include "an_stream.h"
+
+int main(int argc, char **argv) {
+    FILE *in = stdin;
+    if (argc > 1 && (in = fopen(argv[1], "rb")) == nullptr) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    an::FrameParser parser;
+    uint64_t samples = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (;;) {
+        size_t len;
+        uint8_t *dst = parser.space(len);
+        len = fread(dst, 1, len, in);
+        if (len == 0) {
+            break;
+        }
+        parser.commit(len, [&](const frame_header_t &hdr, const uint8_t *) {
+            samples += hdr.n_samples;
+        });
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const an::stream_stats_t &s = parser.stats;
+    printf("frames:       %llu\n", (unsigned long long)s.frames);
+    printf("samples:      %llu\n", (unsigned long long)samples);
+    printf("lost frames:  %llu\n", (unsigned long long)s.lost);
+    printf("restarts:     %llu\n", (unsigned long long)s.restarts);
+    printf("discont:      %llu\n", (unsigned long long)s.discont);
+    printf("crc errors:   %llu\n", (unsigned long long)s.crc_errors);
+    printf("resync bytes: %llu\n", (unsigned long long)s.resync_bytes);
+    printf("throughput:   %.1f MB/s\n", secs > 0 ? s.bytes / secs / 1e6 : 0.0);
+    return 0;
+}
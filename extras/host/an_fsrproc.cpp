@@ -0,0 +1,238 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Reprocesses an FSR capture with the library's own stages, in parallel.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -I../../src an_fsrproc.cpp ../../src/AdvancedFSR.cpp
+//             ../../src/AdvancedConverter.cpp ../../src/AdvancedBaseline.cpp
+//             ../../src/AdvancedPack.cpp ../../src/AdvancedCodec.cpp -o an_fsrproc
+// Usage:  an_fsrproc [-j threads] [-r ohms] [-a scale] [-b exponent] [-L] [-t threshold] [-k shift] file
+//
+//   -j  Worker threads (default: one per core).
+//   -r  Divider reference resistor in ohms (default: 10000).
+//   -a  Force in N at 1uS of FSR conductance (default: 0.1).
+//   -b  Conductance exponent (default: 1).
+//   -L  FSR on the low side of the divider.
+//   -t  Baseline activity threshold in codes (default: 32).
+//   -k  Baseline time constant, log2 samples (default: 10).
+//
+// Chunks are decoded and converted to force in parallel, since those steps
+// keep no state. The baseline tracker does, so each channel has its own
+// tracker on its own strand, which takes the chunks in file order whatever
+// order their decoding finishes in. Results don't depend on -j: the digest
+// printed per channel hashes its baseline output in order, to check that.
+// Chunks that fail to decode, or hold codes above the capture's resolution,
+// stop the run as corrupt.
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "AdvancedFSR.h"
+#include "AdvancedBaseline.h"
+#include "an_capture.h"
+#include "an_pool.h"
+
+#define FORCE_LSB   (0.01f)     // Force unit of the tables, N.
+
+struct channel_t {
+    std::unique_ptr<AdvancedBaseline> baseline;
+    std::vector<int32_t> residual;
+    uint64_t frames = 0;
+    uint64_t active = 0;        // Frames above the activity threshold.
+    uint64_t presses = 0;       // Idle to active transitions.
+    bool pressed = false;
+    uint32_t peak = 0;          // Largest residual magnitude, codes.
+    uint16_t peak_force = 0;
+    uint64_t force_sum = 0;     // Force units, for the impulse.
+    uint64_t digest = 14695981039346656037ULL;  // FNV-1a over the residuals.
+};
+
+// One chunk, split per channel.
+struct chunk_t {
+    size_t n_frames = 0;
+    std::vector<uint16_t> codes;    // Planar, n_frames per channel.
+    std::vector<uint16_t> force;    // Planar, force units.
+};
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-j threads] [-r ohms] [-a scale] [-b exponent] [-L] [-t threshold] [-k shift] file\n", name);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    size_t n_threads = 0;
+    float r_ref = 10000.0f;
+    float a = 0.1f;
+    float b = 1.0f;
+    fsr_divider_t wiring = AN_FSR_HIGH_SIDE;
+    uint32_t threshold = 32;
+    uint32_t shift = 10;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:r:a:b:Lt:k:")) != -1) {
+        switch (opt) {
+            case 'j': n_threads = strtoul(optarg, nullptr, 0); break;
+            case 'r': r_ref = strtof(optarg, nullptr); break;
+            case 'a': a = strtof(optarg, nullptr); break;
+            case 'b': b = strtof(optarg, nullptr); break;
+            case 'L': wiring = AN_FSR_LOW_SIDE; break;
+            case 't': threshold = strtoul(optarg, nullptr, 0); break;
+            case 'k': shift = strtoul(optarg, nullptr, 0); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind + 1 != argc) {
+        usage(argv[0]);
+    }
+
+    an::CaptureFile cap;
+    if (!cap.open(argv[optind])) {
+        fprintf(stderr, "%s: not a capture file\n", argv[optind]);
+        return 1;
+    }
+    const capture_header_t &h = cap.header();
+    const size_t n_ch = cap.channels();
+
+    // Conversion tables are only read once built, so all jobs share them.
+    AdvancedFSR fsr(n_ch, h.resolution, FORCE_LSB);
+    for (size_t ch = 0; ch < n_ch; ch++) {
+        if (!fsr.conductance(ch, r_ref, a, b, wiring)) {
+            fprintf(stderr, "invalid FSR model\n");
+            return 2;
+        }
+    }
+
+    an::Pool pool(n_threads);
+    std::vector<channel_t> chan(n_ch);
+    std::vector<std::unique_ptr<an::Strand>> strands;
+    for (size_t ch = 0; ch < n_ch; ch++) {
+        chan[ch].baseline.reset(new AdvancedBaseline(1, threshold, shift));
+        if (!chan[ch].baseline->config(0, threshold, shift)) {
+            fprintf(stderr, "invalid baseline settings\n");
+            return 2;
+        }
+        strands.emplace_back(new an::Strand(pool));
+    }
+
+    // Runs on the channel's strand, so chunks arrive one at a time and in order.
+    auto track = [&](size_t ch, const chunk_t &chunk) {
+        channel_t &c = chan[ch];
+        const uint16_t *codes = &chunk.codes[ch * chunk.n_frames];
+        const uint16_t *force = &chunk.force[ch * chunk.n_frames];
+        c.residual.resize(chunk.n_frames);
+        c.baseline->process(codes, chunk.n_frames, c.residual.data());
+        for (size_t i = 0; i < chunk.n_frames; i++) {
+            int32_t r = c.residual[i];
+            uint32_t m = (uint32_t)(r < 0 ? -r : r);
+            bool on = m > threshold;
+            c.active += on;
+            c.presses += (on && !c.pressed);
+            c.pressed = on;
+            c.peak = (m > c.peak) ? m : c.peak;
+            c.peak_force = (force[i] > c.peak_force) ? force[i] : c.peak_force;
+            c.force_sum += force[i];
+            for (int k = 0; k < 32; k += 8) {
+                c.digest = (c.digest ^ (((uint32_t)r >> k) & 0xFF)) * 1099511628211ULL;
+            }
+        }
+        c.frames += chunk.n_frames;
+    };
+
+    // Stateless, runs anywhere: decode, de-interleave, convert to force. The
+    // tables only cover the header's resolution, so a chunk with larger codes
+    // is corrupt.
+    const uint32_t max_code = (h.resolution < AN_RESOLUTION_16) ? (1UL << (8 + 2 * h.resolution)) - 1 : 0xFFFF;
+    std::atomic<bool> failed{false};
+    auto split = [&](size_t k) {
+        const capture_chunk_t *c = cap.chunk(k);
+        std::shared_ptr<chunk_t> chunk(new chunk_t);
+        std::vector<uint16_t> tmp;
+        if (c == nullptr || c->n_samples % n_ch) {
+            failed = true;
+            return;
+        }
+        chunk->n_frames = c->n_samples / n_ch;
+        chunk->codes.resize(c->n_samples);
+        chunk->force.resize(c->n_samples);
+        const uint32_t lsh = fsr.lookup_shift();
+        for (size_t ch = 0; ch < n_ch; ch++) {
+            an::strided_view<uint16_t> v = cap.view(k, ch);
+            if (v.size() == 0) {
+                if (tmp.empty()) {
+                    tmp.resize(c->n_samples);
+                    if (cap.decode(k, tmp.data()) == 0) {
+                        failed = true;
+                        return;
+                    }
+                }
+                v.data = tmp.data() + ch;
+                v.stride = n_ch;
+                v.n = chunk->n_frames;
+            }
+            uint16_t *codes = &chunk->codes[ch * chunk->n_frames];
+            uint16_t *force = &chunk->force[ch * chunk->n_frames];
+            const uint16_t *lut = fsr.lookup(ch);
+            for (size_t i = 0; i < v.size(); i++) {
+                uint16_t code = v[i];
+                if (code > max_code) {
+                    failed = true;
+                    return;
+                }
+                codes[i] = code;
+                force[i] = lut[code >> lsh];
+            }
+        }
+        for (size_t ch = 0; ch < n_ch; ch++) {
+            strands[ch]->post(k, [&track, ch, chunk] {
+                track(ch, *chunk);
+            });
+        }
+    };
+
+    // Chunks go out in windows, so memory stays bounded on long captures.
+    const size_t window = 16 * pool.size();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t k0 = 0; k0 < cap.chunks() && !failed; k0 += window) {
+        for (size_t k = k0; k < k0 + window && k < cap.chunks(); k++) {
+            pool.submit([&split, k] {
+                split(k);
+            });
+        }
+        pool.wait();
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (failed) {
+        fprintf(stderr, "%s: corrupt chunk\n", argv[optind]);
+        return 1;
+    }
+
+    uint64_t frames = n_ch ? chan[0].frames : 0;
+    double dt = (h.sample_rate > 0.0f) ? 1.0 / h.sample_rate : 0.0;
+    printf("threads:      %zu (%llu jobs stolen)\n", pool.size(), (unsigned long long)pool.stolen());
+    printf("frames:       %llu\n", (unsigned long long)frames);
+    printf("throughput:   %.1f Msamples/s\n", secs > 0 ? frames * n_ch / secs / 1e6 : 0.0);
+    for (size_t ch = 0; ch < n_ch; ch++) {
+        const channel_t &c = chan[ch];
+        printf("ch%-2zu active %5.1f%% presses %-6llu peak %-5u codes %8.2f N impulse %10.4f Ns digest %016llx\n",
+               ch, c.frames ? 100.0 * c.active / c.frames : 0.0, (unsigned long long)c.presses, c.peak,
+               c.peak_force * FORCE_LSB, c.force_sum * FORCE_LSB * dt, (unsigned long long)c.digest);
+    }
+    return 0;
+}
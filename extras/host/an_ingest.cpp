@@ -0,0 +1,325 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Ingests a frame stream from AdvancedStream and writes the samples to disk.
+//
+// Build:  g++ -O2 -std=c++17 -I../../src an_ingest.cpp ../../src/AdvancedFrame.cpp ../../src/AdvancedPack.cpp ../../src/AdvancedCodec.cpp -o an_ingest
+// Usage:  an_ingest [-f raw|csv|columns] [-o output] [input]
+//
+// The input can be a serial device (configured as a raw tty), a file, or stdin
+// if omitted or "-". Output formats:
+//   raw      Interleaved little-endian uint16 samples (packed and compressed frames are decoded).
+//   csv      One row per sample frame: sequence,ch0,ch1,...
+//   columns  One little-endian uint16 file per channel, <output>.ch<N>.u16, plus
+//            <output>.idx with one index_record_t per frame. Every file can be
+//            memory-mapped directly, e.g. with numpy.memmap(dtype='<u2').
+// Gaps in the sequence numbers are reported on stderr and in the index.
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "an_stream.h"
+#include "AdvancedPack.h"
+#include "AdvancedCodec.h"
+
+enum { FMT_RAW, FMT_CSV, FMT_COLUMNS };
+
+struct index_record_t {
+    uint32_t sequence;
+    uint32_t timestamp;     // Time of the first sample, in us.
+    uint64_t offset;        // Index of the first sample frame in the column files.
+    uint32_t n_frames;      // Sample frames in this frame.
+    uint32_t lost;          // Frames lost just before this one.
+};
+
+// Buffered writer, so formatting never hits the kernel per row.
+class Output {
+  private:
+    FILE *f = nullptr;
+    std::vector<char> buf;
+    size_t len = 0;
+
+  public:
+    bool open(const std::string &path) {
+        f = (path == "-") ? stdout : fopen(path.c_str(), "wb");
+        buf.resize(1 << 20);
+        return f != nullptr;
+    }
+
+    void flush() {
+        if (len && fwrite(buf.data(), 1, len, f) != len) {
+            perror("write");
+            exit(1);
+        }
+        len = 0;
+    }
+
+    char *reserve(size_t n) {
+        if (buf.size() - len < n) {
+            flush();
+            if (buf.size() < n) {
+                buf.resize(n);
+            }
+        }
+        return buf.data() + len;
+    }
+
+    void commit(size_t n) {
+        len += n;
+    }
+
+    void write(const void *data, size_t n) {
+        if (n >= buf.size() / 2) {
+            // Large blocks go straight out, no point copying them.
+            flush();
+            if (fwrite(data, 1, n, f) != n) {
+                perror("write");
+                exit(1);
+            }
+            return;
+        }
+        memcpy(reserve(n), data, n);
+        commit(n);
+    }
+
+    void close() {
+        if (f) {
+            flush();
+            if (f != stdout) {
+                fclose(f);
+            }
+            f = nullptr;
+        }
+    }
+};
+
+static int open_input(const char *path) {
+    if (path == nullptr || strcmp(path, "-") == 0) {
+        return STDIN_FILENO;
+    }
+    int fd = open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct termios tio;
+    if (isatty(fd) && tcgetattr(fd, &tio) == 0) {
+        // USB CDC ignores the baud rate, but the line discipline must be raw.
+        cfmakeraw(&tio);
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+        tcflush(fd, TCIFLUSH);
+    }
+    return fd;
+}
+
+static inline char *format_uint(char *p, uint32_t v) {
+    char tmp[10];
+    int n = 0;
+    do {
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    while (n) {
+        *p++ = tmp[--n];
+    }
+    return p;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-f raw|csv|columns] [-o output] [input]\n", name);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    int format = FMT_RAW;
+    std::string out_path = "-";
+    int opt;
+    while ((opt = getopt(argc, argv, "f:o:")) != -1) {
+        if (opt == 'f') {
+            if (strcmp(optarg, "raw") == 0) {
+                format = FMT_RAW;
+            } else if (strcmp(optarg, "csv") == 0) {
+                format = FMT_CSV;
+            } else if (strcmp(optarg, "columns") == 0) {
+                format = FMT_COLUMNS;
+            } else {
+                usage(argv[0]);
+            }
+        } else if (opt == 'o') {
+            out_path = optarg;
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (format == FMT_COLUMNS && out_path == "-") {
+        fprintf(stderr, "columns output needs -o <prefix>\n");
+        return 2;
+    }
+
+    int fd = open_input(optind < argc ? argv[optind] : nullptr);
+    if (fd < 0) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    // Outputs are opened on the first frame, once the channel count is known.
+    std::vector<Output> out;
+    Output index;
+    std::vector<uint16_t> column;
+    std::vector<uint16_t> unpacked;
+    size_t n_channels = 0;
+    uint64_t offset = 0;
+    uint64_t skipped = 0;
+
+    auto on_frame = [&](const frame_header_t &hdr, const uint8_t *payload, uint32_t lost) {
+        const uint8_t *samples = payload;
+        if (hdr.channels == 0) {
+            skipped++;
+            return;
+        } else if (hdr.encoding == AN_FRAME_RAW && hdr.payload_bytes == hdr.n_samples * sizeof(uint16_t)) {
+            // Used in place.
+        } else if (hdr.encoding == AN_FRAME_PACKED
+                && hdr.payload_bytes == an_packed_bytes(hdr.resolution, hdr.n_samples)) {
+            unpacked.resize(hdr.n_samples);
+            an_unpack(hdr.resolution, payload, 0, hdr.n_samples, unpacked.data());
+            samples = (const uint8_t *)unpacked.data();
+        } else if (hdr.encoding == AN_FRAME_RICE && hdr.n_samples % hdr.channels == 0) {
+            unpacked.resize(hdr.n_samples);
+            if (an_decode(payload, hdr.payload_bytes, hdr.channels, hdr.n_samples / hdr.channels,
+                    unpacked.data()) != hdr.payload_bytes) {
+                skipped++;
+                return;
+            }
+            samples = (const uint8_t *)unpacked.data();
+        } else {
+            skipped++;
+            return;
+        }
+        if (n_channels == 0) {
+            n_channels = hdr.channels;
+            if (format == FMT_COLUMNS) {
+                out.resize(n_channels);
+                for (size_t i = 0; i < n_channels; i++) {
+                    if (!out[i].open(out_path + ".ch" + std::to_string(i) + ".u16")) {
+                        perror(out_path.c_str());
+                        exit(1);
+                    }
+                }
+                if (!index.open(out_path + ".idx")) {
+                    perror(out_path.c_str());
+                    exit(1);
+                }
+            } else {
+                out.resize(1);
+                if (!out[0].open(out_path)) {
+                    perror(out_path.c_str());
+                    exit(1);
+                }
+                if (format == FMT_CSV) {
+                    std::string hdr_row = "sequence";
+                    for (size_t i = 0; i < n_channels; i++) {
+                        hdr_row += ",ch" + std::to_string(i);
+                    }
+                    hdr_row += "\n";
+                    out[0].write(hdr_row.data(), hdr_row.size());
+                }
+            }
+        } else if (hdr.channels != n_channels) {
+            // The outputs have a fixed layout, so a different channel count can't be stored.
+            skipped++;
+            return;
+        }
+        if (lost) {
+            fprintf(stderr, "gap: %u frame(s) lost before sequence %u\n", lost, hdr.sequence);
+        }
+
+        size_t n_frames = hdr.n_samples / n_channels;
+        if (format == FMT_RAW) {
+            out[0].write(samples, hdr.n_samples * sizeof(uint16_t));
+        } else if (format == FMT_CSV) {
+            for (size_t i = 0; i < n_frames; i++) {
+                // Worst case per row: 10 digits of sequence, 5 digits and a comma per channel.
+                char *p = out[0].reserve(11 + 6 * n_channels + 1);
+                char *start = p;
+                p = format_uint(p, hdr.sequence);
+                for (size_t ch = 0; ch < n_channels; ch++) {
+                    uint16_t s;
+                    memcpy(&s, &samples[(i * n_channels + ch) * 2], sizeof(s));
+                    *p++ = ',';
+                    p = format_uint(p, s);
+                }
+                *p++ = '\n';
+                out[0].commit(p - start);
+            }
+        } else {
+            column.resize(n_frames);
+            for (size_t ch = 0; ch < n_channels; ch++) {
+                const uint8_t *src = &samples[ch * 2];
+                for (size_t i = 0; i < n_frames; i++, src += n_channels * 2) {
+                    memcpy(&column[i], src, sizeof(uint16_t));
+                }
+                out[ch].write(column.data(), n_frames * sizeof(uint16_t));
+            }
+            index_record_t rec = { hdr.sequence, hdr.timestamp, offset, (uint32_t)n_frames, lost };
+            index.write(&rec, sizeof(rec));
+        }
+        offset += n_frames;
+    };
+
+    an::FrameParser parser;
+    auto start = std::chrono::steady_clock::now();
+    for (;;) {
+        size_t len;
+        uint8_t *dst = parser.space(len, 64 * 1024);
+        ssize_t n = read(fd, dst, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        parser.commit(n, [&](const frame_header_t &hdr, const uint8_t *payload) {
+            if (parser.restart) {
+                fprintf(stderr, "restart: sequence went back to %u\n", hdr.sequence);
+            }
+            on_frame(hdr, payload, parser.gap);
+        });
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (auto &o : out) {
+        o.close();
+    }
+    index.close();
+
+    const an::stream_stats_t &s = parser.stats;
+    fprintf(stderr, "frames %llu, sample frames %llu, lost %llu, restarts %llu, skipped %llu, crc errors %llu, "
+            "resync bytes %llu, %.1f MB/s\n",
+            (unsigned long long)s.frames, (unsigned long long)offset, (unsigned long long)s.lost,
+            (unsigned long long)s.restarts, (unsigned long long)skipped, (unsigned long long)s.crc_errors,
+            (unsigned long long)s.resync_bytes, secs > 0 ? s.bytes / secs / 1e6 : 0.0);
+    return 0;
+}
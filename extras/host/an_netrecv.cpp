@@ -0,0 +1,370 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Receives frames from AdvancedNet and reports throughput, loss and reordering.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -I../../src an_netrecv.cpp ../../src/AdvancedFrame.cpp
+//             ../../src/AdvancedPack.cpp ../../src/AdvancedCodec.cpp -o an_netrecv
+// Usage:  an_netrecv [-t] [-p port] [-s seconds] [-o output]
+//         an_netrecv -l [-p port]
+//
+//   -t  Accept one TCP connection instead of receiving UDP datagrams.
+//   -p  Port to listen on (default: 5000).
+//   -s  Stop after this many seconds (default: run until interrupted).
+//   -o  Append every valid frame to a file, in arrival order, for an_decode or an_ingest.
+//   -l  Loopback self-test: sends numbered datagrams to itself with known loss and
+//       reordering, and checks that both are reported exactly.
+//
+// Lost frames include the ones AdvancedNet dropped because its queue was full;
+// those are also flagged AN_FRAME_DISCONT on the next frame sent.
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "an_stream.h"
+
+// Tracks sequence numbers that may arrive out of order. A frame is counted as
+// lost when a later one arrives first, and moved to reordered if it turns up
+// within the window. A frame further back than the window can't be a late
+// one; the sender restarted its sequence (e.g. after a reset), so tracking
+// starts over from it.
+class SequenceTracker {
+  private:
+    static const uint32_t WINDOW = 4096;
+    std::vector<uint32_t> seen = std::vector<uint32_t>(WINDOW);
+    std::vector<bool> valid = std::vector<bool>(WINDOW);
+    bool started = false;
+    uint32_t first = 0;
+    uint32_t next = 0;
+
+    void mark(uint32_t seq) {
+        seen[seq % WINDOW] = seq;
+        valid[seq % WINDOW] = true;
+    }
+
+  public:
+    uint64_t lost = 0;
+    uint64_t reordered = 0;
+    uint64_t duplicates = 0;
+    uint64_t restarts = 0;  // Sequence jumped back by more than the window.
+
+    void add(uint32_t seq) {
+        if (started && (int32_t)(next - seq) > (int32_t)WINDOW) {
+            restarts++;
+            started = false;
+            std::fill(valid.begin(), valid.end(), false);
+        }
+        if (!started) {
+            started = true;
+            first = seq;
+            next = seq + 1;
+            mark(seq);
+            return;
+        }
+        int32_t ahead = (int32_t)(seq - next);
+        if (ahead >= 0) {
+            lost += ahead;
+            for (uint32_t i = 0; i < (uint32_t)ahead && i < WINDOW; i++) {
+                valid[(next + i) % WINDOW] = false;
+            }
+            mark(seq);
+            next = seq + 1;
+        } else if (valid[seq % WINDOW] && seen[seq % WINDOW] == seq) {
+            duplicates++;
+        } else {
+            reordered++;
+            if ((int32_t)(seq - first) > 0) {
+                lost--;
+            }
+            mark(seq);
+        }
+    }
+};
+
+struct recv_stats_t {
+    uint64_t frames = 0;
+    uint64_t samples = 0;
+    uint64_t bytes = 0;
+    uint64_t bad = 0;       // Datagrams that are not exactly one valid frame.
+    uint64_t discont = 0;
+};
+
+static volatile bool stop = false;
+
+static void on_signal(int) {
+    stop = true;
+}
+
+static int listen_socket(int type, uint16_t port) {
+    int fd = socket(AF_INET, type, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    // A large receive buffer rides out scheduling hiccups on the host.
+    int rcvbuf = 8 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    // Wake up periodically, so the report and the time limit don't depend on traffic.
+    timeval tv = { 0, 200000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0 || (type == SOCK_STREAM && listen(fd, 1) < 0)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Checks that a datagram holds exactly one frame with a valid CRC.
+static bool check_datagram(const uint8_t *p, size_t len, frame_header_t &hdr) {
+    if (len < AN_FRAME_HEADER_SIZE + AN_FRAME_TRAILER_SIZE) {
+        return false;
+    }
+    memcpy(&hdr, p, sizeof(hdr));
+    if (!an_frame_check(&hdr) || hdr.payload_bytes != len - AN_FRAME_HEADER_SIZE - AN_FRAME_TRAILER_SIZE) {
+        return false;
+    }
+    uint32_t crc;
+    memcpy(&crc, p + len - AN_FRAME_TRAILER_SIZE, sizeof(crc));
+    return an_crc32(0, p, len - AN_FRAME_TRAILER_SIZE) == crc;
+}
+
+static void report(FILE *f, const char *label, const recv_stats_t &s, const SequenceTracker &seq, double secs) {
+    fprintf(f, "%s%8.1fs  frames %llu  %.2f MB/s  %.3f Msps  lost %llu  reordered %llu  dup %llu"
+            "  restarts %llu  bad %llu  discont %llu\n", label, secs,
+            (unsigned long long)s.frames, secs > 0 ? s.bytes / secs / 1e6 : 0.0,
+            secs > 0 ? s.samples / secs / 1e6 : 0.0, (unsigned long long)seq.lost,
+            (unsigned long long)seq.reordered, (unsigned long long)seq.duplicates,
+            (unsigned long long)seq.restarts, (unsigned long long)s.bad, (unsigned long long)s.discont);
+}
+
+// Sends n datagrams to the local port, skipping every 97th sequence number and
+// swapping every 50th pair. Returns the expected loss and reordering.
+static void loopback_sender(uint16_t port, uint32_t n, uint64_t &lost, uint64_t &reordered) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    const uint32_t n_samples = 64;
+    std::vector<uint8_t> dgram(AN_FRAME_HEADER_SIZE + n_samples * 2 + AN_FRAME_TRAILER_SIZE);
+    auto send_seq = [&](uint32_t seq) {
+        frame_header_t hdr = {};
+        hdr.sync[0] = AN_FRAME_SYNC0;
+        hdr.sync[1] = AN_FRAME_SYNC1;
+        hdr.version = AN_FRAME_VERSION;
+        hdr.channels = 1;
+        hdr.resolution = 4;
+        hdr.encoding = AN_FRAME_RAW;
+        hdr.sequence = seq;
+        hdr.timestamp = seq * n_samples;
+        hdr.n_samples = n_samples;
+        hdr.payload_bytes = n_samples * 2;
+        memcpy(dgram.data(), &hdr, sizeof(hdr));
+        for (uint32_t i = 0; i < n_samples; i++) {
+            uint16_t v = (uint16_t)(seq + i);
+            memcpy(&dgram[AN_FRAME_HEADER_SIZE + i * 2], &v, 2);
+        }
+        uint32_t crc = an_crc32(0, dgram.data(), AN_FRAME_HEADER_SIZE + n_samples * 2);
+        memcpy(&dgram[AN_FRAME_HEADER_SIZE + n_samples * 2], &crc, 4);
+        sendto(fd, dgram.data(), dgram.size(), 0, (sockaddr *)&addr, sizeof(addr));
+    };
+
+    lost = reordered = 0;
+    for (uint32_t seq = 0; seq < n; seq++) {
+        if (seq % 97 == 96) {
+            lost++;
+        } else if (seq % 50 == 48 && seq + 1 < n && (seq + 1) % 97 != 96) {
+            send_seq(seq + 1);
+            send_seq(seq);
+            reordered++;
+            seq++;
+        } else {
+            send_seq(seq);
+        }
+        if (seq % 256 == 0) {
+            // Pace the sender so the loopback buffer never overflows.
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    }
+    // A final marker, so a trailing gap is also counted.
+    send_seq(n);
+    close(fd);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-t] [-p port] [-s seconds] [-o output]\n       %s -l [-p port]\n", name, name);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    bool tcp = false;
+    bool loopback = false;
+    uint16_t port = 5000;
+    double limit = 0;
+    const char *out_path = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "tp:s:o:l")) != -1) {
+        if (opt == 't') {
+            tcp = true;
+        } else if (opt == 'p') {
+            port = atoi(optarg);
+        } else if (opt == 's') {
+            limit = atof(optarg);
+        } else if (opt == 'o') {
+            out_path = optarg;
+        } else if (opt == 'l') {
+            loopback = true;
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (loopback && tcp) {
+        usage(argv[0]);
+    }
+
+    int fd = listen_socket(tcp ? SOCK_STREAM : SOCK_DGRAM, port);
+    if (fd < 0) {
+        perror("listen");
+        return 1;
+    }
+    FILE *out = nullptr;
+    if (out_path && (out = fopen(out_path, "wb")) == nullptr) {
+        perror(out_path);
+        return 1;
+    }
+    signal(SIGINT, on_signal);
+
+    recv_stats_t stats;
+    SequenceTracker seq;
+    auto on_frame = [&](const frame_header_t &hdr, const uint8_t *frame, size_t len) {
+        seq.add(hdr.sequence);
+        stats.frames++;
+        stats.samples += hdr.n_samples;
+        stats.bytes += len;
+        if (hdr.flags & AN_FRAME_DISCONT) {
+            stats.discont++;
+        }
+        if (out && fwrite(frame, 1, len, out) != len) {
+            perror(out_path);
+            exit(1);
+        }
+    };
+
+    const uint32_t n_test = 100000;
+    uint64_t want_lost = 0, want_reordered = 0;
+    std::thread sender;
+    if (loopback) {
+        sender = std::thread(loopback_sender, port, n_test, std::ref(want_lost), std::ref(want_reordered));
+        // Only a backstop in case the final marker is lost.
+        limit = 10;
+    }
+
+    int conn = -1;
+    if (tcp) {
+        fprintf(stderr, "waiting for a connection on port %u\n", port);
+        while (!stop && (conn = accept(fd, nullptr, nullptr)) < 0) {
+        }
+        if (conn < 0) {
+            return 1;
+        }
+        timeval tv = { 0, 200000 };
+        setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+
+    an::FrameParser parser;
+    std::vector<uint8_t> dgram(65536);
+    auto start = std::chrono::steady_clock::now();
+    auto last_report = start;
+    bool started = false;
+    while (!stop) {
+        if (tcp) {
+            size_t len;
+            uint8_t *dst = parser.space(len);
+            ssize_t n = recv(conn, dst, len, 0);
+            if (n == 0) {
+                break;
+            } else if (n > 0) {
+                parser.commit(n, [&](const frame_header_t &hdr, const uint8_t *payload) {
+                    on_frame(hdr, payload - AN_FRAME_HEADER_SIZE,
+                             AN_FRAME_HEADER_SIZE + hdr.payload_bytes + AN_FRAME_TRAILER_SIZE);
+                });
+                stats.bad = parser.stats.crc_errors;
+            }
+        } else {
+            ssize_t n = recv(fd, dgram.data(), dgram.size(), 0);
+            frame_header_t hdr;
+            if (n > 0 && check_datagram(dgram.data(), n, hdr)) {
+                on_frame(hdr, dgram.data(), n);
+                if (loopback && hdr.sequence == n_test) {
+                    break;
+                }
+            } else if (n > 0) {
+                stats.bad++;
+            }
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (!started && stats.frames) {
+            // Measure from the first frame, not from when the receiver was started.
+            started = true;
+            start = last_report = now;
+        }
+        double secs = std::chrono::duration<double>(now - start).count();
+        if (started && !loopback && now - last_report >= std::chrono::seconds(1)) {
+            report(stderr, "", stats, seq, secs);
+            last_report = now;
+        }
+        if (limit > 0 && started && secs >= limit) {
+            break;
+        }
+    }
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report(stdout, "total ", stats, seq, secs);
+    if (out) {
+        fclose(out);
+    }
+    if (conn >= 0) {
+        close(conn);
+    }
+    close(fd);
+
+    if (loopback) {
+        sender.join();
+        bool pass = seq.lost == want_lost && seq.reordered == want_reordered && seq.duplicates == 0
+                    && stats.bad == 0 && stats.frames == n_test + 1 - want_lost;
+        printf("loopback: expected lost %llu reordered %llu: %s\n", (unsigned long long)want_lost,
+               (unsigned long long)want_reordered, pass ? "PASS" : "FAIL");
+        return pass ? 0 : 1;
+    }
+    return 0;
+}
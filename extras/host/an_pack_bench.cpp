@@ -0,0 +1,155 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Checks that AdvancedPack round-trips at every resolution, and measures its
+// throughput on the host.
+//
+// Build:  g++ -O2 -std=c++17 -I../../src an_pack_bench.cpp ../../src/AdvancedPack.cpp -o an_pack_bench
+// Usage:  an_pack_bench [-n samples]
+//
+//   -n  Buffer size for the throughput test (default: 4096).
+//
+// The round-trip test packs random 16-bit codes, so the high bits must be
+// dropped, for every length up to 67 samples (every partial group, plus whole
+// groups on either side of the 8-sample fast path), and unpacks every
+// (first, n) window of the result. Packed data is kept in buffers of exactly
+// an_packed_bytes() bytes, so building with -fsanitize=address also catches
+// reads and writes past the end. Exits with status 1 on any mismatch.
+//
+// Throughput is in samples per second of host time, so only relative numbers
+// carry over to the target.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include "AdvancedPack.h"
+
+static const uint8_t RES_BITS[] = {8, 10, 12, 14, 16};
+
+static uint32_t rnd(uint32_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static size_t round_trip(uint32_t res) {
+    const uint16_t mask = (uint16_t)((1UL << RES_BITS[res]) - 1);
+    uint32_t state = 0x12345678 + res;
+    size_t errors = 0;
+    for (size_t n = 0; n < 68; n++) {
+        // Empty vectors still get storage, as memcpy() mustn't see null pointers.
+        std::vector<uint16_t> in(n);
+        in.reserve(1);
+        for (auto &s : in) {
+            s = (uint16_t)rnd(&state);
+        }
+        std::vector<uint8_t> packed(an_packed_bytes(res, n));
+        packed.reserve(1);
+        if (packed.size() != (n * RES_BITS[res] + 7) / 8) {
+            printf("%u bits, n=%zu: an_packed_bytes() = %zu\n", RES_BITS[res], n, packed.size());
+            errors++;
+        }
+        if (an_pack(res, in.data(), n, packed.data()) != packed.size()) {
+            printf("%u bits, n=%zu: an_pack() returned the wrong size\n", RES_BITS[res], n);
+            errors++;
+        }
+        for (size_t first = 0; first <= n; first++) {
+            for (size_t len = 0; first + len <= n; len++) {
+                std::vector<uint16_t> out(len);
+                out.reserve(1);
+                if (an_unpack(res, packed.data(), first, len, out.data()) != len) {
+                    printf("%u bits, n=%zu: an_unpack() returned the wrong count\n", RES_BITS[res], n);
+                    errors++;
+                }
+                for (size_t i = 0; i < len; i++) {
+                    if (out[i] != (in[first + i] & mask)) {
+                        printf("%u bits, n=%zu, first=%zu, len=%zu: sample %zu is %u, expected %u\n",
+                               RES_BITS[res], n, first, len, i, out[i], in[first + i] & mask);
+                        errors++;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return errors;
+}
+
+template <class F> static double rate(size_t n, F fn) {
+    size_t samples = 0;
+    auto start = std::chrono::steady_clock::now();
+    double secs = 0.0;
+    do {
+        for (int k = 0; k < 256; k++) {
+            fn();
+            samples += n;
+        }
+        secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (secs < 0.2);
+    return samples / secs;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-n samples]\n", name);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    size_t n = 4096;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n': n = strtoul(optarg, nullptr, 0); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (n == 0) {
+        usage(argv[0]);
+    }
+
+    size_t errors = 0;
+    uint16_t dummy = 0;
+    uint8_t byte = 0;
+    if (an_packed_bytes(5, 4) || an_pack(5, &dummy, 1, &byte) || an_unpack(5, &byte, 0, 1, &dummy)) {
+        printf("invalid resolution accepted\n");
+        errors++;
+    }
+
+    printf("%6s %10s %16s %16s\n", "bits", "round-trip", "pack Msamples/s", "unpack Msamples/s");
+    for (uint32_t res = 0; res < sizeof(RES_BITS); res++) {
+        size_t e = round_trip(res);
+        errors += e;
+
+        std::vector<uint16_t> in(n), out(n);
+        for (size_t i = 0; i < n; i++) {
+            in[i] = (uint16_t)(((uint32_t)i * 2654435761U) >> (32 - RES_BITS[res]));
+        }
+        std::vector<uint8_t> packed(an_packed_bytes(res, n));
+        double p = rate(n, [&] { an_pack(res, in.data(), n, packed.data()); });
+        double u = rate(n, [&] { an_unpack(res, packed.data(), 0, n, out.data()); });
+        if (memcmp(in.data(), out.data(), n * sizeof(uint16_t))) {
+            e++, errors++;
+        }
+        printf("%6u %10s %16.1f %16.1f\n", RES_BITS[res], e ? "FAIL" : "ok", p / 1e6, u / 1e6);
+    }
+    return errors ? 1 : 0;
+}
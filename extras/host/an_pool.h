@@ -0,0 +1,251 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __AN_POOL_H__
+#define __AN_POOL_H__
+
+// Host-side work-stealing thread pool, header only. Every worker owns a job
+// deque: it runs its own jobs newest first, and when it runs out it steals
+// the oldest job of another worker, so long jobs spread over all cores
+// without a shared queue to contend on. Strands run jobs that touch the same
+// state, e.g. one channel of a stateful filter, one at a time and in sequence
+// order, while different strands run in parallel.
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace an {
+
+class Pool {
+  private:
+    typedef std::function<void()> job_t;
+
+    struct worker_t {
+        std::mutex lock;
+        std::deque<job_t> jobs;
+    };
+
+    std::vector<std::unique_ptr<worker_t>> workers;
+    std::vector<std::thread> threads;
+    std::mutex idle_lock;
+    std::condition_variable idle;   // Workers wait here for jobs.
+    std::condition_variable done;   // wait() waits here for pending to reach 0.
+    std::atomic<size_t> queued{0};  // Jobs in the deques.
+    std::atomic<size_t> pending{0}; // Jobs submitted and not finished.
+    std::atomic<size_t> next{0};    // Worker that gets the next outside job.
+    std::atomic<uint64_t> n_stolen{0};
+    bool stop = false;
+
+    // Worker index of the calling thread in this pool, or -1.
+    int self() const {
+        return (current_pool() == this) ? current_worker() : -1;
+    }
+
+    static const Pool *&current_pool() {
+        static thread_local const Pool *pool = nullptr;
+        return pool;
+    }
+
+    static int &current_worker() {
+        static thread_local int worker = -1;
+        return worker;
+    }
+
+    bool take(size_t i, job_t &job) {
+        {
+            worker_t &w = *workers[i];
+            std::lock_guard<std::mutex> guard(w.lock);
+            if (!w.jobs.empty()) {
+                job = std::move(w.jobs.back());
+                w.jobs.pop_back();
+                queued--;
+                return true;
+            }
+        }
+        for (size_t k = 1; k < workers.size(); k++) {
+            worker_t &w = *workers[(i + k) % workers.size()];
+            std::lock_guard<std::mutex> guard(w.lock);
+            if (!w.jobs.empty()) {
+                job = std::move(w.jobs.front());
+                w.jobs.pop_front();
+                queued--;
+                n_stolen++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(size_t i) {
+        current_pool() = this;
+        current_worker() = (int)i;
+        for (;;) {
+            job_t job;
+            if (take(i, job)) {
+                job();
+                if (--pending == 0) {
+                    std::lock_guard<std::mutex> guard(idle_lock);
+                    done.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(idle_lock);
+            idle.wait(guard, [this] { return stop || queued > 0; });
+            if (stop && queued == 0) {
+                return;
+            }
+        }
+    }
+
+  public:
+    // n_threads 0 starts one worker per hardware thread.
+    explicit Pool(size_t n_threads = 0) {
+        if (n_threads == 0) {
+            n_threads = std::thread::hardware_concurrency();
+        }
+        n_threads = n_threads ? n_threads : 1;
+        for (size_t i = 0; i < n_threads; i++) {
+            workers.emplace_back(new worker_t);
+        }
+        for (size_t i = 0; i < n_threads; i++) {
+            threads.emplace_back(&Pool::run, this, i);
+        }
+    }
+
+    Pool(const Pool &) = delete;
+    Pool &operator=(const Pool &) = delete;
+
+    ~Pool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> guard(idle_lock);
+            stop = true;
+        }
+        idle.notify_all();
+        for (std::thread &t : threads) {
+            t.join();
+        }
+    }
+
+    // Queues a job. Jobs submitted from a worker go to its own deque, so a job
+    // that splits its work keeps the pieces local unless others are idle.
+    void submit(job_t job) {
+        int i = self();
+        size_t w = (i >= 0) ? (size_t)i : next++ % workers.size();
+        pending++;
+        {
+            std::lock_guard<std::mutex> guard(workers[w]->lock);
+            workers[w]->jobs.push_back(std::move(job));
+        }
+        queued++;
+        std::lock_guard<std::mutex> guard(idle_lock);
+        idle.notify_one();
+    }
+
+    // Waits until every submitted job, including jobs they submit, has
+    // finished. Must not be called from a job.
+    void wait() {
+        std::unique_lock<std::mutex> guard(idle_lock);
+        done.wait(guard, [this] { return pending == 0; });
+    }
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    // Jobs run by a worker other than the one they were queued on.
+    uint64_t stolen() const {
+        return n_stolen;
+    }
+};
+
+// Runs jobs on a pool one at a time, in sequence order. Jobs can be posted
+// from any thread and out of order, e.g. by parallel decode jobs finishing
+// in any order: a job is held until all jobs with lower sequence numbers have
+// run. Sequence numbers start at 0 and must not skip any value; post() without
+// a sequence number appends, and must not be mixed with explicit numbers.
+class Strand {
+  private:
+    static const size_t BATCH = 16;     // Jobs run before yielding the worker.
+
+    Pool &pool;
+    std::mutex lock;
+    std::map<uint64_t, std::function<void()>> jobs;
+    uint64_t head = 0;      // Sequence number of the next job to run.
+    uint64_t tail = 0;      // Next sequence number given by post(job).
+    bool scheduled = false; // A drain job is queued or running.
+
+    void drain() {
+        for (size_t n = 0; n < BATCH; n++) {
+            std::function<void()> job;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                auto it = jobs.find(head);
+                if (it == jobs.end()) {
+                    scheduled = false;
+                    return;
+                }
+                job = std::move(it->second);
+                jobs.erase(it);
+            }
+            job();
+            std::lock_guard<std::mutex> guard(lock);
+            head++;
+        }
+        // Let other strands have the worker, and carry on from the queue.
+        pool.submit([this] { drain(); });
+    }
+
+  public:
+    explicit Strand(Pool &pool) : pool(pool) {
+    }
+
+    Strand(const Strand &) = delete;
+    Strand &operator=(const Strand &) = delete;
+
+    void post(uint64_t seq, std::function<void()> job) {
+        std::lock_guard<std::mutex> guard(lock);
+        jobs.emplace(seq, std::move(job));
+        if (!scheduled && seq == head) {
+            scheduled = true;
+            pool.submit([this] { drain(); });
+        }
+    }
+
+    void post(std::function<void()> job) {
+        uint64_t seq;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            seq = tail++;
+        }
+        post(seq, std::move(job));
+    }
+};
+
+} // namespace an
+
+#endif // __AN_POOL_H__
@@ -0,0 +1,122 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Replays a capture file through AdvancedReplay and AdvancedMeter on the
+// host, the way a sketch would consume the ADC, and prints per-channel
+// metrics, overruns and the consumer's throughput.
+//
+// Build:  g++ -O2 -std=c++17 -I../../src an_replay.cpp ../../src/AdvancedReplay.cpp ../../src/AdvancedMeter.cpp ../../src/AdvancedPack.cpp ../../src/AdvancedCodec.cpp -o an_replay
+// Usage:  an_replay [-r] [-b buffers] [-i every[:length]] [-w us] file
+//
+//   -r  Replay in real time instead of as fast as possible.
+//   -b  Buffers in the replay queue (default: 4).
+//   -i  Inject overruns: of every `every` buffers, lose the last `length`.
+//   -w  Busy-wait this long per buffer, to emulate a slower consumer.
+//
+// In real time, a consumer that is slower than the recording causes
+// overruns just like on the ADC, and the meter records after each one are
+// flagged. Without -r, the throughput is how fast the consumer can go.
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include "AdvancedReplay.h"
+#include "AdvancedMeter.h"
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-r] [-b buffers] [-i every[:length]] [-w us] file\n", name);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    replay_mode_t mode = AN_REPLAY_FAST;
+    size_t n_buffers = 4;
+    uint32_t every = 0, length = 1, work_us = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "rb:i:w:")) != -1) {
+        char *end;
+        switch (opt) {
+            case 'r': mode = AN_REPLAY_REALTIME; break;
+            case 'b': n_buffers = strtoul(optarg, nullptr, 0); break;
+            case 'i':
+                every = strtoul(optarg, &end, 0);
+                length = (*end == ':') ? strtoul(end + 1, nullptr, 0) : 1;
+                break;
+            case 'w': work_us = strtoul(optarg, nullptr, 0); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind + 1 != argc || n_buffers == 0) {
+        usage(argv[0]);
+    }
+
+    AdvancedReplay replay;
+    if (!replay.begin(argv[optind], n_buffers, mode)) {
+        fprintf(stderr, "%s: can't replay\n", argv[optind]);
+        return 1;
+    }
+    replay.inject(every, length);
+
+    size_t n_ch = replay.channels();
+    AdvancedMeter meter(n_ch, AN_METER_DC_BLOCK);
+    std::vector<double> mean(n_ch, 0.0), rms(n_ch, 0.0);
+    std::vector<uint16_t> peak(n_ch, 0);
+    uint32_t buffers = 0, discont = 0, late = 0;
+    uint32_t last_ts = 0;
+    uint64_t frames = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (!replay.done()) {
+        SampleBuffer buf = replay.read();
+        if (!buf) {
+            break;
+        }
+        meter_record_t rec;
+        if (meter.process(buf, rec)) {
+            for (size_t ch = 0; ch < n_ch; ch++) {
+                mean[ch] += rec.ch[ch].mean;
+                rms[ch] += rec.ch[ch].rms;
+                peak[ch] = (rec.ch[ch].peak > peak[ch]) ? rec.ch[ch].peak : peak[ch];
+            }
+            discont += (rec.flags & AN_METER_DISCONT) ? 1 : 0;
+            // Timestamps must advance by at least one buffer.
+            late += (buffers && (int32_t)(rec.timestamp - last_ts) <= 0) ? 1 : 0;
+            last_ts = rec.timestamp;
+            frames += rec.n_frames;
+            buffers++;
+        }
+        buf.release();
+        for (uint32_t t0 = micros(); micros() - t0 < work_us;) {
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("buffers:      %u read, %u replayed, %u lost\n", buffers, replay.replayed(), replay.dropped());
+    printf("discont:      %u\n", discont);
+    printf("timestamps:   %s\n", late ? "out of order" : "ok");
+    printf("throughput:   %.0f frames/s (%.1fx the recorded rate)\n", frames / secs,
+           frames / secs / replay.rate());
+    printf("%4s %10s %10s %8s\n", "ch", "mean", "rms", "peak");
+    for (size_t ch = 0; ch < n_ch; ch++) {
+        printf("%4zu %10.1f %10.1f %8u\n", ch, buffers ? mean[ch] / buffers : 0.0,
+               buffers ? rms[ch] / buffers : 0.0, peak[ch]);
+    }
+    replay.end();
+    return late ? 1 : 0;
+}
@@ -0,0 +1,197 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Measures the SNR and throughput of AdvancedResampler on the host.
+//
+// Build:  g++ -O2 -std=c++17 -I../../src an_resample_bench.cpp ../../src/AdvancedResampler.cpp -o an_resample_bench
+// Usage:  an_resample_bench [-r resolution] [-t taps] [-c channels]
+//
+//   -r  AN_RESOLUTION_x of the test signal, 0 to 4 (default: 2, 12 bits).
+//   -t  Taps per phase (default: 16).
+//   -c  Channels for the throughput test (default: 4).
+//
+// For each rate pair, a full-scale sine at 10% of the lower Nyquist frequency
+// (in band for both rates) is resampled, and the output is compared with the
+// best-fitting sine at the output rate; the outputs within 2 * taps input
+// samples (taps as scaled for decimation) of either end are skipped. The quantization SNR of the input resolution is printed for
+// reference (6.02 * bits + 1.76 dB).
+//
+// When decimating, a full-scale sine at 75% of the output rate (above its
+// Nyquist frequency, below 90% of the input's) is resampled too, and the
+// level of its alias at 25% of the output rate is reported in dB relative to
+// the input tone. Throughput is in input frames per second
+// of host time, so only relative numbers carry over to the target.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include "AdvancedResampler.h"
+
+static const uint8_t RES_BITS[] = {8, 10, 12, 14, 16};
+
+// Best least-squares fit of a sine of frequency w (radians per sample) plus
+// DC to y; returns the SNR in dB of y against it, and its amplitude.
+static double fit(const std::vector<double> &y, double w, double *amplitude) {
+    double s[4][4] = {}, r[4] = {};
+    for (size_t n = 0; n < y.size(); n++) {
+        double b[3] = {sin(w * n), cos(w * n), 1.0};
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                s[i][j] += b[i] * b[j];
+            }
+            r[i] += b[i] * y[n];
+        }
+    }
+    // Solve the 3x3 normal equations by Gaussian elimination.
+    for (int i = 0; i < 3; i++) {
+        for (int k = i + 1; k < 3; k++) {
+            double f = s[k][i] / s[i][i];
+            for (int j = i; j < 3; j++) {
+                s[k][j] -= f * s[i][j];
+            }
+            r[k] -= f * r[i];
+        }
+    }
+    double c[3];
+    for (int i = 2; i >= 0; i--) {
+        c[i] = r[i];
+        for (int j = i + 1; j < 3; j++) {
+            c[i] -= s[i][j] * c[j];
+        }
+        c[i] /= s[i][i];
+    }
+    double sig = 0.0, err = 0.0;
+    for (size_t n = 0; n < y.size(); n++) {
+        double fit = c[0] * sin(w * n) + c[1] * cos(w * n);
+        sig += fit * fit;
+        err += (y[n] - fit - c[2]) * (y[n] - fit - c[2]);
+    }
+    *amplitude = sqrt(c[0] * c[0] + c[1] * c[1]);
+    return 10.0 * log10(sig / (err > 0.0 ? err : 1e-30));
+}
+
+// Resamples a 95% full-scale sine of frequency f and fits a sine of
+// frequency f_out to the output; returns the SNR, and the fitted amplitude
+// relative to the input's.
+static double tone(uint32_t res, size_t taps, uint32_t in_rate, uint32_t out_rate, double f, double f_out,
+                   double *gain) {
+    const uint32_t max_code = (1UL << RES_BITS[res]) - 1;
+    const size_t n_in = 16384;
+    std::vector<Sample> in(n_in);
+    for (size_t n = 0; n < n_in; n++) {
+        double v = (max_code / 2.0) * (1.0 + 0.95 * sin(2.0 * M_PI * f * n / in_rate));
+        in[n] = (Sample)lround(v);
+    }
+
+    AdvancedResampler rs(1, in_rate, out_rate, res, taps);
+    std::vector<Sample> out(rs.frames(n_in));
+    size_t n_out = rs.process(in.data(), n_in, out.data(), out.size());
+    // Skip the filter's start and end transients, 2 * taps input samples long
+    // (taps as scaled for decimation).
+    size_t skip = (size_t)ceil(4.0 * rs.latency() * out_rate / in_rate);
+    std::vector<double> y;
+    for (size_t n = skip; n + skip < n_out; n++) {
+        y.push_back(out[n]);
+    }
+    double a;
+    double s = fit(y, 2.0 * M_PI * f_out / out_rate, &a);
+    *gain = a / (0.95 * max_code / 2.0);
+    return s;
+}
+
+static double snr(uint32_t res, size_t taps, uint32_t in_rate, uint32_t out_rate) {
+    double f = 0.1 * 0.5 * (in_rate < out_rate ? in_rate : out_rate);
+    double gain;
+    return tone(res, taps, in_rate, out_rate, f, f, &gain);
+}
+
+// Alias level in dB of an out-of-band tone, or NAN if the input can't carry one.
+static double alias(uint32_t res, size_t taps, uint32_t in_rate, uint32_t out_rate) {
+    double f = 0.75 * out_rate;
+    if (f >= 0.45 * in_rate) {
+        return NAN;
+    }
+    double gain;
+    tone(res, taps, in_rate, out_rate, f, out_rate - f, &gain);
+    return 20.0 * log10(gain > 1e-9 ? gain : 1e-9);
+}
+
+static double throughput(uint32_t res, size_t taps, size_t n_ch, uint32_t in_rate, uint32_t out_rate) {
+    const size_t n_frames = 256;
+    std::vector<Sample> in(n_frames * n_ch);
+    for (size_t i = 0; i < in.size(); i++) {
+        in[i] = (Sample)((i * 2654435761U) >> (32 - RES_BITS[res]));
+    }
+    AdvancedResampler rs(n_ch, in_rate, out_rate, res, taps);
+    std::vector<Sample> out(rs.frames(n_frames) * n_ch);
+    size_t frames = 0;
+    auto start = std::chrono::steady_clock::now();
+    double secs = 0.0;
+    do {
+        for (int k = 0; k < 256; k++) {
+            rs.process(in.data(), n_frames, out.data(), out.size() / n_ch);
+            frames += n_frames;
+        }
+        secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (secs < 0.2);
+    return frames / secs;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-r resolution] [-t taps] [-c channels]\n", name);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    uint32_t res = AN_RESOLUTION_12;
+    size_t taps = 16;
+    size_t n_ch = 4;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:t:c:")) != -1) {
+        switch (opt) {
+            case 'r': res = strtoul(optarg, nullptr, 0); break;
+            case 't': taps = strtoul(optarg, nullptr, 0); break;
+            case 'c': n_ch = strtoul(optarg, nullptr, 0); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (res >= sizeof(RES_BITS) || n_ch == 0 || n_ch > AN_MAX_ADC_CHANNELS) {
+        usage(argv[0]);
+    }
+
+    static const uint32_t rates[][2] = {
+        {48000, 44100}, {44100, 48000}, {16000, 8000}, {48000, 16000}, {10000, 1000}, {1000, 10000},
+        {100000, 3000}, {16000, 16001},
+    };
+    printf("resolution %u bits, %zu taps, quantization SNR %.1f dB\n", RES_BITS[res], taps,
+           6.02 * RES_BITS[res] + 1.76);
+    printf("%8s -> %-8s %9s %9s %16s\n", "in Hz", "out Hz", "SNR dB", "alias dB", "Mframes/s");
+    for (auto &r : rates) {
+        double a = alias(res, taps, r[0], r[1]);
+        char a_text[16] = "-";
+        if (!isnan(a)) {
+            snprintf(a_text, sizeof(a_text), "%.1f", a);
+        }
+        printf("%8u -> %-8u %9.1f %9s %16.2f\n", r[0], r[1], snr(res, taps, r[0], r[1]), a_text,
+               throughput(res, taps, n_ch, r[0], r[1]) / 1e6);
+    }
+    return 0;
+}
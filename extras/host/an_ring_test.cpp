@@ -0,0 +1,186 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Tests the AdvancedRing protocol on the host, with a producer and a
+// consumer thread sharing one ring, as the two cores do on the target.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -I../../src an_ring_test.cpp ../../src/AdvancedRing.cpp -o an_ring_test
+// Usage:  an_ring_test [-n buffers] [-r rate] [-c channels] [-s samples] [-m bytes] [-p period]
+//
+//   -n  Buffers the producer offers (default: 200000).
+//   -r  Buffers per second the producer offers, 0 for as fast as it can
+//       (default: 200000).
+//   -c  Channels per buffer (default: 4).
+//   -s  Samples per channel per buffer (default: 64).
+//   -m  Shared memory size in bytes (default: 16384).
+//   -p  The consumer stalls for about 200 us every this many buffers, so
+//       the ring fills up and drops (default: 1000, 0 to never stall).
+//
+// The producer fills every sample with a pattern derived from the slot's
+// sequence number, and the consumer checks it, so a slot that is read
+// before it's published, or reused before it's consumed, shows up as torn.
+// Sequence numbers must increase by one, except after a slot flagged
+// AN_RING_DISCONT, and the gaps must add up to the drops the producer
+// reports. Build with -fsanitize=thread to also check the memory ordering.
+// Exits with status 1 on any error.
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "AdvancedRing.h"
+
+static uint16_t pattern(uint32_t sequence, size_t i) {
+    return (uint16_t)(sequence * 40503U + i * 7U);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-n buffers] [-r rate] [-c channels] [-s samples] [-m bytes] [-p period]\n", name);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    uint32_t n_buffers = 200000;
+    double rate = 200000.0;
+    size_t n_ch = 4;
+    size_t n_samples = 64;
+    size_t mem_bytes = 16384;
+    uint32_t stall = 1000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:c:s:m:p:")) != -1) {
+        switch (opt) {
+            case 'n': n_buffers = strtoul(optarg, nullptr, 0); break;
+            case 'r': rate = strtod(optarg, nullptr); break;
+            case 'c': n_ch = strtoul(optarg, nullptr, 0); break;
+            case 's': n_samples = strtoul(optarg, nullptr, 0); break;
+            case 'm': mem_bytes = strtoul(optarg, nullptr, 0); break;
+            case 'p': stall = strtoul(optarg, nullptr, 0); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (n_buffers == 0 || n_ch == 0 || n_samples == 0) {
+        usage(argv[0]);
+    }
+
+    mem_bytes = (mem_bytes + AN_RING_LINE - 1) & ~(size_t)(AN_RING_LINE - 1);
+    void *mem = aligned_alloc(AN_RING_LINE, mem_bytes);
+    if (mem == nullptr || an_ring_init(mem, mem_bytes, n_ch, n_samples, 1000.0f) == nullptr) {
+        fprintf(stderr, "%zu bytes can't hold 2 slots of %zu x %zu samples\n", mem_bytes, n_ch, n_samples);
+        return 2;
+    }
+    const size_t n = n_ch * n_samples;
+    std::atomic<bool> attached{false};
+    std::atomic<bool> done{false};
+    uint32_t produced = 0;
+
+    // The producer offers buffers at a fixed rate once the consumer is there,
+    // and never waits: a full ring drops the buffer, like the ADC.
+    std::thread producer([&] {
+        ring_header_t *ring = (ring_header_t *)mem;
+        while (!attached.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        for (uint32_t k = 0; k < n_buffers; k++) {
+            if (rate > 0.0) {
+                auto due = t0 + std::chrono::duration<double>(k / rate);
+                while (std::chrono::steady_clock::now() < due) {
+                    std::this_thread::yield();
+                }
+            }
+            ring_slot_t *slot = an_ring_reserve(ring);
+            if (slot == nullptr) {
+                continue;
+            }
+            uint16_t *s = an_ring_samples(slot);
+            for (size_t i = 0; i < n; i++) {
+                s[i] = pattern(slot->sequence, i);
+            }
+            slot->timestamp = slot->sequence;
+            an_ring_publish(ring);
+            produced++;
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    uint32_t consumed = 0, gaps = 0, discont = 0, torn = 0, order = 0, dropped = 0;
+    std::thread consumer([&] {
+        ring_header_t *ring;
+        while ((ring = an_ring_attach(mem, mem_bytes)) == nullptr) {
+            std::this_thread::yield();
+        }
+        attached.store(true, std::memory_order_release);
+        uint32_t expect = 0;
+        for (;;) {
+            // Check done before peeking, so nothing published before it is missed.
+            bool last = done.load(std::memory_order_acquire);
+            const ring_slot_t *slot = an_ring_peek(ring);
+            if (slot == nullptr) {
+                if (last) {
+                    break;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+            if (slot->sequence != expect) {
+                if (!(slot->flags & AN_RING_DISCONT) || (int32_t)(slot->sequence - expect) < 0) {
+                    order++;
+                }
+                gaps += slot->sequence - expect;
+            }
+            discont += (slot->flags & AN_RING_DISCONT) ? 1 : 0;
+            const uint16_t *s = an_ring_samples(slot);
+            for (size_t i = 0; i < n; i++) {
+                if (s[i] != pattern(slot->sequence, i)) {
+                    torn++;
+                    break;
+                }
+            }
+            torn += (slot->timestamp != slot->sequence) ? 1 : 0;
+            expect = slot->sequence + 1;
+            an_ring_consume(ring);
+            consumed++;
+            if (stall && consumed % stall == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+        // Buffers dropped at the very end never reach a slot.
+        dropped = an_ring_dropped(ring);
+        gaps += ring->sequence - expect;
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    producer.join();
+    consumer.join();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ring_header_t *ring = (ring_header_t *)mem;
+
+    size_t errors = torn + order;
+    errors += (consumed != produced) || (produced + dropped != n_buffers) || (gaps != dropped);
+    printf("slots:        %u of %u bytes\n", ring->n_slots, ring->slot_bytes);
+    printf("buffers:      %u offered, %u published, %u consumed, %u dropped\n", n_buffers, produced, consumed,
+           dropped);
+    printf("sequence:     %u gaps totalling %u, %u out of order\n", discont, gaps, order);
+    printf("payload:      %u torn\n", torn);
+    printf("throughput:   %.2f Mbuffers/s\n", consumed / secs / 1e6);
+    printf("%s\n", errors ? "FAIL" : "ok");
+    free(mem);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __AN_STREAM_H__
+#define __AN_STREAM_H__
+
+// Host-side parser for the frames sent by AdvancedStream, header only. Needs
+// AdvancedFrame.cpp, AdvancedPack.cpp and AdvancedCodec.cpp to be linked in.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+#include "AdvancedFrame.h"
+
+namespace an {
+
+struct stream_stats_t {
+    uint64_t frames = 0;        // Frames with a valid CRC.
+    uint64_t bytes = 0;         // Bytes fed to the parser.
+    uint64_t crc_errors = 0;    // Frames rejected by the CRC check.
+    uint64_t resync_bytes = 0;  // Bytes skipped while looking for a frame.
+    uint64_t lost = 0;          // Frames missing from the sequence.
+    uint64_t restarts = 0;      // Sequence jumps back, e.g. the device was reset.
+    uint64_t discont = 0;       // Frames flagged AN_FRAME_DISCONT.
+};
+
+// Accumulates input and calls on_frame(const frame_header_t &, const uint8_t *payload)
+// for every valid frame. Input is read straight into the parser's buffer with
+// space()/commit(), and frames are handed out in place, without copying.
+class FrameParser {
+  private:
+    std::vector<uint8_t> buf;
+    size_t head = 0;    // First unparsed byte.
+    size_t tail = 0;    // End of valid data.
+    bool have_seq = false;
+    uint32_t next_seq = 0;
+
+  public:
+    stream_stats_t stats;
+    uint32_t gap = 0;   // Frames lost just before the frame being handed out.
+    bool restart = false;   // The sequence restarted at the frame being handed out.
+
+    explicit FrameParser(size_t capacity = 1 << 20) : buf(capacity) {
+    }
+
+    // Returns a pointer to at least min_bytes of free space.
+    uint8_t *space(size_t &len, size_t min_bytes = 4096) {
+        if (buf.size() - tail < min_bytes) {
+            // Move the unparsed tail to the front, then grow if still short.
+            memmove(buf.data(), buf.data() + head, tail - head);
+            tail -= head;
+            head = 0;
+            if (buf.size() - tail < min_bytes) {
+                buf.resize(tail + min_bytes);
+            }
+        }
+        len = buf.size() - tail;
+        return buf.data() + tail;
+    }
+
+    template <typename F> void commit(size_t len, F on_frame) {
+        tail += len;
+        stats.bytes += len;
+        while (tail - head >= AN_FRAME_HEADER_SIZE) {
+            const uint8_t *p = buf.data() + head;
+            if (p[0] != AN_FRAME_SYNC0 || p[1] != AN_FRAME_SYNC1 || p[2] != AN_FRAME_VERSION) {
+                head++;
+                stats.resync_bytes++;
+                continue;
+            }
+            frame_header_t hdr;
+            memcpy(&hdr, p, sizeof(hdr));
+            if (!an_frame_check(&hdr)) {
+                // Inconsistent fields, this was not a real header.
+                head++;
+                stats.resync_bytes++;
+                continue;
+            }
+            size_t total = AN_FRAME_HEADER_SIZE + hdr.payload_bytes + AN_FRAME_TRAILER_SIZE;
+            if (tail - head < total) {
+                if (buf.size() < total) {
+                    buf.resize(total + head);
+                }
+                break;
+            }
+            uint32_t crc;
+            memcpy(&crc, p + total - AN_FRAME_TRAILER_SIZE, sizeof(crc));
+            if (an_crc32(0, p, total - AN_FRAME_TRAILER_SIZE) != crc) {
+                head++;
+                stats.crc_errors++;
+                stats.resync_bytes++;
+                continue;
+            }
+            // Frames arrive in order, so a step back means the sender
+            // restarted its sequence (e.g. after a reset), not 4 billion losses.
+            int32_t step = have_seq ? (int32_t)(hdr.sequence - next_seq) : 0;
+            restart = step < 0;
+            gap = restart ? 0 : (uint32_t)step;
+            stats.lost += gap;
+            stats.restarts += restart;
+            have_seq = true;
+            next_seq = hdr.sequence + 1;
+            if (hdr.flags & AN_FRAME_DISCONT) {
+                stats.discont++;
+            }
+            stats.frames++;
+            on_frame(hdr, p + AN_FRAME_HEADER_SIZE);
+            head += total;
+        }
+    }
+};
+
+} // namespace an
+
+#endif // __AN_STREAM_H__
@@ -20,6 +20,7 @@
 #include "AdvancedADC.h"
 #include "Arduino.h"
 #include "HALConfig.h"
+#include "mbed.h"
 
 #define ADC_NP ((ADCName)NC)
 #define ADC_PIN_ALT_MASK (uint32_t)(ALT0 | ALT1)
@@ -32,8 +33,13 @@ struct adc_descr_t {
     uint32_t tim_trig;
     DMAPool<Sample> *pool;
     DMABuffer<Sample> *dmabuf[2];
+    void (*ready_fn)(void *arg);
+    void *ready_arg;
 };
 
+// One flag per ADC, set by the DMA interrupt when a buffer is ready.
+static rtos::EventFlags adc_events;
+
 static uint32_t adc_pin_alt[3] = {0, ALT0, ALT1};
 
 static adc_descr_t adc_descr_all[3] = {
@@ -97,6 +103,9 @@ static void adc_descr_deinit(adc_descr_t *descr) {
             }
         }
 
+        // Remove the ready callback
+        descr->ready_fn = nullptr;
+
         // Deallocate buffer pool
         if (descr->pool) {
             delete descr->pool;
@@ -126,13 +135,42 @@ bool AdvancedADC::available() {
     return false;
 }
 
+bool AdvancedADC::writable() {
+    // Without a pool there's no completion to make room for.
+    if (descr != nullptr && descr->pool != nullptr) {
+        return descr->pool->writable();
+    }
+    return true;
+}
+
+bool AdvancedADC::wait(uint32_t timeout_ms) {
+    if (descr == nullptr) {
+        return false;
+    }
+    uint32_t flag = 1U << (descr - adc_descr_all);
+    while (!available()) {
+        // Clear, then check again, so a buffer that completed in between isn't missed.
+        adc_events.clear(flag);
+        if (available()) {
+            break;
+        }
+        uint32_t ret = (timeout_ms == AN_WAIT_FOREVER) ? adc_events.wait_any(flag)
+                       : adc_events.wait_any_for(flag, rtos::Kernel::Clock::duration_u32(timeout_ms));
+        if (ret & osFlagsError) {
+            return available();
+        }
+    }
+    return true;
+}
+
 SampleBuffer AdvancedADC::read() {
     static DMABuffer<Sample> NULLBUF;
-    if (descr != nullptr) {
-        while (!available()) {
-            __WFI();
+    // wait() fails from an interrupt or before the kernel runs, if no buffer is ready.
+    if (descr != nullptr && wait()) {
+        DMABuffer<Sample> *buf = descr->pool->alloc(DMA_BUFFER_READ);
+        if (buf != nullptr) {
+            return *buf;
         }
-        return *descr->pool->alloc(DMA_BUFFER_READ);
     }
     return NULLBUF;
 }
@@ -236,6 +274,10 @@ bool AdvancedADC::begin(uint32_t resolution, uint32_t sample_rate, size_t n_samp
         return false;
     }
 
+    // Install the ready callback, if one was set before begin().
+    descr->ready_arg = ready_arg;
+    descr->ready_fn = ready_fn;
+
     // Allocate the two DMA buffers used for double buffering.
     descr->dmabuf[0] = descr->pool->alloc(DMA_BUFFER_WRITE);
     descr->dmabuf[1] = descr->pool->alloc(DMA_BUFFER_WRITE);
@@ -246,6 +288,7 @@ bool AdvancedADC::begin(uint32_t resolution, uint32_t sample_rate, size_t n_samp
     }
 
     // Init and config ADC.
+    adc_sample_time = sample_time;
     if (!hal_adc_config(&descr->adc, ADC_RES_LUT[resolution], descr->tim_trig, adc_pins, n_channels, sample_time)) {
         return false;
     }
@@ -260,6 +303,18 @@ bool AdvancedADC::begin(uint32_t resolution, uint32_t sample_rate, size_t n_samp
     return true;
 }
 
+void AdvancedADC::onReady(void (*fn)(void *arg), void *arg) {
+    ready_fn = fn;
+    ready_arg = arg;
+    if (descr != nullptr && descr->pool != nullptr) {
+        // Keep the interrupt from seeing a half-updated pair.
+        HAL_NVIC_DisableIRQ(descr->dma_irqn);
+        descr->ready_fn = fn;
+        descr->ready_arg = arg;
+        HAL_NVIC_EnableIRQ(descr->dma_irqn);
+    }
+}
+
 bool AdvancedADC::start(uint32_t sample_rate) {
     if (descr == nullptr || descr->pool == nullptr) {
         // ADC not initialized, call begin() first
@@ -327,12 +382,16 @@ Sample AdvancedADC::analogRead(size_t channel) {
         return 0;
     }
 
-    while (!available()) {
-        // Wait for the DMA buffer to be ready
-        __WFI();
+    // Wait for the DMA buffer to be ready; wait() fails from an interrupt or
+    // before the kernel runs, if no buffer is ready.
+    if (!wait()) {
+        return 0;
     }
 
     SampleBuffer buf = read();
+    if (!buf) {
+        return 0;
+    }
     Sample value = buf[channel];
 
     Serial.print("analogRead value: ");
@@ -353,6 +412,13 @@ size_t AdvancedADC::channels() {
     return n_channels;
 }
 
+float AdvancedADC::rate() {
+    if (descr == nullptr || descr->pool == nullptr) {
+        return 0.0f;
+    }
+    return hal_tim_rate(&descr->tim);
+}
+
 AdvancedADC::~AdvancedADC() {
     adc_descr_deinit(descr);
 }
@@ -422,6 +488,11 @@ void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *adc) {
         descr->dmabuf[ct]->invalidate();
         // Move current DMA buffer to ready queue.
         descr->dmabuf[ct]->release();
+        // Wake up any thread waiting for it.
+        adc_events.set(1U << (descr - adc_descr_all));
+        if (descr->ready_fn) {
+            descr->ready_fn(descr->ready_arg);
+        }
         // Allocate a new free buffer.
         descr->dmabuf[ct] = descr->pool->alloc(DMA_BUFFER_WRITE);
         // Currently, all multi-channel buffers are interleaved.
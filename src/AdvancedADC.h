@@ -22,6 +22,8 @@
 
 #include "AdvancedAnalog.h"
 
+#define AN_WAIT_FOREVER         (0xFFFFFFFFU)
+
 struct adc_descr_t;
 
 /**
@@ -54,7 +56,10 @@ class AdvancedADC {
     size_t n_channels;
     adc_descr_t *descr;
     int adc_index;
+    adc_sample_time_t adc_sample_time;
     PinName adc_pins[AN_MAX_ADC_CHANNELS];
+    void (*ready_fn)(void *arg);
+    void *ready_arg;
 
   public:
     /**
@@ -67,7 +72,8 @@ class AdvancedADC {
      * The ADC number must be specified along with the channels to use.
      */
     template <typename... T>
-    AdvancedADC(int adc_num, PinName p0, T... args) : n_channels(0), descr(nullptr), adc_index(-1) {
+    AdvancedADC(int adc_num, PinName p0, T... args) : n_channels(0), descr(nullptr), adc_index(-1),
+        adc_sample_time(AN_ADC_SAMPLETIME_8_5), ready_fn(nullptr), ready_arg(nullptr) {
         static_assert(sizeof...(args) < AN_MAX_ADC_CHANNELS,
                       "A maximum of 16 channels can be sampled successively.");
 
@@ -93,7 +99,8 @@ class AdvancedADC {
      * Creates an AdvancedADC object without specifying ADC or channels.
      * ADC and channels must be configured later using setADC() and begin() methods.
      */
-    AdvancedADC() : n_channels(0), descr(nullptr), adc_index(-1) {
+    AdvancedADC() : n_channels(0), descr(nullptr), adc_index(-1),
+        adc_sample_time(AN_ADC_SAMPLETIME_8_5), ready_fn(nullptr), ready_arg(nullptr) {
         // Initialize the array elements
         for (size_t i = 0; i < AN_MAX_ADC_CHANNELS; ++i) {
             adc_pins[i] = NC;
@@ -109,9 +116,9 @@ class AdvancedADC {
 
     /**
      * @brief Get the ADC instance ID
-     * @return ADC instance ID (0-2 for ADC1-ADC3, or -1 if not set)
+     * @return ADC instance ID (1-3 for ADC1-ADC3, or -1 if not set)
      *
-     * Returns the zero-based index of the ADC instance being used.
+     * Returns the number of the ADC instance being used.
      */
     int id();
 
@@ -123,12 +130,46 @@ class AdvancedADC {
      */
     bool available();
 
+    /**
+     * @brief Check if a free buffer is left for the next completion
+     * @return true if the pool has a free buffer or the ADC isn't initialized, false otherwise
+     *
+     * When this is false, the next completed buffer can't be queued: the DMA
+     * reuses it and the next buffer read is flagged DMA_BUFFER_DISCONT.
+     * Release buffers to avoid it.
+     */
+    bool writable();
+
+    /**
+     * @brief Wait for sample data
+     * @param timeout_ms Maximum time to wait in ms (default: AN_WAIT_FOREVER)
+     * @return true if sample data is available to read, false on timeout
+     *
+     * Blocks the calling thread on an RTOS event set by the DMA interrupt,
+     * so other threads run until a buffer completes. Must not be called
+     * from an interrupt handler.
+     */
+    bool wait(uint32_t timeout_ms = AN_WAIT_FOREVER);
+
+    /**
+     * @brief Set a function to call when a sample buffer is ready
+     * @param fn Function called from the DMA interrupt, or nullptr to remove it
+     * @param arg Argument passed to the function (default: nullptr)
+     *
+     * The function runs in interrupt context right after the buffer is
+     * queued, so it must be short and must not block; use it to hand the
+     * work to a thread, e.g. with AdvancedWorkQueue.
+     */
+    void onReady(void (*fn)(void *arg), void *arg = nullptr);
+
     /**
      * @brief Read a sample buffer
-     * @return SampleBuffer containing the sampled data
+     * @return SampleBuffer containing the sampled data, or an empty buffer if
+     * the ADC isn't running or wait() failed
      *
      * Reads and returns the next available sample buffer from the ADC queue.
-     * Call available() first to check if data is ready.
+     * If none is available yet, this blocks the calling thread until one is,
+     * see wait().
      */
     SampleBuffer read();
 
@@ -223,6 +264,32 @@ class AdvancedADC {
      */
     size_t channels();
 
+    /**
+     * @brief Get the achieved sample rate
+     * @return Sample rate in Hz, or 0 if the ADC is not running
+     *
+     * The timer divides its clock by integers, so this can differ slightly
+     * from the rate passed to begin() or start().
+     */
+    float rate();
+
+    /**
+     * @brief Get the configured sampling time
+     * @return ADC sampling time
+     */
+    adc_sample_time_t sampleTime() {
+        return adc_sample_time;
+    }
+
+    /**
+     * @brief Get the pin sampled on a channel
+     * @param channel Channel number
+     * @return Pin name, or NC if the channel is not configured
+     */
+    PinName pin(size_t channel) {
+        return (channel < n_channels) ? adc_pins[channel] : NC;
+    }
+
     /**
      * @brief Read a single sample from a specific channel
      * @param channel Channel number to read from (default: 0)
@@ -20,9 +20,210 @@
 #ifndef __ADVANCED_ANALOG_H__
 #define __ADVANCED_ANALOG_H__
 
+#if defined(ARDUINO)
 #include "Arduino.h"
 #include "api/DMAPool.h"
 #include "pinDefinitions.h"
+#else
+// Host build (replay and offline reprocessing, see extras/host): the
+// processing stages only need the buffer interface, so a plain buffer over
+// caller memory stands in for the DMA pool buffers. A single-threaded pool
+// with the same queues as the core's, and micros(), are enough for
+// AdvancedReplay; the write() half of Print is enough for AdvancedCSV.
+#include <math.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef PI
+#define PI                      (3.1415926535897932384626433832795)
+#endif
+#define __DMB()                 __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+static inline void yield() {
+    sched_yield();
+}
+
+static inline void delay(unsigned long ms) {
+    usleep(ms * 1000);
+}
+
+// Wraps at 32 bits, like on the target.
+static inline uint32_t micros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+class Print {
+  public:
+    virtual ~Print() {
+    }
+
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+        size_t n = 0;
+        while (size-- && write(*buffer++)) {
+            n++;
+        }
+        return n;
+    }
+};
+
+enum {
+    DMA_BUFFER_READ     = (1 << 0),
+    DMA_BUFFER_WRITE    = (1 << 1),
+    DMA_BUFFER_DISCONT  = (1 << 2),
+    DMA_BUFFER_INTRLVD  = (1 << 3),
+};
+
+template <class T> class DMAPool;
+
+template <class T> class DMABuffer {
+  private:
+    DMAPool<T> *pool;
+    T *ptr;
+    size_t n_samples;
+    size_t n_channels;
+    uint32_t ts;
+    uint32_t flags;
+
+  public:
+    DMABuffer(T *mem = nullptr, size_t samples = 0, size_t channels = 1, DMAPool<T> *pool = nullptr) :
+        pool(pool), ptr(mem), n_samples(samples), n_channels(channels), ts(0), flags(0) {
+    }
+
+    T *data() {
+        return ptr;
+    }
+
+    size_t size() {
+        return n_samples;
+    }
+
+    size_t bytes() {
+        return n_samples * sizeof(T);
+    }
+
+    size_t channels() {
+        return n_channels;
+    }
+
+    uint32_t timestamp() {
+        return ts;
+    }
+
+    void timestamp(uint32_t ts) {
+        this->ts = ts;
+    }
+
+    uint32_t get_flags(uint32_t mask = 0xFFFFFFFFU) {
+        return flags & mask;
+    }
+
+    void set_flags(uint32_t mask) {
+        flags |= mask;
+    }
+
+    void clr_flags(uint32_t mask = 0xFFFFFFFFU) {
+        flags &= ~mask;
+    }
+
+    void release() {
+        if (pool && ptr) {
+            pool->free(this);
+        }
+    }
+
+    T &operator[](size_t i) {
+        return ptr[i];
+    }
+
+    operator bool() const {
+        return ptr != nullptr;
+    }
+};
+
+template <class T> class DMAPool {
+  private:
+    T *mem;
+    DMABuffer<T> *buffers;
+    DMABuffer<T> **wr_q;    // Free buffers, for the producer.
+    DMABuffer<T> **rd_q;    // Filled buffers, for the consumer.
+    size_t n_buffers;
+    size_t wr_head, wr_count;
+    size_t rd_head, rd_count;
+
+    static void push(DMABuffer<T> **q, size_t head, size_t &count, size_t size, DMABuffer<T> *buf) {
+        q[(head + count++) % size] = buf;
+    }
+
+    static DMABuffer<T> *pop(DMABuffer<T> **q, size_t &head, size_t &count, size_t size) {
+        if (count == 0) {
+            return nullptr;
+        }
+        DMABuffer<T> *buf = q[head];
+        head = (head + 1) % size;
+        count--;
+        return buf;
+    }
+
+  public:
+    DMAPool(size_t n_samples, size_t n_channels, size_t n_buffers) :
+        mem(new T[n_samples * n_channels * n_buffers]), buffers(new DMABuffer<T>[n_buffers]),
+        wr_q(new DMABuffer<T> *[n_buffers]), rd_q(new DMABuffer<T> *[n_buffers]), n_buffers(n_buffers),
+        wr_head(0), wr_count(0), rd_head(0), rd_count(0) {
+        for (size_t i = 0; i < n_buffers; i++) {
+            buffers[i] = DMABuffer<T>(&mem[i * n_samples * n_channels], n_samples * n_channels, n_channels, this);
+            push(wr_q, wr_head, wr_count, n_buffers, &buffers[i]);
+        }
+    }
+
+    DMAPool(const DMAPool &) = delete;
+    DMAPool &operator=(const DMAPool &) = delete;
+
+    ~DMAPool() {
+        delete[] rd_q;
+        delete[] wr_q;
+        delete[] buffers;
+        delete[] mem;
+    }
+
+    bool writable() {
+        return wr_count > 0;
+    }
+
+    bool readable() {
+        return rd_count > 0;
+    }
+
+    DMABuffer<T> *alloc(uint32_t flag) {
+        DMABuffer<T> *buf = (flag & DMA_BUFFER_READ) ? pop(rd_q, rd_head, rd_count, n_buffers)
+                                                     : pop(wr_q, wr_head, wr_count, n_buffers);
+        if (buf) {
+            buf->clr_flags(DMA_BUFFER_READ | DMA_BUFFER_WRITE);
+            buf->set_flags(flag);
+        }
+        return buf;
+    }
+
+    // A buffer allocated for writing goes to the consumer, one allocated for
+    // reading goes back to the producer.
+    void free(DMABuffer<T> *buf, uint32_t flags = 0) {
+        flags = flags ? flags : buf->get_flags();
+        if (flags & DMA_BUFFER_READ) {
+            push(wr_q, wr_head, wr_count, n_buffers, buf);
+        } else if (flags & DMA_BUFFER_WRITE) {
+            push(rd_q, rd_head, rd_count, n_buffers, buf);
+        }
+    }
+};
+#endif
 
 enum {
     AN_RESOLUTION_8  = 0U,
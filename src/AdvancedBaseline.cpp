@@ -0,0 +1,134 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedBaseline.h"
+
+AdvancedBaseline::AdvancedBaseline(size_t n_channels, uint32_t threshold, uint32_t shift, uint32_t holdoff) :
+    n_channels(n_channels) {
+    if (this->n_channels > AN_MAX_ADC_CHANNELS) {
+        this->n_channels = AN_MAX_ADC_CHANNELS;
+    }
+
+    for (size_t ch = 0; ch < AN_MAX_ADC_CHANNELS; ch++) {
+        chan[ch].base = 0;
+        chan[ch].quiet = 0;
+        chan[ch].seed = true;
+        chan[ch].active = false;
+        if (!config(ch, threshold, shift, holdoff)) {
+            config(ch, threshold, 10, holdoff);
+        }
+    }
+}
+
+bool AdvancedBaseline::config(size_t channel, uint32_t threshold, uint32_t shift, uint32_t holdoff) {
+    // Past 15 the update step falls below one code, and deviations of less
+    // than 2^(shift - 15) codes would stop moving the Q15 baseline.
+    if (channel >= AN_MAX_ADC_CHANNELS || shift < 1 || shift > 15) {
+        return false;
+    }
+    chan[channel].threshold = threshold;
+    chan[channel].shift = shift;
+    chan[channel].holdoff = holdoff;
+    return true;
+}
+
+void AdvancedBaseline::process(const Sample *in, size_t n_frames, int32_t *out) {
+    const size_t stride = n_channels;
+
+    for (size_t ch = 0; ch < n_channels; ch++) {
+        channel_t *c = &chan[ch];
+        const Sample *src = in + ch;
+        int32_t *dst = out + ch;
+
+        if (c->seed && n_frames) {
+            c->base = (int32_t)src[0] << 15;
+            c->quiet = c->holdoff;
+            c->seed = false;
+        }
+
+        // Work on locals, the compiler can't keep members in registers across stores.
+        int32_t base = c->base;
+        uint32_t quiet = c->quiet;
+        bool active = c->active;
+        const int32_t threshold = c->threshold;
+        const uint32_t holdoff = c->holdoff;
+        const uint32_t shift = c->shift;
+
+        for (size_t i = 0; i < n_frames; i++) {
+            int32_t x = *src;
+            int32_t d = x - ((base + (1 << 14)) >> 15);
+            *dst = d;
+            active = !(d < threshold && d > -threshold);
+            if (!active) {
+                if (quiet >= holdoff) {
+                    // Round to nearest, ties towards zero, so the baseline
+                    // settles within half a code of x from either side.
+                    base += ((x << 15) - base + (1 << (shift - 1)) - 1) >> shift;
+                } else {
+                    quiet++;
+                }
+            } else {
+                quiet = 0;
+            }
+            src += stride;
+            dst += stride;
+        }
+
+        c->base = base;
+        c->quiet = quiet;
+        c->active = active;
+    }
+}
+
+size_t AdvancedBaseline::process(SampleBuffer buf, int32_t *out) {
+    if (!buf || buf.channels() != n_channels) {
+        return 0;
+    }
+    process(buf.data(), buf.size() / n_channels, out);
+    return buf.size();
+}
+
+Sample AdvancedBaseline::baseline(size_t channel) const {
+    if (channel >= n_channels) {
+        return 0;
+    }
+    return (Sample)((chan[channel].base + (1 << 14)) >> 15);
+}
+
+bool AdvancedBaseline::idle(size_t channel) const {
+    if (channel >= n_channels) {
+        return false;
+    }
+    return !chan[channel].active;
+}
+
+void AdvancedBaseline::set(size_t channel, Sample value) {
+    if (channel < n_channels) {
+        chan[channel].base = (int32_t)value << 15;
+        chan[channel].seed = false;
+    }
+}
+
+void AdvancedBaseline::tare(int channel) {
+    for (size_t ch = 0; ch < n_channels; ch++) {
+        if (channel < 0 || (size_t)channel == ch) {
+            chan[ch].seed = true;
+        }
+    }
+}
@@ -0,0 +1,131 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_BASELINE_H__
+#define __ADVANCED_BASELINE_H__
+
+#include "AdvancedAnalog.h"
+
+/**
+ * @brief Adaptive baseline (auto-zero) tracking stage
+ *
+ * Tracks the baseline of each channel in the background and subtracts it in
+ * the same pass, replacing stop/average/start tare cycles. A channel is idle
+ * while its samples stay within an activity threshold of the baseline; only
+ * idle samples update the baseline, through an exponential average with a
+ * time constant of 2^shift samples. After activity, tracking resumes once the
+ * channel has been idle for a hold-off period, so the tail of a press doesn't
+ * leak into the baseline.
+ *
+ * Baselines are kept in Q15 (16-bit codes still fit a signed 32-bit word) and
+ * every operation is integer, so the cost is a compare, a subtract and a
+ * shift-add per sample. The time constant is therefore at most 2^15 samples.
+ */
+class AdvancedBaseline {
+  private:
+    typedef struct {
+        int32_t base;       // Baseline, Q15 codes.
+        uint32_t threshold; // Activity threshold, codes.
+        uint32_t holdoff;   // Idle samples required before tracking resumes.
+        uint32_t quiet;     // Consecutive idle samples seen.
+        uint8_t shift;      // Time constant, log2 samples.
+        bool seed;          // Take the next sample as baseline.
+        bool active;        // Last sample was above the threshold.
+    } channel_t;
+
+    size_t n_channels;
+    channel_t chan[AN_MAX_ADC_CHANNELS];
+
+  public:
+    /**
+     * @brief Constructor for AdvancedBaseline
+     * @param n_channels Number of interleaved channels
+     * @param threshold Activity threshold in codes, for all channels
+     * @param shift Time constant as log2 of samples (default: 10, i.e. 1024 samples)
+     * @param holdoff Idle samples needed after activity before tracking resumes (default: 0)
+     *
+     * Baselines are seeded from the first processed frame.
+     */
+    AdvancedBaseline(size_t n_channels, uint32_t threshold, uint32_t shift = 10, uint32_t holdoff = 0);
+
+    /**
+     * @brief Configure a channel
+     * @param channel Channel index
+     * @param threshold Activity threshold in codes
+     * @param shift Time constant as log2 of samples (1 to 15)
+     * @param holdoff Idle samples needed after activity before tracking resumes
+     * @return true on success, false on invalid arguments
+     */
+    bool config(size_t channel, uint32_t threshold, uint32_t shift, uint32_t holdoff = 0);
+
+    /**
+     * @brief Track and subtract the baseline of interleaved samples
+     * @param in Interleaved samples
+     * @param n_frames Number of frames (samples per channel)
+     * @param out Output array of n_frames * channels() values, sample minus baseline
+     */
+    void process(const Sample *in, size_t n_frames, int32_t *out);
+
+    /**
+     * @brief Track and subtract the baseline of a sample buffer
+     * @param buf Sample buffer, must have channels() channels
+     * @param out Output array of buf.size() values
+     * @return Number of values written, or 0 on channel mismatch
+     */
+    size_t process(SampleBuffer buf, int32_t *out);
+
+    /**
+     * @brief Get the current baseline of a channel
+     * @param channel Channel index
+     * @return Baseline in codes, fractional bits dropped
+     */
+    Sample baseline(size_t channel) const;
+
+    /**
+     * @brief Check if a channel is currently idle
+     * @param channel Channel index
+     * @return true if the last sample was within the activity threshold
+     */
+    bool idle(size_t channel) const;
+
+    /**
+     * @brief Set the baseline of a channel
+     * @param channel Channel index
+     * @param value Baseline in codes
+     */
+    void set(size_t channel, Sample value);
+
+    /**
+     * @brief Re-seed the baselines
+     * @param channel Channel index, or -1 for all channels (default)
+     *
+     * The next processed sample of the channel becomes its baseline. Use this
+     * when the sensors are known to be unloaded.
+     */
+    void tare(int channel = -1);
+
+    /**
+     * @brief Get the number of channels
+     */
+    size_t channels() const {
+        return n_channels;
+    }
+};
+
+#endif // __ADVANCED_BASELINE_H__
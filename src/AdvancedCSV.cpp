@@ -0,0 +1,99 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedCSV.h"
+
+static const char digit_pairs[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+char *an_utoa(uint32_t value, char *out) {
+    // Count the digits with compares instead of a division per digit.
+    size_t n = 1 + (value >= 10) + (value >= 100) + (value >= 1000) + (value >= 10000)
+               + (value >= 100000) + (value >= 1000000) + (value >= 10000000)
+               + (value >= 100000000) + (value >= 1000000000);
+    // Then fill from the end, two digits per step; the division by 100 compiles to a multiply.
+    char *p = out + n;
+    while (value >= 100) {
+        uint32_t q = value / 100;
+        p -= 2;
+        memcpy(p, &digit_pairs[(value - q * 100) * 2], 2);
+        value = q;
+    }
+    if (value >= 10) {
+        memcpy(p - 2, &digit_pairs[value * 2], 2);
+    } else {
+        p[-1] = '0' + value;
+    }
+    return out + n;
+}
+
+size_t an_format_csv(const Sample *in, size_t n_channels, size_t n_frames, size_t step, char separator, char *out) {
+    char *p = out;
+    for (size_t i = 0; i < n_frames; i++) {
+        const Sample *frame = in + i * step * n_channels;
+        for (size_t ch = 0; ch < n_channels; ch++) {
+            p = an_utoa(frame[ch], p);
+            *p++ = separator;
+        }
+        // Replace the last separator with the line ending.
+        p[-1] = '\r';
+        *p++ = '\n';
+    }
+    return p - out;
+}
+
+AdvancedCSV::AdvancedCSV(Print &port, size_t buffer_bytes, char separator) :
+    port(port), text(nullptr), text_size(buffer_bytes), separator(separator), n_lines(0) {
+    text = new char[text_size];
+}
+
+AdvancedCSV::~AdvancedCSV() {
+    delete[] text;
+}
+
+size_t AdvancedCSV::print(SampleBuffer buf, size_t step) {
+    if (!buf) {
+        return 0;
+    }
+    return print(buf.data(), buf.channels(), buf.size() / buf.channels(), step);
+}
+
+size_t AdvancedCSV::print(const Sample *samples, size_t n_channels, size_t n_frames, size_t step) {
+    if (text == nullptr || n_channels == 0 || step == 0) {
+        return 0;
+    }
+    // Lines that always fit in the buffer, formatted and written in batches.
+    size_t batch = text_size / AN_CSV_FRAME_BYTES(n_channels);
+    if (batch == 0) {
+        return 0;
+    }
+    size_t n_out = (n_frames + step - 1) / step;
+    size_t written = 0;
+    for (size_t i = 0; i < n_out; i += batch) {
+        size_t n = (n_out - i < batch) ? n_out - i : batch;
+        size_t len = an_format_csv(samples + i * step * n_channels, n_channels, n, step, separator, text);
+        written += port.write((const uint8_t *)text, len);
+        n_lines += n;
+    }
+    return written;
+}
@@ -0,0 +1,106 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_CSV_H__
+#define __ADVANCED_CSV_H__
+
+#include "AdvancedAnalog.h"
+
+// Worst-case text for one sample frame: up to 5 digits and a separator per
+// value, the last separator being "\r\n".
+#define AN_CSV_FRAME_BYTES(n_channels)  ((n_channels) * 6 + 1)
+
+/**
+ * @brief Fast CSV and Serial Plotter text output
+ *
+ * Renders sample buffers as text, one line of separated values per sample
+ * frame, e.g. "2048,1023\r\n", which the Arduino Serial Plotter and most
+ * logging tools accept. Whole buffers are formatted into a preallocated
+ * line buffer and handed to the port in as few write() calls as possible,
+ * instead of one print() per value and one per line ending.
+ */
+class AdvancedCSV {
+  private:
+    Print &port;
+    char *text;
+    size_t text_size;
+    char separator;
+    uint32_t n_lines;
+
+  public:
+    /**
+     * @brief Constructor for AdvancedCSV
+     * @param port Output port, e.g. Serial
+     * @param buffer_bytes Size of the line buffer, at least one line (default: 1024)
+     * @param separator Value separator, e.g. ',', ' ' or '\t' (default: ',')
+     */
+    AdvancedCSV(Print &port, size_t buffer_bytes = 1024, char separator = ',');
+
+    /**
+     * @brief Destructor for AdvancedCSV
+     */
+    ~AdvancedCSV();
+
+    /**
+     * @brief Print a sample buffer, one line per sample frame
+     * @param buf Sample buffer
+     * @param step Print every step-th sample frame, to decimate for plotting (default: 1)
+     * @return Number of bytes written to the port
+     */
+    size_t print(SampleBuffer buf, size_t step = 1);
+
+    /**
+     * @brief Print interleaved samples, one line per sample frame
+     * @param samples Interleaved samples
+     * @param n_channels Number of channels
+     * @param n_frames Number of sample frames
+     * @param step Print every step-th sample frame (default: 1)
+     * @return Number of bytes written to the port
+     */
+    size_t print(const Sample *samples, size_t n_channels, size_t n_frames, size_t step = 1);
+
+    /**
+     * @brief Get the number of lines printed
+     */
+    uint32_t lines() const {
+        return n_lines;
+    }
+};
+
+/**
+ * @brief Convert an unsigned integer to decimal text
+ * @param value Value to convert
+ * @param out Output, at least 10 characters, not null-terminated
+ * @return Pointer just past the last digit
+ */
+char *an_utoa(uint32_t value, char *out);
+
+/**
+ * @brief Format interleaved samples as separated text lines
+ * @param in Interleaved samples
+ * @param n_channels Number of channels
+ * @param n_frames Number of sample frames to format
+ * @param step Distance between formatted sample frames, in frames
+ * @param separator Value separator
+ * @param out Output, at least n_frames * AN_CSV_FRAME_BYTES(n_channels) bytes
+ * @return Number of bytes written to out
+ */
+size_t an_format_csv(const Sample *in, size_t n_channels, size_t n_frames, size_t step, char separator, char *out);
+
+#endif // __ADVANCED_CSV_H__
@@ -0,0 +1,111 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_CAPTURE_H__
+#define __ADVANCED_CAPTURE_H__
+
+// NOTE: This header is shared with the host tools in extras/, so it must
+// only depend on the standard C headers.
+#include <stddef.h>
+#include <stdint.h>
+#include "AdvancedFrame.h"
+
+#define AN_CAPTURE_MAGIC        (0x50434E41UL)  // "ANCP"
+#define AN_CAPTURE_CHUNK_MAGIC  (0x4B434E41UL)  // "ANCK"
+#define AN_CAPTURE_VERSION      (1)
+#define AN_CAPTURE_HEADER_SIZE  (4096)          // Keeps the chunks sector aligned.
+#define AN_CAPTURE_CHUNK_SIZE   (24)
+#define AN_CAPTURE_CAL_POINTS   (32)
+#define AN_CAPTURE_MAX_CHANNELS (16)
+#define AN_CAPTURE_INDEX_SIZE   (1024)          // Max index entries, see capture_index_t.
+
+/**
+ * @brief Calibration of one channel, as stored in a capture file
+ */
+typedef struct {
+    uint8_t n_points;                       ///< 0 for linear, otherwise number of points.
+    uint8_t reserved[3];
+    float gain;                             ///< Units per code (linear only).
+    float offset;                           ///< Units at code 0 (linear only).
+    uint16_t codes[AN_CAPTURE_CAL_POINTS];  ///< Breakpoint codes.
+    float values[AN_CAPTURE_CAL_POINTS];    ///< Breakpoint values.
+} capture_cal_t;
+
+/**
+ * @brief Capture file header
+ *
+ * A capture file starts with this header, zero padded to header_bytes, and
+ * is followed by chunks and then by an optional index. All fields are
+ * little-endian. The totals and the index are written when the capture is
+ * closed, so a file that was never closed shows 0 chunks and must be read by
+ * walking the chunks.
+ */
+typedef struct {
+    uint32_t magic;             ///< AN_CAPTURE_MAGIC.
+    uint16_t version;           ///< AN_CAPTURE_VERSION.
+    uint16_t header_bytes;      ///< Offset of the first chunk.
+    uint8_t adc_id;             ///< ADC instance (1-3), 0 if unknown.
+    uint8_t channels;           ///< Interleaved channels per frame of samples.
+    uint8_t resolution;         ///< AN_RESOLUTION_x of the samples.
+    uint8_t encoding;           ///< AN_FRAME_x payload encoding of the chunks.
+    float sample_rate;          ///< Achieved sample rate in Hz.
+    uint32_t sample_time;       ///< ADC sampling time in half cycles, 0 if unknown.
+    uint32_t chunks;            ///< Number of chunks.
+    uint32_t dropped;           ///< Buffers dropped because storage was too slow.
+    uint32_t reserved;
+    uint64_t data_bytes;        ///< Bytes of chunks after the header.
+    uint16_t pins[AN_CAPTURE_MAX_CHANNELS];     ///< PinName sampled on each channel.
+    capture_cal_t cal[AN_CAPTURE_MAX_CHANNELS]; ///< Calibration of each channel.
+    uint64_t index_offset;      ///< File offset of the index, 0 if there is none.
+    uint32_t index_entries;     ///< Number of index entries.
+    uint32_t index_stride;      ///< Chunks between index entries.
+} capture_header_t;
+
+/**
+ * @brief Capture chunk header
+ *
+ * Every chunk holds one ADC buffer. The payload follows the chunk header and
+ * is zero padded to a multiple of 4 bytes, so chunk headers and raw samples
+ * are always aligned.
+ */
+typedef struct {
+    uint32_t magic;             ///< AN_CAPTURE_CHUNK_MAGIC.
+    uint32_t sequence;          ///< Buffer sequence number, including dropped buffers.
+    uint32_t timestamp;         ///< Time of the first sample, in us.
+    uint32_t n_samples;         ///< Samples in the payload (all channels).
+    uint32_t payload_bytes;     ///< Payload size in bytes, without padding.
+    uint16_t flags;             ///< AN_FRAME_x flags.
+    uint16_t dropped;           ///< Buffers dropped just before this one (saturates).
+} capture_chunk_t;
+
+/**
+ * @brief Capture index entry
+ *
+ * The index lists every index_stride-th chunk, starting with the first, so a
+ * reader can find chunk k by seeking to entry k / index_stride and walking at
+ * most index_stride - 1 chunks. The stride doubles whenever the index would
+ * exceed AN_CAPTURE_INDEX_SIZE entries, so the writer's memory stays bounded.
+ */
+typedef struct {
+    uint32_t sequence;          ///< Sequence number of the chunk.
+    uint32_t timestamp;         ///< Time of its first sample, in us.
+    uint64_t offset;            ///< File offset of the chunk header.
+} capture_index_t;
+
+#endif // __ADVANCED_CAPTURE_H__
@@ -0,0 +1,121 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedCoP.h"
+
+AdvancedCoP::AdvancedCoP(uint32_t threshold) : n_sensors(0), n_sources(0), min_load(threshold) {
+    if (min_load == 0) {
+        min_load = 1;
+    }
+    for (size_t i = 0; i < AN_COP_MAX_SOURCES; i++) {
+        fsr[i] = nullptr;
+    }
+}
+
+bool AdvancedCoP::sensor(size_t source, size_t channel, int16_t x, int16_t y) {
+    if (n_sensors >= AN_COP_MAX_SENSORS || source >= AN_COP_MAX_SOURCES || channel >= AN_MAX_ADC_CHANNELS) {
+        return false;
+    }
+    geometry[n_sensors++] = {(uint8_t)source, (uint8_t)channel, x, y};
+    if (source >= n_sources) {
+        n_sources = source + 1;
+    }
+    return true;
+}
+
+bool AdvancedCoP::linearize(size_t source, const AdvancedFSR *tables) {
+    if (source >= AN_COP_MAX_SOURCES) {
+        return false;
+    }
+    fsr[source] = tables;
+    return true;
+}
+
+void AdvancedCoP::compute(const Sample *const *src, const size_t *src_channels, size_t n_frames, cop_frame_t *out) {
+    // Resolve everything that doesn't change per frame: sample pointer, stride
+    // and optional force table of each sensor.
+    const Sample *ptr[AN_COP_MAX_SENSORS];
+    size_t stride[AN_COP_MAX_SENSORS];
+    const uint16_t *lut[AN_COP_MAX_SENSORS];
+    uint32_t shift[AN_COP_MAX_SENSORS];
+    uint32_t max_code[AN_COP_MAX_SENSORS];
+    bool raw[AN_COP_MAX_SENSORS];
+
+    for (size_t i = 0; i < n_sensors; i++) {
+        const sensor_t &s = geometry[i];
+        const AdvancedFSR *f = fsr[s.source];
+        ptr[i] = src[s.source] + s.channel;
+        stride[i] = src_channels[s.source];
+        lut[i] = f ? f->lookup(s.channel) : nullptr;
+        shift[i] = f ? f->lookup_shift() : 0;
+        max_code[i] = f ? f->lookup_max() : 0xFFFF;
+        // Sources without tables are weighted by code; channels of a source
+        // with tables that have none of their own weigh 0, as in AdvancedFSR.
+        raw[i] = (f == nullptr);
+    }
+
+    for (size_t n = 0; n < n_frames; n++) {
+        uint32_t load = 0;
+        int64_t mx = 0, my = 0;
+
+        for (size_t i = 0; i < n_sensors; i++) {
+            uint32_t code = ptr[i][n * stride[i]];
+            // Clamped like AdvancedFSR, so a stray code can't index past the table.
+            code = (code > max_code[i]) ? max_code[i] : code;
+            uint32_t w = lut[i] ? lut[i][code >> shift[i]] : (raw[i] ? code : 0);
+            load += w;
+            mx += (int32_t)w * geometry[i].x;
+            my += (int32_t)w * geometry[i].y;
+        }
+
+        out[n].load = load;
+        if (load < min_load) {
+            out[n].x = AN_COP_INVALID;
+            out[n].y = AN_COP_INVALID;
+        } else {
+            // Round to nearest, the centroid always lies inside the sensor hull
+            // so it fits the geometry range.
+            int64_t half = load / 2;
+            out[n].x = (int16_t)((mx + (mx < 0 ? -half : half)) / (int64_t)load);
+            out[n].y = (int16_t)((my + (my < 0 ? -half : half)) / (int64_t)load);
+        }
+    }
+}
+
+size_t AdvancedCoP::compute(SampleBuffer buf0, SampleBuffer buf1, cop_frame_t *out) {
+    if (!buf0 || !buf1 || n_sources > 2) {
+        return 0;
+    }
+
+    const Sample *src[2] = {buf0.data(), buf1.data()};
+    const size_t channels[2] = {buf0.channels(), buf1.channels()};
+    size_t n0 = buf0.size() / channels[0];
+    size_t n1 = buf1.size() / channels[1];
+
+    // Sensors must refer to channels that exist in their buffer.
+    for (size_t i = 0; i < n_sensors; i++) {
+        if (geometry[i].channel >= channels[geometry[i].source]) {
+            return 0;
+        }
+    }
+
+    size_t n_frames = (n0 < n1) ? n0 : n1;
+    compute(src, channels, n_frames, out);
+    return n_frames;
+}
@@ -0,0 +1,119 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_COP_H__
+#define __ADVANCED_COP_H__
+
+#include "AdvancedAnalog.h"
+#include "AdvancedFSR.h"
+
+#define AN_COP_MAX_SOURCES      (3)         // One source per ADC instance.
+#define AN_COP_MAX_SENSORS      (AN_MAX_ADC_CHANNELS)
+#define AN_COP_INVALID          (-32768)    // CoP coordinate reported when the load is too low.
+
+/**
+ * @brief Center-of-pressure output frame
+ */
+typedef struct {
+    uint32_t load;      ///< Total load, sum of all sensor weights.
+    int16_t x;          ///< CoP x, in geometry units, or AN_COP_INVALID.
+    int16_t y;          ///< CoP y, in geometry units, or AN_COP_INVALID.
+} cop_frame_t;
+
+/**
+ * @brief Center-of-pressure and load distribution stage for sensor arrays
+ *
+ * Computes, for every frame, the total load and the load-weighted centroid of
+ * an array of sensors spread across several ADC instances (sources). Samples
+ * are read in place from each source's interleaved buffer, optionally passed
+ * through the source's AdvancedFSR tables, and accumulated in fixed-point, so
+ * no per-channel copies are needed. Sources must be time-aligned, i.e. frame i
+ * of every source must have been sampled at the same instant.
+ */
+class AdvancedCoP {
+  private:
+    typedef struct {
+        uint8_t source;
+        uint8_t channel;
+        int16_t x;
+        int16_t y;
+    } sensor_t;
+
+    size_t n_sensors;
+    size_t n_sources;
+    uint32_t min_load;
+    sensor_t geometry[AN_COP_MAX_SENSORS];
+    const AdvancedFSR *fsr[AN_COP_MAX_SOURCES];
+
+  public:
+    /**
+     * @brief Constructor for AdvancedCoP
+     * @param threshold Minimum total load for a valid CoP (default: 1)
+     */
+    AdvancedCoP(uint32_t threshold = 1);
+
+    /**
+     * @brief Add a sensor to the array
+     * @param source Source index (position of the buffer passed to compute())
+     * @param channel Channel index inside the source's interleaved buffer
+     * @param x Sensor x position, in geometry units
+     * @param y Sensor y position, in geometry units
+     * @return true on success, false if the array is full or arguments are invalid
+     */
+    bool sensor(size_t source, size_t channel, int16_t x, int16_t y);
+
+    /**
+     * @brief Convert a source's codes to force before weighting
+     * @param source Source index
+     * @param tables FSR tables for the source's channels, or nullptr for raw codes
+     * @return true on success, false if source is out of range
+     *
+     * Channels that have no table in tables weigh 0. The tables object must
+     * outlive this stage.
+     */
+    bool linearize(size_t source, const AdvancedFSR *tables);
+
+    /**
+     * @brief Compute load and CoP for time-aligned interleaved frames
+     * @param src Array of per-source interleaved sample pointers
+     * @param src_channels Array of per-source channel counts (frame stride)
+     * @param n_frames Number of frames to process
+     * @param out Output array of n_frames frames
+     */
+    void compute(const Sample *const *src, const size_t *src_channels, size_t n_frames, cop_frame_t *out);
+
+    /**
+     * @brief Compute load and CoP from two time-aligned sample buffers
+     * @param buf0 Buffer of source 0
+     * @param buf1 Buffer of source 1
+     * @param out Output array, sized for the shorter buffer's frame count
+     * @return Number of frames written
+     */
+    size_t compute(SampleBuffer buf0, SampleBuffer buf1, cop_frame_t *out);
+
+    /**
+     * @brief Get the number of sensors
+     * @return Number of sensors added with sensor()
+     */
+    size_t sensors() const {
+        return n_sensors;
+    }
+};
+
+#endif // __ADVANCED_COP_H__
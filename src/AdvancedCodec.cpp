@@ -0,0 +1,315 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+#include "AdvancedCodec.h"
+
+#define CODEC_MAX_K         (20)    // Residuals of 16-bit samples fit in 21 bits.
+#define CODEC_VERBATIM      (0x80)
+
+// Residual of sample i for the fixed polynomial predictor of order ORDER.
+template <int ORDER> static inline int32_t residual(const uint16_t *x, ptrdiff_t stride, size_t i) {
+    const uint16_t *s = x + i * stride;
+    switch (ORDER) {
+        case 0: return s[0];
+        case 1: return s[0] - s[-stride];
+        case 2: return s[0] - 2 * s[-stride] + s[-2 * stride];
+        default: return s[0] - 3 * s[-stride] + 3 * s[-2 * stride] - s[-3 * stride];
+    }
+}
+
+static inline uint32_t zigzag(int32_t r) {
+    return ((uint32_t)r << 1) ^ (uint32_t)(r >> 31);
+}
+
+// LSB-first bit writer; the caller sizes the output, so there are no checks.
+typedef struct {
+    uint8_t *p;
+    uint64_t acc;
+    int n;
+} bit_writer_t;
+
+static inline void put_bits(bit_writer_t &w, uint32_t v, int bits) {
+    w.acc |= (uint64_t)v << w.n;
+    w.n += bits;
+    if (w.n >= 32) {
+        uint32_t word = (uint32_t)w.acc;
+        memcpy(w.p, &word, 4);  // Both the M7 and x86 are little-endian.
+        w.p += 4;
+        w.acc >>= 32;
+        w.n -= 32;
+    }
+}
+
+static inline void put_rice(bit_writer_t &w, uint32_t u, int k) {
+    uint32_t q = u >> k;
+    if (q < AN_CODEC_ESCAPE_BITS) {
+        put_bits(w, 1U << q, q + 1);
+        put_bits(w, u & ((1U << k) - 1), k);
+    } else {
+        put_bits(w, 0, AN_CODEC_ESCAPE_BITS);
+        put_bits(w, u, AN_CODEC_ESCAPE_BITS);
+    }
+}
+
+static inline uint32_t rice_bits(uint32_t u, int k) {
+    uint32_t q = u >> k;
+    return (q < AN_CODEC_ESCAPE_BITS) ? q + 1 + k : 2 * AN_CODEC_ESCAPE_BITS;
+}
+
+template <int ORDER> static size_t encode_channel(const uint16_t *x, ptrdiff_t stride, size_t n, int log2_part, uint8_t *out) {
+    size_t n_part = (n + (1U << log2_part) - 1) >> log2_part;
+    uint8_t ks[AN_CODEC_MAX_PARTITIONS];
+
+    // First pass: pick the Rice parameter of each partition from the mean
+    // residual, and count the exact size with it. Every sample is touched a
+    // fixed number of times, so the cost per buffer is bounded.
+    uint64_t bits = 0;
+    for (size_t p = 0; p < n_part; p++) {
+        size_t lo = p << log2_part;
+        size_t hi = (p + 1) << log2_part;
+        lo = (lo < ORDER) ? ORDER : lo;
+        hi = (hi > n) ? n : hi;
+        uint64_t sum = 0;
+        for (size_t i = lo; i < hi; i++) {
+            sum += zigzag(residual<ORDER>(x, stride, i));
+        }
+        int k = 0;
+        while (k < CODEC_MAX_K && ((uint64_t)(hi - lo) << (k + 1)) <= sum) {
+            k++;
+        }
+        ks[p] = k;
+        bits += 5;
+        for (size_t i = lo; i < hi; i++) {
+            bits += rice_bits(zigzag(residual<ORDER>(x, stride, i)), k);
+        }
+    }
+
+    size_t bytes = 1 + 2 * ORDER + (bits + 7) / 8;
+    if (bytes >= 1 + 2 * n) {
+        return 0;
+    }
+
+    // Second pass: write it out.
+    out[0] = ORDER | (log2_part << 3);
+    for (int i = 0; i < ORDER; i++) {
+        uint16_t s = x[i * stride];
+        memcpy(&out[1 + 2 * i], &s, sizeof(s));
+    }
+    bit_writer_t w = { out + 1 + 2 * ORDER, 0, 0 };
+    for (size_t p = 0; p < n_part; p++) {
+        size_t lo = p << log2_part;
+        size_t hi = (p + 1) << log2_part;
+        lo = (lo < ORDER) ? ORDER : lo;
+        hi = (hi > n) ? n : hi;
+        int k = ks[p];
+        put_bits(w, k, 5);
+        for (size_t i = lo; i < hi; i++) {
+            put_rice(w, zigzag(residual<ORDER>(x, stride, i)), k);
+        }
+    }
+    for (; w.n > 0; w.n -= 8, w.acc >>= 8) {
+        *w.p++ = (uint8_t)w.acc;
+    }
+    return bytes;
+}
+
+size_t an_codec_max_bytes(size_t n_channels, size_t n_frames) {
+    return n_channels * (1 + 2 * n_frames);
+}
+
+size_t an_encode(const uint16_t *in, size_t n_channels, size_t n_frames, uint8_t *out) {
+    uint8_t *p = out;
+    for (size_t ch = 0; ch < n_channels; ch++) {
+        const uint16_t *x = in + ch;
+        ptrdiff_t stride = n_channels;
+
+        // Pick the predictor order with the smallest sum of absolute residuals,
+        // computing all four orders at once from successive differences.
+        int order = 0;
+        if (n_frames > 3) {
+            int32_t e0 = x[2 * stride];
+            int32_t e1 = e0 - x[stride];
+            int32_t e2 = e1 - (x[stride] - x[0]);
+            uint64_t sum[4] = { 0, 0, 0, 0 };
+            for (size_t i = 3; i < n_frames; i++) {
+                int32_t f0 = x[i * stride];
+                int32_t f1 = f0 - e0;
+                int32_t f2 = f1 - e1;
+                int32_t f3 = f2 - e2;
+                sum[0] += f0;
+                sum[1] += (f1 < 0) ? -f1 : f1;
+                sum[2] += (f2 < 0) ? -f2 : f2;
+                sum[3] += (f3 < 0) ? -f3 : f3;
+                e0 = f0, e1 = f1, e2 = f2;
+            }
+            for (int o = 1; o < 4; o++) {
+                if (sum[o] < sum[order]) {
+                    order = o;
+                }
+            }
+        }
+
+        // Partitions of at least 64 residuals, more only for very long buffers.
+        int log2_part = 6;
+        while ((n_frames >> log2_part) >= AN_CODEC_MAX_PARTITIONS) {
+            log2_part++;
+        }
+
+        size_t bytes = 0;
+        if (n_frames > 0 && log2_part <= 15) {
+            switch (order) {
+                case 0: bytes = encode_channel<0>(x, stride, n_frames, log2_part, p); break;
+                case 1: bytes = encode_channel<1>(x, stride, n_frames, log2_part, p); break;
+                case 2: bytes = encode_channel<2>(x, stride, n_frames, log2_part, p); break;
+                case 3: bytes = encode_channel<3>(x, stride, n_frames, log2_part, p); break;
+            }
+        }
+        if (bytes == 0) {
+            // Not compressible, store it as is.
+            p[0] = CODEC_VERBATIM;
+            for (size_t i = 0; i < n_frames; i++) {
+                uint16_t s = x[i * stride];
+                memcpy(&p[1 + 2 * i], &s, sizeof(s));
+            }
+            bytes = 1 + 2 * n_frames;
+        }
+        p += bytes;
+    }
+    return p - out;
+}
+
+// LSB-first bit reader. Reads past the end return zeros, and the caller
+// checks the final position against the block length.
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    uint64_t acc;
+    int n;
+    size_t pos;     // Bits consumed.
+} bit_reader_t;
+
+static inline void refill(bit_reader_t &r) {
+    while (r.n <= 56) {
+        r.acc |= (uint64_t)((r.p < r.end) ? *r.p++ : 0) << r.n;
+        r.n += 8;
+    }
+}
+
+static inline uint32_t get_bits(bit_reader_t &r, int bits) {
+    if (r.n < bits) {
+        refill(r);
+    }
+    uint32_t v = (uint32_t)r.acc & ((1U << bits) - 1);
+    r.acc >>= bits;
+    r.n -= bits;
+    r.pos += bits;
+    return v;
+}
+
+static inline uint32_t get_rice(bit_reader_t &r, int k) {
+    if (r.n < 2 * AN_CODEC_ESCAPE_BITS) {
+        refill(r);
+    }
+    uint32_t low = (uint32_t)r.acc & ((1U << AN_CODEC_ESCAPE_BITS) - 1);
+    if (low == 0) {
+        get_bits(r, AN_CODEC_ESCAPE_BITS);
+        return get_bits(r, AN_CODEC_ESCAPE_BITS);
+    }
+    int q = __builtin_ctz(low);
+    get_bits(r, q + 1);
+    return (q << k) | get_bits(r, k);
+}
+
+template <int ORDER> static bool decode_channel(bit_reader_t &r, size_t n, int log2_part, uint16_t *x, ptrdiff_t stride) {
+    int32_t s1 = (ORDER > 0) ? x[(ORDER - 1) * stride] : 0;
+    int32_t s2 = (ORDER > 1) ? x[(ORDER - 2) * stride] : 0;
+    int32_t s3 = (ORDER > 2) ? x[(ORDER - 3) * stride] : 0;
+    size_t n_part = (n + (1U << log2_part) - 1) >> log2_part;
+    for (size_t p = 0; p < n_part; p++) {
+        size_t lo = p << log2_part;
+        size_t hi = (p + 1) << log2_part;
+        lo = (lo < ORDER) ? ORDER : lo;
+        hi = (hi > n) ? n : hi;
+        int k = get_bits(r, 5);
+        if (k > CODEC_MAX_K) {
+            return false;
+        }
+        for (size_t i = lo; i < hi; i++) {
+            uint32_t u = get_rice(r, k);
+            int32_t res = (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+            int32_t s;
+            switch (ORDER) {
+                case 0: s = res; break;
+                case 1: s = res + s1; break;
+                case 2: s = res + 2 * s1 - s2; break;
+                default: s = res + 3 * s1 - 3 * s2 + s3; break;
+            }
+            x[i * stride] = (uint16_t)s;
+            s3 = s2, s2 = s1, s1 = (uint16_t)s;
+        }
+    }
+    return true;
+}
+
+size_t an_decode(const uint8_t *in, size_t len, size_t n_channels, size_t n_frames, uint16_t *out) {
+    const uint8_t *p = in;
+    const uint8_t *end = in + len;
+    for (size_t ch = 0; ch < n_channels; ch++) {
+        uint16_t *x = out + ch;
+        ptrdiff_t stride = n_channels;
+        if (p >= end) {
+            return 0;
+        }
+        uint8_t mode = *p++;
+        if (mode & CODEC_VERBATIM) {
+            if ((size_t)(end - p) < 2 * n_frames) {
+                return 0;
+            }
+            for (size_t i = 0; i < n_frames; i++, p += 2) {
+                memcpy(&x[i * stride], p, sizeof(uint16_t));
+            }
+            continue;
+        }
+
+        int order = mode & 3;
+        int log2_part = (mode >> 3) & 15;
+        if ((size_t)order > n_frames || (size_t)(end - p) < 2 * (size_t)order) {
+            return 0;
+        }
+        for (int i = 0; i < order; i++, p += 2) {
+            memcpy(&x[i * stride], p, sizeof(uint16_t));
+        }
+
+        bit_reader_t r = { p, end, 0, 0, 0 };
+        bool ok = false;
+        switch (order) {
+            case 0: ok = decode_channel<0>(r, n_frames, log2_part, x, stride); break;
+            case 1: ok = decode_channel<1>(r, n_frames, log2_part, x, stride); break;
+            case 2: ok = decode_channel<2>(r, n_frames, log2_part, x, stride); break;
+            case 3: ok = decode_channel<3>(r, n_frames, log2_part, x, stride); break;
+        }
+        size_t bytes = (r.pos + 7) / 8;
+        if (!ok || bytes > (size_t)(end - p)) {
+            return 0;
+        }
+        p += bytes;
+    }
+    return p - in;
+}
@@ -0,0 +1,81 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_CODEC_H__
+#define __ADVANCED_CODEC_H__
+
+// NOTE: This header is shared with the host tools in extras/, so it must
+// only depend on the standard C headers.
+#include <stddef.h>
+#include <stdint.h>
+
+#define AN_CODEC_MAX_PARTITIONS (256)   // Rice partitions per channel.
+#define AN_CODEC_ESCAPE_BITS    (24)    // Unary length that escapes to a raw residual.
+
+/*
+ * Lossless block format, in the style of Shorten/FLAC. A block holds one
+ * buffer of interleaved samples and decodes on its own; the channel count
+ * and number of frames come from the container (e.g. the frame header).
+ * Channels are stored one after the other, each starting on a byte:
+ *
+ *   uint8_t  mode       bits 0-1: fixed predictor order (0-3)
+ *                       bits 3-6: log2 of the Rice partition size
+ *                       bit 7:    verbatim, n_frames uint16_t samples follow
+ *   uint16_t warmup[order]
+ *   bitstream           per partition a 5-bit Rice parameter k, then every
+ *                       zigzag-mapped residual as q zero bits, a one bit and
+ *                       the low k bits, where q = u >> k. A run of
+ *                       AN_CODEC_ESCAPE_BITS zero bits is followed by the
+ *                       residual in AN_CODEC_ESCAPE_BITS raw bits instead.
+ *
+ * Bits are written least significant first, and the bitstream is padded to a
+ * whole byte. A channel is stored verbatim whenever coding wouldn't make it
+ * smaller, which bounds the block size to an_codec_max_bytes().
+ */
+
+/**
+ * @brief Get the worst-case size of an encoded block
+ * @param n_channels Number of interleaved channels
+ * @param n_frames Number of frames (samples per channel)
+ * @return Size in bytes
+ */
+size_t an_codec_max_bytes(size_t n_channels, size_t n_frames);
+
+/**
+ * @brief Encode a buffer of interleaved samples
+ * @param in Interleaved samples
+ * @param n_channels Number of interleaved channels
+ * @param n_frames Number of frames
+ * @param out Output buffer of at least an_codec_max_bytes(n_channels, n_frames) bytes
+ * @return Encoded size in bytes
+ */
+size_t an_encode(const uint16_t *in, size_t n_channels, size_t n_frames, uint8_t *out);
+
+/**
+ * @brief Decode a block of interleaved samples
+ * @param in Encoded block
+ * @param len Size of the encoded block in bytes
+ * @param n_channels Number of interleaved channels
+ * @param n_frames Number of frames
+ * @param out Output buffer of n_channels * n_frames samples
+ * @return Number of bytes consumed, 0 if the block is malformed
+ */
+size_t an_decode(const uint8_t *in, size_t len, size_t n_channels, size_t n_frames, uint16_t *out);
+
+#endif // __ADVANCED_CODEC_H__
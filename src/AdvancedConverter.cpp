@@ -0,0 +1,262 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedConverter.h"
+
+// Bits per code for each AN_RESOLUTION_x value.
+static const uint8_t CAL_RES_BITS[] = {8, 10, 12, 14, 16};
+
+static bool cal_to_fixed(float v, int32_t *q) {
+    // Round to nearest and reject anything that doesn't fit in an int32.
+    if (!(v < 2147483520.0f && v > -2147483520.0f)) {
+        return false;
+    }
+    *q = (int32_t)(v < 0.0f ? v - 0.5f : v + 0.5f);
+    return true;
+}
+
+static inline uint32_t cal_clamp(uint32_t code, uint32_t max_code) {
+    return (code > max_code) ? max_code : code;
+}
+
+AdvancedCalibration::AdvancedCalibration(uint32_t resolution) : res(resolution) {
+    for (size_t i = 0; i < AN_MAX_ADC_CHANNELS; i++) {
+        linear(i, 1.0f, 0.0f);
+    }
+}
+
+bool AdvancedCalibration::linear(size_t channel, float gain, float offset) {
+    if (channel >= AN_MAX_ADC_CHANNELS) {
+        return false;
+    }
+    chan[channel].n_points = 0;
+    chan[channel].gain = gain;
+    chan[channel].offset = offset;
+    return true;
+}
+
+bool AdvancedCalibration::fullscale(size_t channel, float full_scale, float offset) {
+    if (res >= AN_ARRAY_SIZE(CAL_RES_BITS)) {
+        return false;
+    }
+    uint32_t max_code = (1UL << CAL_RES_BITS[res]) - 1;
+    return linear(channel, (full_scale - offset) / max_code, offset);
+}
+
+bool AdvancedCalibration::points(size_t channel, const Sample *codes, const float *values, size_t n_points) {
+    if (channel >= AN_MAX_ADC_CHANNELS || n_points < 2 || n_points > AN_CAL_MAX_POINTS) {
+        return false;
+    }
+
+    // Breakpoints must be strictly increasing, or segments can't be built.
+    for (size_t i = 1; i < n_points; i++) {
+        if (codes[i] <= codes[i - 1]) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < n_points; i++) {
+        chan[channel].codes[i] = codes[i];
+        chan[channel].values[i] = values[i];
+    }
+    chan[channel].n_points = n_points;
+    return true;
+}
+
+float AdvancedCalibration::eval(size_t channel, float code) const {
+    const channel_t *c = &chan[channel];
+    if (c->n_points == 0) {
+        return c->offset + c->gain * code;
+    }
+
+    // Find the segment containing code, end segments are extrapolated.
+    size_t j = 0;
+    while (j < (size_t)(c->n_points - 2) && code >= c->codes[j + 1]) {
+        j++;
+    }
+    float x0 = c->codes[j], x1 = c->codes[j + 1];
+    float y0 = c->values[j], y1 = c->values[j + 1];
+    return y0 + (y1 - y0) * (code - x0) / (x1 - x0);
+}
+
+AdvancedConverter::AdvancedConverter(size_t n_channels, uint32_t resolution, uint32_t frac_bits) :
+    n_channels(n_channels), res(resolution), q_bits(frac_bits), tables(nullptr), active(0), pending(false) {
+    if (this->n_channels > AN_MAX_ADC_CHANNELS) {
+        this->n_channels = AN_MAX_ADC_CHANNELS;
+    }
+    // Larger fractions overflow the identity slope at 16 bits.
+    if (q_bits > AN_CAL_MAX_FRAC_BITS) {
+        q_bits = AN_CAL_MAX_FRAC_BITS;
+    }
+
+    tables = new table_t[2];
+    if (tables == nullptr) {
+        return;
+    }
+    // Both tables start out valid (all zero) in case load() fails.
+    uint32_t bits = (res < AN_ARRAY_SIZE(CAL_RES_BITS)) ? CAL_RES_BITS[res] : 16;
+    memset(tables, 0, 2 * sizeof(table_t));
+    for (size_t i = 0; i < 2; i++) {
+        tables[i].shift = bits - AN_CAL_SEGMENTS_LOG2;
+        tables[i].max_code = (1UL << bits) - 1;
+    }
+    // Start with an identity mapping, then make it the active table.
+    if (load(AdvancedCalibration(resolution))) {
+        acquire();
+    }
+}
+
+AdvancedConverter::~AdvancedConverter() {
+    delete[] tables;
+}
+
+const AdvancedConverter::table_t *AdvancedConverter::acquire() {
+    // Swap tables only at a buffer boundary, the producer won't touch the
+    // inactive table until pending is cleared.
+    if (pending) {
+        active ^= 1;
+        __DMB();
+        pending = false;
+    }
+    return &tables[active];
+}
+
+bool AdvancedConverter::load(const AdvancedCalibration &cal) {
+    if (tables == nullptr || pending || cal.resolution() != res || res >= AN_ARRAY_SIZE(CAL_RES_BITS)) {
+        return false;
+    }
+
+    // Only the inactive table is written, the consumer keeps using the active one.
+    table_t *t = &tables[active ^ 1];
+    const uint32_t shift = CAL_RES_BITS[res] - AN_CAL_SEGMENTS_LOG2;
+    const float q_scale = (float)(1UL << q_bits);
+    t->shift = shift;
+    t->max_code = (1UL << CAL_RES_BITS[res]) - 1;
+
+    for (size_t ch = 0; ch < n_channels; ch++) {
+        for (size_t k = 0; k < AN_CAL_SEGMENTS; k++) {
+            // Each segment is the chord of the curve over its code range. Linear
+            // curves and breakpoints placed on segment edges are reproduced exactly.
+            float x0 = (float)(k << shift);
+            float x1 = (float)((k + 1) << shift);
+            float y0 = cal.eval(ch, x0);
+            float y1 = cal.eval(ch, x1);
+            float slope = (y1 - y0) / (x1 - x0);
+            float icpt = y0 - slope * x0;
+
+            t->slope[ch][k] = slope;
+            t->icpt[ch][k] = icpt;
+
+            // Fixed-point: out = icpt_q + ((slope_q * code) >> 16).
+            int32_t y_q;
+            if (!cal_to_fixed(icpt * q_scale, &t->icpt_q[ch][k]) ||
+                !cal_to_fixed(slope * q_scale * 65536.0f, &t->slope_q[ch][k]) ||
+                !cal_to_fixed(y0 * q_scale, &y_q) || !cal_to_fixed(y1 * q_scale, &y_q)) {
+                return false;
+            }
+        }
+    }
+
+    // Make sure the table is written before it's published.
+    __DMB();
+    pending = true;
+    return true;
+}
+
+void AdvancedConverter::convert(const Sample *in, size_t n_frames, float *out) {
+    const table_t *t = acquire();
+    const uint32_t shift = t->shift;
+    const uint32_t max_code = t->max_code;
+    const size_t stride = n_channels;
+
+    // Channel-major pass over the interleaved buffer keeps one channel's
+    // segment table hot and lets the compiler unroll the MAC loop.
+    for (size_t ch = 0; ch < n_channels; ch++) {
+        const float *icpt = t->icpt[ch];
+        const float *slope = t->slope[ch];
+        const Sample *src = in + ch;
+        float *dst = out + ch;
+        size_t i = 0;
+        for (; i + 4 <= n_frames; i += 4) {
+            uint32_t c0 = cal_clamp(src[0], max_code), c1 = cal_clamp(src[stride], max_code);
+            uint32_t c2 = cal_clamp(src[2 * stride], max_code), c3 = cal_clamp(src[3 * stride], max_code);
+            uint32_t k0 = c0 >> shift, k1 = c1 >> shift, k2 = c2 >> shift, k3 = c3 >> shift;
+            dst[0] = icpt[k0] + slope[k0] * (float)c0;
+            dst[stride] = icpt[k1] + slope[k1] * (float)c1;
+            dst[2 * stride] = icpt[k2] + slope[k2] * (float)c2;
+            dst[3 * stride] = icpt[k3] + slope[k3] * (float)c3;
+            src += 4 * stride;
+            dst += 4 * stride;
+        }
+        for (; i < n_frames; i++) {
+            uint32_t c = cal_clamp(*src, max_code);
+            uint32_t k = c >> shift;
+            *dst = icpt[k] + slope[k] * (float)c;
+            src += stride;
+            dst += stride;
+        }
+    }
+}
+
+void AdvancedConverter::convert(const Sample *in, size_t n_frames, int32_t *out) {
+    const table_t *t = acquire();
+    const uint32_t shift = t->shift;
+    const uint32_t max_code = t->max_code;
+    const size_t stride = n_channels;
+
+    for (size_t ch = 0; ch < n_channels; ch++) {
+        const int32_t *icpt = t->icpt_q[ch];
+        const int32_t *slope = t->slope_q[ch];
+        const Sample *src = in + ch;
+        int32_t *dst = out + ch;
+        size_t i = 0;
+        // The 32x32->64 multiply maps to a single SMLAL on Cortex-M7.
+        for (; i + 2 <= n_frames; i += 2) {
+            uint32_t c0 = cal_clamp(src[0], max_code), c1 = cal_clamp(src[stride], max_code);
+            uint32_t k0 = c0 >> shift, k1 = c1 >> shift;
+            dst[0] = icpt[k0] + (int32_t)(((int64_t)slope[k0] * c0 + 0x8000) >> 16);
+            dst[stride] = icpt[k1] + (int32_t)(((int64_t)slope[k1] * c1 + 0x8000) >> 16);
+            src += 2 * stride;
+            dst += 2 * stride;
+        }
+        for (; i < n_frames; i++) {
+            uint32_t c = cal_clamp(*src, max_code);
+            uint32_t k = c >> shift;
+            *dst = icpt[k] + (int32_t)(((int64_t)slope[k] * c + 0x8000) >> 16);
+            src += stride;
+            dst += stride;
+        }
+    }
+}
+
+size_t AdvancedConverter::convert(SampleBuffer buf, float *out) {
+    if (!buf || buf.channels() != n_channels) {
+        return 0;
+    }
+    convert(buf.data(), buf.size() / n_channels, out);
+    return buf.size();
+}
+
+size_t AdvancedConverter::convert(SampleBuffer buf, int32_t *out) {
+    if (!buf || buf.channels() != n_channels) {
+        return 0;
+    }
+    convert(buf.data(), buf.size() / n_channels, out);
+    return buf.size();
+}
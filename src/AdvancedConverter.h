@@ -0,0 +1,233 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_CONVERTER_H__
+#define __ADVANCED_CONVERTER_H__
+
+#include "AdvancedAnalog.h"
+
+#define AN_CAL_MAX_POINTS       (32)    // Max breakpoints per channel in a piecewise-linear curve.
+#define AN_CAL_SEGMENTS_LOG2    (5)     // Log2 of the number of segments per channel table.
+#define AN_CAL_SEGMENTS         (1 << AN_CAL_SEGMENTS_LOG2)
+#define AN_CAL_MAX_FRAC_BITS    (14)    // Max fixed-point fraction, keeps a full-scale 16-bit slope in range.
+
+/**
+ * @brief Per-channel calibration description
+ *
+ * Describes how raw sample codes of each channel map to engineering units, either
+ * as a straight line (gain/offset) or as a piecewise-linear curve through measured
+ * points. The codes are expressed at the resolution passed to the constructor.
+ * This object is only a description; it's compiled into a lookup table by
+ * AdvancedConverter::load().
+ */
+class AdvancedCalibration {
+  public:
+    typedef struct {
+        uint8_t n_points;                   // 0 for linear, otherwise number of points.
+        float gain;                         // Units per code (linear only).
+        float offset;                       // Units at code 0 (linear only).
+        Sample codes[AN_CAL_MAX_POINTS];    // Breakpoint codes, strictly increasing.
+        float values[AN_CAL_MAX_POINTS];    // Breakpoint values.
+    } channel_t;
+
+  private:
+    uint32_t res;
+    channel_t chan[AN_MAX_ADC_CHANNELS];
+
+  public:
+    /**
+     * @brief Constructor for AdvancedCalibration
+     * @param resolution ADC resolution the codes refer to (AN_RESOLUTION_8..16)
+     *
+     * All channels start as an identity mapping (gain 1, offset 0).
+     */
+    AdvancedCalibration(uint32_t resolution);
+
+    /**
+     * @brief Set a linear calibration for a channel
+     * @param channel Channel index
+     * @param gain Units per code
+     * @param offset Units at code 0
+     * @return true on success, false if the channel is out of range
+     */
+    bool linear(size_t channel, float gain, float offset = 0.0f);
+
+    /**
+     * @brief Set a linear calibration from the full-scale value of a channel
+     * @param channel Channel index
+     * @param full_scale Value at the maximum code (e.g. 3.3 for volts)
+     * @param offset Units at code 0
+     * @return true on success, false if the channel is out of range
+     */
+    bool fullscale(size_t channel, float full_scale, float offset = 0.0f);
+
+    /**
+     * @brief Set a piecewise-linear calibration for a channel
+     * @param channel Channel index
+     * @param codes Breakpoint codes, strictly increasing
+     * @param values Values at each breakpoint
+     * @param n_points Number of breakpoints (2 to AN_CAL_MAX_POINTS)
+     * @return true on success, false on invalid arguments
+     *
+     * Values outside the first/last breakpoint are extrapolated from the end segments.
+     */
+    bool points(size_t channel, const Sample *codes, const float *values, size_t n_points);
+
+    /**
+     * @brief Evaluate the calibration curve of a channel
+     * @param channel Channel index
+     * @param code Raw sample code
+     * @return Calibrated value
+     *
+     * Reference (slow) evaluation, used to build lookup tables.
+     */
+    float eval(size_t channel, float code) const;
+
+    /**
+     * @brief Get the calibration description of a channel
+     * @param channel Channel number, must be less than AN_MAX_ADC_CHANNELS
+     * @return Channel description
+     */
+    const channel_t &channel(size_t channel) const {
+        return chan[channel];
+    }
+
+    /**
+     * @brief Get the resolution the codes refer to
+     * @return Resolution enum (AN_RESOLUTION_8..16)
+     */
+    uint32_t resolution() const {
+        return res;
+    }
+};
+
+/**
+ * @brief Raw sample to engineering unit conversion stage
+ *
+ * Converts interleaved sample buffers to calibrated values using a per-channel
+ * table of AN_CAL_SEGMENTS line segments. Each sample costs one table index (the
+ * top bits of the code) and one multiply-accumulate, so linear and piecewise-linear
+ * channels run through the same branch-free kernel. Piecewise-linear curves are
+ * exact when their breakpoints fall on segment edges (multiples of full-scale
+ * / 32). Output is either float, or fixed-point with the number of fractional
+ * bits passed to the constructor. Codes above the resolution's full scale are
+ * clamped to it.
+ *
+ * Two tables are kept; load() fills the inactive one and the switch happens at the
+ * start of the next convert() call, so calibrations can be replaced while the ADC
+ * keeps running. load() must be called from a single producer (e.g. loop()), and
+ * convert() from a single consumer.
+ */
+class AdvancedConverter {
+  private:
+    typedef struct {
+        uint32_t shift;
+        uint32_t max_code;
+        float icpt[AN_MAX_ADC_CHANNELS][AN_CAL_SEGMENTS];
+        float slope[AN_MAX_ADC_CHANNELS][AN_CAL_SEGMENTS];
+        int32_t icpt_q[AN_MAX_ADC_CHANNELS][AN_CAL_SEGMENTS];
+        int32_t slope_q[AN_MAX_ADC_CHANNELS][AN_CAL_SEGMENTS];
+    } table_t;
+
+    size_t n_channels;
+    uint32_t res;
+    uint32_t q_bits;
+    table_t *tables;
+    volatile uint32_t active;
+    volatile bool pending;
+
+    const table_t *acquire();
+
+  public:
+    /**
+     * @brief Constructor for AdvancedConverter
+     * @param n_channels Number of interleaved channels
+     * @param resolution ADC resolution (AN_RESOLUTION_8..16)
+     * @param frac_bits Fractional bits of fixed-point output, at most AN_CAL_MAX_FRAC_BITS (default: 0)
+     *
+     * Until load() is called all channels convert with an identity mapping. If
+     * the resolution is invalid, every channel converts to 0.
+     */
+    AdvancedConverter(size_t n_channels, uint32_t resolution, uint32_t frac_bits = 0);
+
+    /**
+     * @brief Destructor for AdvancedConverter
+     */
+    ~AdvancedConverter();
+
+    /**
+     * @brief Load a new calibration
+     * @param cal Calibration to compile into the inactive table
+     * @return true on success, false if a previous load is still pending, the
+     * resolution doesn't match, or a coefficient overflows the fixed-point format.
+     *
+     * The new table takes effect at the next buffer boundary.
+     */
+    bool load(const AdvancedCalibration &cal);
+
+    /**
+     * @brief Check if a loaded calibration is waiting to be applied
+     * @return true if the swap hasn't happened yet
+     */
+    bool busy() const {
+        return pending;
+    }
+
+    /**
+     * @brief Convert interleaved samples to float
+     * @param in Interleaved samples
+     * @param n_frames Number of frames (samples per channel)
+     * @param out Output array of n_frames * channels() values
+     */
+    void convert(const Sample *in, size_t n_frames, float *out);
+
+    /**
+     * @brief Convert interleaved samples to fixed-point
+     * @param in Interleaved samples
+     * @param n_frames Number of frames (samples per channel)
+     * @param out Output array of n_frames * channels() values
+     */
+    void convert(const Sample *in, size_t n_frames, int32_t *out);
+
+    /**
+     * @brief Convert a sample buffer to float
+     * @param buf Sample buffer, must have channels() channels
+     * @param out Output array of buf.size() values
+     * @return Number of values written, or 0 on channel mismatch
+     */
+    size_t convert(SampleBuffer buf, float *out);
+
+    /**
+     * @brief Convert a sample buffer to fixed-point
+     * @param buf Sample buffer, must have channels() channels
+     * @param out Output array of buf.size() values
+     * @return Number of values written, or 0 on channel mismatch
+     */
+    size_t convert(SampleBuffer buf, int32_t *out);
+
+    /**
+     * @brief Get the number of channels
+     * @return Number of interleaved channels
+     */
+    size_t channels() const {
+        return n_channels;
+    }
+};
+
+#endif // __ADVANCED_CONVERTER_H__
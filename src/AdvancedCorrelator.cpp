@@ -0,0 +1,283 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedCorrelator.h"
+
+static size_t xcorr_log2(size_t n) {
+    size_t l = 0;
+    while ((1UL << l) < n) {
+        l++;
+    }
+    return l;
+}
+
+AdvancedCorrelator::AdvancedCorrelator(size_t window, size_t max_lag) :
+    n_pairs(0), n_win(window), n_lag(max_lag), n_fft(0), head(0), filled(0), use_fft(false),
+    work_a(nullptr), work_b(nullptr), twiddle(nullptr), corr(nullptr) {
+    for (size_t i = 0; i < AN_XCORR_MAX_PAIRS; i++) {
+        ring[i] = nullptr;
+    }
+
+    // Round the window to a power of two in range, lags must leave some overlap.
+    n_win = 1UL << xcorr_log2((n_win < 16) ? 16 : (n_win > AN_XCORR_MAX_WINDOW) ? AN_XCORR_MAX_WINDOW : n_win);
+    if (n_lag >= n_win / 2) {
+        n_lag = n_win / 2 - 1;
+    }
+
+    // Direct: window * (2 * lags + 1) MACs. FFT: three transforms of twice the
+    // window, roughly 9 * n * log2(n) flops.
+    n_fft = 2 * n_win;
+    use_fft = (2 * n_lag + 1) > 9 * 2 * xcorr_log2(n_fft);
+
+    corr = new float[2 * n_lag + 1];
+    if (use_fft) {
+        work_a = new float[2 * n_fft];
+        work_b = new float[2 * n_fft];
+        twiddle = new float[n_fft];
+        for (size_t k = 0; k < n_fft / 2; k++) {
+            twiddle[2 * k] = cosf(2.0f * PI * k / n_fft);
+            twiddle[2 * k + 1] = -sinf(2.0f * PI * k / n_fft);
+        }
+    } else {
+        work_a = new float[n_win];
+        work_b = new float[n_win];
+    }
+}
+
+AdvancedCorrelator::~AdvancedCorrelator() {
+    for (size_t i = 0; i < AN_XCORR_MAX_PAIRS; i++) {
+        delete[] ring[i];
+    }
+    delete[] work_a;
+    delete[] work_b;
+    delete[] twiddle;
+    delete[] corr;
+}
+
+bool AdvancedCorrelator::pair(size_t src_a, size_t ch_a, size_t src_b, size_t ch_b) {
+    if (n_pairs >= AN_XCORR_MAX_PAIRS || src_a >= AN_XCORR_MAX_SOURCES || src_b >= AN_XCORR_MAX_SOURCES ||
+        ch_a >= AN_MAX_ADC_CHANNELS || ch_b >= AN_MAX_ADC_CHANNELS) {
+        return false;
+    }
+    ring[n_pairs] = new float[2 * n_win];
+    for (size_t i = 0; i < 2 * n_win; i++) {
+        ring[n_pairs][i] = 0.0f;
+    }
+    pairs[n_pairs++] = {(uint8_t)src_a, (uint8_t)ch_a, (uint8_t)src_b, (uint8_t)ch_b};
+    return true;
+}
+
+void AdvancedCorrelator::fft(float *x, bool inverse) {
+    // In-place iterative radix-2 FFT on interleaved complex data.
+    const size_t n = n_fft;
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            float re = x[2 * i], im = x[2 * i + 1];
+            x[2 * i] = x[2 * j];
+            x[2 * i + 1] = x[2 * j + 1];
+            x[2 * j] = re;
+            x[2 * j + 1] = im;
+        }
+    }
+
+    for (size_t len = 2; len <= n; len <<= 1) {
+        size_t step = n / len;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < len / 2; k++) {
+                float wr = twiddle[2 * k * step];
+                float wi = inverse ? -twiddle[2 * k * step + 1] : twiddle[2 * k * step + 1];
+                float *u = &x[2 * (i + k)];
+                float *v = &x[2 * (i + k + len / 2)];
+                float tr = v[0] * wr - v[1] * wi;
+                float ti = v[0] * wi + v[1] * wr;
+                v[0] = u[0] - tr;
+                v[1] = u[1] - ti;
+                u[0] += tr;
+                u[1] += ti;
+            }
+        }
+    }
+}
+
+void AdvancedCorrelator::correlate(size_t p, xcorr_result_t &res) {
+    const float *ra = ring[p];
+    const float *rb = ring[p] + n_win;
+    const size_t stride = use_fft ? 2 : 1;
+
+    // Unroll the windows oldest first, and remove their means.
+    float mean_a = 0.0f, mean_b = 0.0f;
+    for (size_t i = 0; i < n_win; i++) {
+        mean_a += ra[i];
+        mean_b += rb[i];
+    }
+    mean_a /= n_win;
+    mean_b /= n_win;
+
+    float energy_a = 0.0f, energy_b = 0.0f;
+    for (size_t i = 0; i < n_win; i++) {
+        size_t j = (head + i) & (n_win - 1);
+        float a = ra[j] - mean_a;
+        float b = rb[j] - mean_b;
+        work_a[i * stride] = a;
+        work_b[i * stride] = b;
+        energy_a += a * a;
+        energy_b += b * b;
+    }
+
+    const size_t n_corr = 2 * n_lag + 1;
+    if (use_fft) {
+        // Zero-pad to twice the window so the circular correlation is linear.
+        for (size_t i = 0; i < n_win; i++) {
+            work_a[2 * i + 1] = 0.0f;
+            work_b[2 * i + 1] = 0.0f;
+        }
+        for (size_t i = 2 * n_win; i < 2 * n_fft; i++) {
+            work_a[i] = 0.0f;
+            work_b[i] = 0.0f;
+        }
+        fft(work_a, false);
+        fft(work_b, false);
+        // conj(A) * B gives r[k] = sum(a[n] * b[n + k]).
+        for (size_t i = 0; i < n_fft; i++) {
+            float ar = work_a[2 * i], ai = work_a[2 * i + 1];
+            float br = work_b[2 * i], bi = work_b[2 * i + 1];
+            work_a[2 * i] = ar * br + ai * bi;
+            work_a[2 * i + 1] = ar * bi - ai * br;
+        }
+        fft(work_a, true);
+        for (size_t i = 0; i < n_corr; i++) {
+            int k = (int)i - (int)n_lag;
+            size_t j = (k < 0) ? n_fft + k : k;
+            corr[i] = work_a[2 * j] / n_fft;
+        }
+    } else {
+        for (size_t i = 0; i < n_corr; i++) {
+            int k = (int)i - (int)n_lag;
+            size_t n0 = (k < 0) ? -k : 0;
+            size_t n1 = (k > 0) ? n_win - k : n_win;
+            float r = 0.0f;
+            for (size_t n = n0; n < n1; n++) {
+                r += work_a[n] * work_b[n + k];
+            }
+            corr[i] = r;
+        }
+    }
+
+    // Scale each lag by the number of overlapping samples (unbiased estimate),
+    // otherwise broad peaks get pulled towards lag 0.
+    for (size_t i = 0; i < n_corr; i++) {
+        int k = (int)i - (int)n_lag;
+        corr[i] *= (float)n_win / (float)(n_win - ((k < 0) ? -k : k));
+    }
+
+    size_t peak = 0;
+    for (size_t i = 1; i < n_corr; i++) {
+        peak = (corr[i] > corr[peak]) ? i : peak;
+    }
+
+    // Parabolic fit through the peak and its neighbors.
+    float offset = 0.0f;
+    if (peak > 0 && peak < n_corr - 1) {
+        float y0 = corr[peak - 1], y1 = corr[peak], y2 = corr[peak + 1];
+        float denom = y0 - 2.0f * y1 + y2;
+        if (denom < 0.0f) {
+            offset = 0.5f * (y0 - y2) / denom;
+        }
+    }
+
+    // The coefficient uses the biased (unscaled) peak, which by Cauchy-Schwarz
+    // never exceeds the product of the full-window energies.
+    int k = (int)peak - (int)n_lag;
+    float biased = corr[peak] * (float)(n_win - ((k < 0) ? -k : k)) / (float)n_win;
+    float norm = sqrtf(energy_a * energy_b);
+    res.delay = (float)k + offset;
+    res.coeff = (norm > 0.0f) ? biased / norm : 0.0f;
+}
+
+size_t AdvancedCorrelator::process(const Sample *const *src, const size_t *src_channels, size_t n_frames,
+                                   xcorr_result_t *out) {
+    if (n_pairs == 0 || n_frames == 0) {
+        return 0;
+    }
+
+    // Only the last window of frames can matter.
+    size_t first = (n_frames > n_win) ? n_frames - n_win : 0;
+    size_t h = head;
+    for (size_t p = 0; p < n_pairs; p++) {
+        const pair_t &pr = pairs[p];
+        const Sample *a = src[pr.src_a] + pr.ch_a;
+        const Sample *b = src[pr.src_b] + pr.ch_b;
+        size_t sa = src_channels[pr.src_a];
+        size_t sb = src_channels[pr.src_b];
+        float *ra = ring[p];
+        float *rb = ring[p] + n_win;
+        h = head;
+        for (size_t n = first; n < n_frames; n++) {
+            ra[h] = a[n * sa];
+            rb[h] = b[n * sb];
+            h = (h + 1) & (n_win - 1);
+        }
+    }
+    head = h;
+    filled += n_frames - first;
+    if (filled < n_win) {
+        return 0;
+    }
+    filled = n_win;
+
+    for (size_t p = 0; p < n_pairs; p++) {
+        correlate(p, out[p]);
+    }
+    return n_pairs;
+}
+
+size_t AdvancedCorrelator::process(SampleBuffer buf, xcorr_result_t *out) {
+    if (!buf) {
+        return 0;
+    }
+    const Sample *src[AN_XCORR_MAX_SOURCES] = {buf.data(), buf.data()};
+    const size_t channels[AN_XCORR_MAX_SOURCES] = {buf.channels(), buf.channels()};
+    for (size_t p = 0; p < n_pairs; p++) {
+        if (pairs[p].src_a != 0 || pairs[p].src_b != 0 || pairs[p].ch_a >= channels[0] || pairs[p].ch_b >= channels[0]) {
+            return 0;
+        }
+    }
+    return process(src, channels, buf.size() / channels[0], out);
+}
+
+size_t AdvancedCorrelator::process(SampleBuffer buf0, SampleBuffer buf1, xcorr_result_t *out) {
+    if (!buf0 || !buf1) {
+        return 0;
+    }
+    const Sample *src[AN_XCORR_MAX_SOURCES] = {buf0.data(), buf1.data()};
+    const size_t channels[AN_XCORR_MAX_SOURCES] = {buf0.channels(), buf1.channels()};
+    for (size_t p = 0; p < n_pairs; p++) {
+        if (pairs[p].ch_a >= channels[pairs[p].src_a] || pairs[p].ch_b >= channels[pairs[p].src_b]) {
+            return 0;
+        }
+    }
+    size_t n0 = buf0.size() / channels[0];
+    size_t n1 = buf1.size() / channels[1];
+    return process(src, channels, (n0 < n1) ? n0 : n1, out);
+}
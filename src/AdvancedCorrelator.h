@@ -0,0 +1,136 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_CORRELATOR_H__
+#define __ADVANCED_CORRELATOR_H__
+
+#include "AdvancedAnalog.h"
+
+#define AN_XCORR_MAX_PAIRS      (8)     // Max channel pairs per correlator.
+#define AN_XCORR_MAX_SOURCES    (2)     // Sources per frame, e.g. ADC1 and ADC2 in dual mode.
+#define AN_XCORR_MAX_WINDOW     (4096)  // Max window length in frames.
+
+/**
+ * @brief Delay estimate of one channel pair
+ */
+typedef struct {
+    float delay;        ///< Delay of b relative to a, in samples (positive if b lags).
+    float coeff;        ///< Normalized correlation coefficient at the peak (-1 to 1).
+} xcorr_result_t;
+
+/**
+ * @brief Cross-correlation and inter-channel delay estimation stage
+ *
+ * Keeps a sliding window of the last `window` frames for each configured channel
+ * pair, and after every processed block computes the cross-correlation of the
+ * mean-removed window over lags -max_lag..max_lag, scaled by the overlap of
+ * each lag (unbiased estimate). The delay is the lag of the correlation peak,
+ * refined to a fraction of a sample by parabolic interpolation, and the
+ * coefficient is the unscaled peak normalized by the channels' energies, so it
+ * stays within -1..1.
+ *
+ * Pairs may span two sources, e.g. ADC1 and ADC2 of an AdvancedADCDual, whose
+ * buffers are sampled simultaneously. The correlation is computed directly for
+ * short windows or few lags, and with a zero-padded FFT otherwise, whichever
+ * needs fewer operations.
+ */
+class AdvancedCorrelator {
+  private:
+    typedef struct {
+        uint8_t src_a, ch_a;
+        uint8_t src_b, ch_b;
+    } pair_t;
+
+    size_t n_pairs;
+    size_t n_win;
+    size_t n_lag;
+    size_t n_fft;
+    size_t head;
+    size_t filled;
+    bool use_fft;
+    pair_t pairs[AN_XCORR_MAX_PAIRS];
+    float *ring[AN_XCORR_MAX_PAIRS];    // Per pair: a then b, n_win samples each.
+    float *work_a;      // Window of a; n_fft complex values (re, im) in FFT mode.
+    float *work_b;      // Window of b; same layout as work_a.
+    float *twiddle;     // n_fft / 2 complex roots of unity, FFT mode only.
+    float *corr;        // 2 * n_lag + 1 correlation values.
+
+    void fft(float *x, bool inverse);
+    void correlate(size_t pair, xcorr_result_t &res);
+
+  public:
+    /**
+     * @brief Constructor for AdvancedCorrelator
+     * @param window Window length in frames, a power of two (16 to AN_XCORR_MAX_WINDOW)
+     * @param max_lag Largest lag searched in samples, less than window / 2
+     */
+    AdvancedCorrelator(size_t window, size_t max_lag);
+
+    /**
+     * @brief Destructor for AdvancedCorrelator
+     */
+    ~AdvancedCorrelator();
+
+    /**
+     * @brief Add a channel pair
+     * @param src_a Source of channel a
+     * @param ch_a Channel a, inside its source's interleaved buffer
+     * @param src_b Source of channel b
+     * @param ch_b Channel b, inside its source's interleaved buffer
+     * @return true on success, false if all pairs are used or arguments are invalid
+     */
+    bool pair(size_t src_a, size_t ch_a, size_t src_b, size_t ch_b);
+
+    /**
+     * @brief Add frames and estimate the delay of every pair
+     * @param src Array of per-source interleaved sample pointers
+     * @param src_channels Array of per-source channel counts (frame stride)
+     * @param n_frames Number of frames
+     * @param out Output array with one result per pair
+     * @return Number of results written, 0 until the window has filled
+     */
+    size_t process(const Sample *const *src, const size_t *src_channels, size_t n_frames, xcorr_result_t *out);
+
+    /**
+     * @brief Add a buffer (single source) and estimate the delay of every pair
+     * @param buf Sample buffer of source 0
+     * @param out Output array with one result per pair
+     * @return Number of results written
+     */
+    size_t process(SampleBuffer buf, xcorr_result_t *out);
+
+    /**
+     * @brief Add simultaneous buffers of two sources and estimate the delay of every pair
+     * @param buf0 Sample buffer of source 0 (e.g. ADC1)
+     * @param buf1 Sample buffer of source 1 (e.g. ADC2)
+     * @param out Output array with one result per pair
+     * @return Number of results written
+     */
+    size_t process(SampleBuffer buf0, SampleBuffer buf1, xcorr_result_t *out);
+
+    /**
+     * @brief Discard the window contents
+     */
+    void reset() {
+        head = 0;
+        filled = 0;
+    }
+};
+
+#endif // __ADVANCED_CORRELATOR_H__
@@ -0,0 +1,163 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedFSR.h"
+
+static const uint8_t FSR_RES_BITS[] = {8, 10, 12, 14, 16};
+
+// Codes above the resolution would index past the end of a table.
+static inline uint32_t fsr_clamp(uint32_t code, uint32_t max_code) {
+    return (code > max_code) ? max_code : code;
+}
+
+AdvancedFSR::AdvancedFSR(size_t n_channels, uint32_t resolution, float force_lsb, uint32_t table_bits) :
+    n_channels(n_channels), res(resolution), shift(0), t_bits(table_bits), max_code(0), lsb(force_lsb) {
+    if (this->n_channels > AN_MAX_ADC_CHANNELS) {
+        this->n_channels = AN_MAX_ADC_CHANNELS;
+    }
+
+    for (size_t i = 0; i < AN_MAX_ADC_CHANNELS; i++) {
+        lut[i] = nullptr;
+    }
+
+    // The table never needs more entries than there are codes.
+    uint32_t bits = (res < AN_ARRAY_SIZE(FSR_RES_BITS)) ? FSR_RES_BITS[res] : 16;
+    if (t_bits > bits) {
+        t_bits = bits;
+    }
+    shift = bits - t_bits;
+    max_code = (1UL << bits) - 1;
+}
+
+AdvancedFSR::~AdvancedFSR() {
+    for (size_t i = 0; i < AN_MAX_ADC_CHANNELS; i++) {
+        delete[] lut[i];
+        lut[i] = nullptr;
+    }
+}
+
+uint16_t *AdvancedFSR::table(size_t channel) {
+    if (channel >= n_channels || res >= AN_ARRAY_SIZE(FSR_RES_BITS)) {
+        return nullptr;
+    }
+    if (lut[channel] == nullptr) {
+        lut[channel] = new uint16_t[1UL << t_bits];
+    }
+    return lut[channel];
+}
+
+uint16_t AdvancedFSR::quantize(float force) const {
+    float v = force / lsb + 0.5f;
+    // Negative forces and NaNs clamp to 0, open circuit saturates.
+    if (!(v > 0.0f)) {
+        return 0;
+    }
+    return (v >= 65535.0f) ? 65535 : (uint16_t)v;
+}
+
+bool AdvancedFSR::conductance(size_t channel, float r_ref, float a, float b, fsr_divider_t wiring) {
+    uint16_t *t = table(channel);
+    if (t == nullptr || r_ref <= 0.0f) {
+        return false;
+    }
+
+    const float fs = (float)((1UL << FSR_RES_BITS[res]) - 1);
+    const size_t n_entries = 1UL << t_bits;
+    for (size_t i = 0; i < n_entries; i++) {
+        // Use the center of the code range covered by this entry.
+        float code = (float)(i << shift) + (float)((1UL << shift) - 1) * 0.5f;
+        // Divider ratio as seen by the FSR: R_fsr = r_ref * num / den.
+        float num = (wiring == AN_FSR_HIGH_SIDE) ? (fs - code) : code;
+        float den = (wiring == AN_FSR_HIGH_SIDE) ? code : (fs - code);
+        if (den <= 0.0f) {
+            t[i] = 0;
+        } else if (num <= 0.0f) {
+            t[i] = 65535;
+        } else {
+            float g_us = 1e6f * den / (r_ref * num);
+            t[i] = quantize(a * powf(g_us, b));
+        }
+    }
+    return true;
+}
+
+bool AdvancedFSR::curve(size_t channel, const AdvancedCalibration &cal) {
+    if (cal.resolution() != res) {
+        return false;
+    }
+
+    uint16_t *t = table(channel);
+    if (t == nullptr) {
+        return false;
+    }
+
+    const size_t n_entries = 1UL << t_bits;
+    for (size_t i = 0; i < n_entries; i++) {
+        float code = (float)(i << shift) + (float)((1UL << shift) - 1) * 0.5f;
+        t[i] = quantize(cal.eval(channel, code));
+    }
+    return true;
+}
+
+void AdvancedFSR::convert(const Sample *in, size_t n_frames, uint16_t *out) {
+    const size_t stride = n_channels;
+    const uint32_t s = shift;
+    const uint32_t m = max_code;
+
+    for (size_t ch = 0; ch < n_channels; ch++) {
+        const uint16_t *t = lut[ch];
+        const Sample *src = in + ch;
+        uint16_t *dst = out + ch;
+        if (t == nullptr) {
+            for (size_t i = 0; i < n_frames; i++, dst += stride) {
+                *dst = 0;
+            }
+            continue;
+        }
+        size_t i = 0;
+        for (; i + 4 <= n_frames; i += 4) {
+            dst[0] = t[fsr_clamp(src[0], m) >> s];
+            dst[stride] = t[fsr_clamp(src[stride], m) >> s];
+            dst[2 * stride] = t[fsr_clamp(src[2 * stride], m) >> s];
+            dst[3 * stride] = t[fsr_clamp(src[3 * stride], m) >> s];
+            src += 4 * stride;
+            dst += 4 * stride;
+        }
+        for (; i < n_frames; i++) {
+            *dst = t[fsr_clamp(*src, m) >> s];
+            src += stride;
+            dst += stride;
+        }
+    }
+}
+
+size_t AdvancedFSR::convert(SampleBuffer buf, uint16_t *out) {
+    if (!buf || buf.channels() != n_channels) {
+        return 0;
+    }
+    convert(buf.data(), buf.size() / n_channels, out);
+    return buf.size();
+}
+
+uint16_t AdvancedFSR::force(size_t channel, Sample code) const {
+    if (channel >= n_channels || lut[channel] == nullptr) {
+        return 0;
+    }
+    return lut[channel][fsr_clamp(code, max_code) >> shift];
+}
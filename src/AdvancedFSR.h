@@ -0,0 +1,175 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_FSR_H__
+#define __ADVANCED_FSR_H__
+
+#include "AdvancedAnalog.h"
+#include "AdvancedConverter.h"
+
+/**
+ * @brief FSR divider wiring
+ *
+ * Selects which side of the voltage divider the force-sensing resistor is on.
+ */
+typedef enum {
+    AN_FSR_HIGH_SIDE = 0U,      ///< FSR to VCC, reference resistor to GND (code rises with force).
+    AN_FSR_LOW_SIDE  = 1U,      ///< Reference resistor to VCC, FSR to GND (code falls with force).
+} fsr_divider_t;
+
+/**
+ * @brief Force-sensing resistor linearization stage
+ *
+ * Converts FSR divider codes to force through a precomputed table per channel,
+ * indexed directly by the sample code, so conversion costs one shift and one
+ * load per sample. Tables hold unsigned 16-bit forces in units of force_lsb
+ * (e.g. 0.01 for centinewtons), and have 2^table_bits entries; at 12 bits or
+ * less every code has its own entry, at 16 bits the default table keeps the
+ * top 12 bits of the code (8KB per channel) unless a full 65536-entry table
+ * is requested.
+ *
+ * Tables are built from either a conductance model, F = a * G^b with G the FSR
+ * conductance in microsiemens (FSR force is close to proportional to conductance),
+ * or a measured code-to-force curve.
+ */
+class AdvancedFSR {
+  private:
+    size_t n_channels;
+    uint32_t res;
+    uint32_t shift;
+    uint32_t t_bits;
+    uint32_t max_code;
+    float lsb;
+    uint16_t *lut[AN_MAX_ADC_CHANNELS];
+
+    uint16_t *table(size_t channel);
+    uint16_t quantize(float force) const;
+
+  public:
+    /**
+     * @brief Constructor for AdvancedFSR
+     * @param n_channels Number of interleaved channels
+     * @param resolution ADC resolution (AN_RESOLUTION_8..16)
+     * @param force_lsb Force represented by one output unit (e.g. 0.01 for 10mN)
+     * @param table_bits Log2 of the table size, capped at the resolution (default: 12)
+     */
+    AdvancedFSR(size_t n_channels, uint32_t resolution, float force_lsb, uint32_t table_bits = 12);
+
+    /**
+     * @brief Destructor for AdvancedFSR
+     *
+     * Releases all channel tables.
+     */
+    ~AdvancedFSR();
+
+    /**
+     * @brief Build a channel table from the conductance model
+     * @param channel Channel index
+     * @param r_ref Divider reference resistor in ohms
+     * @param a Model scale, force at 1uS
+     * @param b Model exponent (default: 1, force proportional to conductance)
+     * @param wiring Divider wiring (default: AN_FSR_HIGH_SIDE)
+     * @return true on success, false on invalid arguments or allocation failure
+     */
+    bool conductance(size_t channel, float r_ref, float a, float b = 1.0f,
+                     fsr_divider_t wiring = AN_FSR_HIGH_SIDE);
+
+    /**
+     * @brief Build a channel table from a measured code-to-force curve
+     * @param channel Channel index
+     * @param cal Calibration whose channel curve gives the force at each code
+     * @return true on success, false on resolution mismatch or allocation failure
+     *
+     * The curve is evaluated (linearly interpolated between measured points) at
+     * every table entry, so the cost of interpolation is paid once here.
+     */
+    bool curve(size_t channel, const AdvancedCalibration &cal);
+
+    /**
+     * @brief Convert interleaved codes to force
+     * @param in Interleaved samples
+     * @param n_frames Number of frames (samples per channel)
+     * @param out Output array of n_frames * channels() forces, in force_lsb units
+     *
+     * Channels without a table output 0.
+     */
+    void convert(const Sample *in, size_t n_frames, uint16_t *out);
+
+    /**
+     * @brief Convert a sample buffer to force
+     * @param buf Sample buffer, must have channels() channels
+     * @param out Output array of buf.size() forces, in force_lsb units
+     * @return Number of values written, or 0 on channel mismatch
+     */
+    size_t convert(SampleBuffer buf, uint16_t *out);
+
+    /**
+     * @brief Look up the force of a single code
+     * @param channel Channel index
+     * @param code Raw sample code
+     * @return Force in force_lsb units
+     */
+    uint16_t force(size_t channel, Sample code) const;
+
+    /**
+     * @brief Get the table of a channel
+     * @param channel Channel index
+     * @return Pointer to the table, or nullptr if the channel has no table
+     *
+     * Entries are indexed by (code >> lookup_shift()), for stages that fuse the
+     * lookup into their own loop; codes must be clamped to lookup_max() first.
+     */
+    const uint16_t *lookup(size_t channel) const {
+        return (channel < n_channels) ? lut[channel] : nullptr;
+    }
+
+    /**
+     * @brief Get the code shift used to index the tables
+     * @return Number of low code bits dropped by the table index
+     */
+    uint32_t lookup_shift() const {
+        return shift;
+    }
+
+    /**
+     * @brief Get the largest code the tables cover
+     * @return Full-scale code of the resolution
+     */
+    uint32_t lookup_max() const {
+        return max_code;
+    }
+
+    /**
+     * @brief Get the force of one output unit
+     * @return The force_lsb passed to the constructor
+     */
+    float unit() const {
+        return lsb;
+    }
+
+    /**
+     * @brief Get the number of channels
+     * @return Number of interleaved channels
+     */
+    size_t channels() const {
+        return n_channels;
+    }
+};
+
+#endif // __ADVANCED_FSR_H__
@@ -0,0 +1,241 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedFanout.h"
+#include "mbed.h"
+
+AdvancedFanout::AdvancedFanout(AdvancedADC &adc, size_t depth) :
+    adc(adc), depth(1), entries(nullptr), n_active(0) {
+    // Power of two, so the free-running queue indices wrap cleanly; rounded
+    // down, so it never exceeds the requested depth.
+    while (this->depth * 2 <= depth && this->depth < AN_FANOUT_MAX_DEPTH) {
+        this->depth <<= 1;
+    }
+    entries = new entry_t[this->depth];
+    for (size_t i = 0; entries && i < this->depth; i++) {
+        entries[i].buf = nullptr;
+        entries[i].refs = 0;
+    }
+    for (size_t i = 0; i < AN_FANOUT_MAX_SUBSCRIBERS; i++) {
+        subs[i].active = false;
+        subs[i].queue = nullptr;
+    }
+}
+
+AdvancedFanout::~AdvancedFanout() {
+    core_util_critical_section_enter();
+    for (size_t i = 0; entries && i < depth; i++) {
+        if (entries[i].buf) {
+            entries[i].buf->release();
+            entries[i].buf = nullptr;
+        }
+    }
+    core_util_critical_section_exit();
+    for (size_t i = 0; i < AN_FANOUT_MAX_SUBSCRIBERS; i++) {
+        delete[] subs[i].queue;
+    }
+    delete[] entries;
+}
+
+int AdvancedFanout::subscribe(size_t max_lag) {
+    if (entries == nullptr) {
+        return -1;
+    }
+    for (size_t i = 0; i < AN_FANOUT_MAX_SUBSCRIBERS; i++) {
+        subscriber_t &sub = subs[i];
+        if (sub.active) {
+            continue;
+        }
+        if (sub.queue == nullptr && (sub.queue = new uint8_t[depth]) == nullptr) {
+            return -1;
+        }
+        core_util_critical_section_enter();
+        sub.max_lag = (max_lag == 0 || max_lag > depth) ? depth : max_lag;
+        sub.head = sub.tail = 0;
+        sub.n_dropped = 0;
+        sub.max_seen = 0;
+        sub.active = true;
+        n_active++;
+        core_util_critical_section_exit();
+        return i;
+    }
+    return -1;
+}
+
+void AdvancedFanout::unsubscribe(int id) {
+    if (id < 0 || id >= AN_FANOUT_MAX_SUBSCRIBERS || !subs[id].active) {
+        return;
+    }
+    core_util_critical_section_enter();
+    subscriber_t &sub = subs[id];
+    while (sub.head != sub.tail) {
+        unref(sub.queue[sub.tail++ & (depth - 1)]);
+    }
+    sub.active = false;
+    n_active--;
+    core_util_critical_section_exit();
+}
+
+void AdvancedFanout::unref(size_t index) {
+    // The last reference returns the buffer to the ADC's pool.
+    if (__atomic_sub_fetch(&entries[index].refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        entries[index].buf->release();
+        entries[index].buf = nullptr;
+    }
+}
+
+void AdvancedFanout::drop(subscriber_t &sub) {
+    unref(sub.queue[sub.tail++ & (depth - 1)]);
+    sub.n_dropped++;
+}
+
+AdvancedFanout::subscriber_t *AdvancedFanout::slowest() {
+    subscriber_t *slow = nullptr;
+    for (size_t i = 0; i < AN_FANOUT_MAX_SUBSCRIBERS; i++) {
+        if (subs[i].active && subs[i].head != subs[i].tail
+                && (slow == nullptr || subs[i].head - subs[i].tail > slow->head - slow->tail)) {
+            slow = &subs[i];
+        }
+    }
+    return slow;
+}
+
+void AdvancedFanout::pump() {
+    // Called with interrupts disabled; only moves pointers, never sample data.
+    // The ADC needs a free buffer at every completion, or it drops data for
+    // all subscribers: unread buffers of the slowest go back first.
+    subscriber_t *slow;
+    while (!adc.writable() && (slow = slowest()) != nullptr) {
+        drop(*slow);
+    }
+
+    while (adc.available()) {
+        size_t index = depth;
+        for (;;) {
+            for (size_t i = 0; i < depth && index == depth; i++) {
+                if (entries[i].buf == nullptr) {
+                    index = i;
+                }
+            }
+            if (index < depth) {
+                break;
+            }
+            // Every entry is in use: drop for the subscriber furthest behind.
+            subscriber_t *slow = slowest();
+            if (slow == nullptr) {
+                // All buffers are being read; leave the rest in the ADC's queue.
+                return;
+            }
+            drop(*slow);
+        }
+
+        SampleBuffer buf = adc.read();
+        if (n_active == 0) {
+            buf.release();
+            continue;
+        }
+        entries[index].buf = &buf;
+        entries[index].refs = n_active;
+        for (size_t i = 0; i < AN_FANOUT_MAX_SUBSCRIBERS; i++) {
+            subscriber_t &sub = subs[i];
+            if (!sub.active) {
+                continue;
+            }
+            if (sub.head - sub.tail >= sub.max_lag) {
+                drop(sub);
+            }
+            sub.queue[sub.head++ & (depth - 1)] = index;
+            if (sub.head - sub.tail > sub.max_seen) {
+                sub.max_seen = sub.head - sub.tail;
+            }
+        }
+    }
+}
+
+bool AdvancedFanout::available(int id) {
+    if (id < 0 || id >= AN_FANOUT_MAX_SUBSCRIBERS || !subs[id].active) {
+        return false;
+    }
+    core_util_critical_section_enter();
+    pump();
+    bool ready = subs[id].head != subs[id].tail;
+    core_util_critical_section_exit();
+    return ready;
+}
+
+SampleBuffer AdvancedFanout::read(int id) {
+    static DMABuffer<Sample> NULLBUF;
+    if (id < 0 || id >= AN_FANOUT_MAX_SUBSCRIBERS || !subs[id].active) {
+        return NULLBUF;
+    }
+    // Check and pop in one critical section: another subscriber's pump() could
+    // drop this one's only buffer in between. Subscribers in other threads may
+    // take the ADC event first, so wake up now and then.
+    subscriber_t &sub = subs[id];
+    for (;;) {
+        core_util_critical_section_enter();
+        pump();
+        if (sub.head != sub.tail) {
+            DMABuffer<Sample> *buf = entries[sub.queue[sub.tail++ & (depth - 1)]].buf;
+            core_util_critical_section_exit();
+            return *buf;
+        }
+        // Buffers still ready means every entry is being read: wait() would
+        // return at once, so sleep to let the readers release them.
+        bool held = adc.available();
+        core_util_critical_section_exit();
+        if (held) {
+            delay(1);
+        } else {
+            adc.wait(1);
+        }
+    }
+}
+
+void AdvancedFanout::release(SampleBuffer buf) {
+    core_util_critical_section_enter();
+    for (size_t i = 0; entries && i < depth; i++) {
+        if (entries[i].buf == &buf) {
+            unref(i);
+            break;
+        }
+    }
+    core_util_critical_section_exit();
+}
+
+size_t AdvancedFanout::lag(int id) const {
+    if (id < 0 || id >= AN_FANOUT_MAX_SUBSCRIBERS || !subs[id].active) {
+        return 0;
+    }
+    return subs[id].head - subs[id].tail;
+}
+
+size_t AdvancedFanout::max_lag(int id) const {
+    if (id < 0 || id >= AN_FANOUT_MAX_SUBSCRIBERS || !subs[id].active) {
+        return 0;
+    }
+    return subs[id].max_seen;
+}
+
+uint32_t AdvancedFanout::dropped(int id) const {
+    if (id < 0 || id >= AN_FANOUT_MAX_SUBSCRIBERS || !subs[id].active) {
+        return 0;
+    }
+    return subs[id].n_dropped;
+}
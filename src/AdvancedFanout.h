@@ -0,0 +1,139 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_FANOUT_H__
+#define __ADVANCED_FANOUT_H__
+
+#include "AdvancedADC.h"
+
+#define AN_FANOUT_MAX_SUBSCRIBERS   (8)
+#define AN_FANOUT_MAX_DEPTH         (128)
+
+/**
+ * @brief Shares every ADC buffer between several consumers, without copies
+ *
+ * Each buffer taken from the ADC is handed to every subscriber, with a
+ * reference count of the subscribers that still need it; it's returned to
+ * the ADC's pool when the last one releases it. Every subscriber has its
+ * own queue, so a slow subscriber (e.g. a logger) never holds up a fast one
+ * (e.g. a detector): when its queue reaches its lag limit, or no buffer is
+ * left to take from the ADC, its oldest unread buffer is dropped for that
+ * subscriber only and counted.
+ *
+ * Subscribers can run in different threads. Each must release every buffer
+ * it reads with AdvancedFanout::release(), never with buf.release().
+ */
+class AdvancedFanout {
+  private:
+    typedef struct {
+        DMABuffer<Sample> *buf;
+        uint32_t refs;
+    } entry_t;
+
+    typedef struct {
+        bool active;
+        size_t max_lag;
+        uint8_t *queue;
+        uint32_t head;
+        uint32_t tail;
+        uint32_t n_dropped;
+        uint32_t max_seen;
+    } subscriber_t;
+
+    AdvancedADC &adc;
+    size_t depth;
+    entry_t *entries;
+    subscriber_t subs[AN_FANOUT_MAX_SUBSCRIBERS];
+    size_t n_active;
+
+    void unref(size_t index);
+    void drop(subscriber_t &sub);
+    subscriber_t *slowest();
+    void pump();
+
+  public:
+    /**
+     * @brief Constructor for AdvancedFanout
+     * @param adc ADC to take buffers from
+     * @param depth Buffers in flight at once, at most the ADC's n_buffers, rounded down to a power of two (default: 8)
+     */
+    AdvancedFanout(AdvancedADC &adc, size_t depth = 8);
+
+    /**
+     * @brief Destructor for AdvancedFanout
+     *
+     * Returns any buffers still in flight to the ADC.
+     */
+    ~AdvancedFanout();
+
+    /**
+     * @brief Add a subscriber
+     * @param max_lag Most unread buffers kept for this subscriber, 0 for the fan-out depth (default: 0)
+     * @return Subscriber id, or -1 if there's no room for another subscriber
+     */
+    int subscribe(size_t max_lag = 0);
+
+    /**
+     * @brief Remove a subscriber and drop its unread buffers
+     * @param id Subscriber id
+     *
+     * Buffers it has read must still be released.
+     */
+    void unsubscribe(int id);
+
+    /**
+     * @brief Check if a buffer is available for a subscriber
+     * @param id Subscriber id
+     */
+    bool available(int id);
+
+    /**
+     * @brief Read the next buffer of a subscriber
+     * @param id Subscriber id
+     *
+     * Waits for a buffer if none is available.
+     */
+    SampleBuffer read(int id);
+
+    /**
+     * @brief Release a buffer read by a subscriber
+     * @param buf Sample buffer returned by read()
+     */
+    void release(SampleBuffer buf);
+
+    /**
+     * @brief Get the number of buffers waiting to be read by a subscriber
+     * @param id Subscriber id
+     */
+    size_t lag(int id) const;
+
+    /**
+     * @brief Get the highest number of buffers that waited for a subscriber
+     * @param id Subscriber id
+     */
+    size_t max_lag(int id) const;
+
+    /**
+     * @brief Get the number of buffers dropped for a subscriber
+     * @param id Subscriber id
+     */
+    uint32_t dropped(int id) const;
+};
+
+#endif // __ADVANCED_FANOUT_H__
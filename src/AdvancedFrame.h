@@ -0,0 +1,95 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_FRAME_H__
+#define __ADVANCED_FRAME_H__
+
+// NOTE: This header is shared with the host tools in extras/, so it must
+// only depend on the standard C headers.
+#include <stddef.h>
+#include <stdint.h>
+
+#define AN_FRAME_SYNC0          (0xA5)
+#define AN_FRAME_SYNC1          (0x5A)
+#define AN_FRAME_VERSION        (1)
+#define AN_FRAME_HEADER_SIZE    (24)
+#define AN_FRAME_TRAILER_SIZE   (4)     // CRC32 of header and payload.
+#define AN_FRAME_MAX_CHANNELS   (16)
+#define AN_FRAME_MAX_SAMPLES    (65536) // Max samples per frame, all channels.
+
+/**
+ * @brief Frame payload encodings
+ */
+enum {
+    AN_FRAME_RAW        = 0U,   ///< Little-endian uint16_t samples, interleaved.
+    AN_FRAME_PACKED     = 1U,   ///< Samples bit-packed at the frame resolution, see AdvancedPack.h.
+    AN_FRAME_RICE       = 2U,   ///< Lossless predictor and Rice coded block, see AdvancedCodec.h.
+};
+
+/**
+ * @brief Frame flags
+ */
+enum {
+    AN_FRAME_DISCONT    = (1U << 0),    ///< Samples were lost before this frame.
+};
+
+/**
+ * @brief Binary frame header
+ *
+ * Every frame is a header, a payload of payload_bytes bytes, and the CRC32
+ * (IEEE 802.3) of header and payload. All fields are little-endian. The
+ * sequence number increments for every frame the sender produces, including
+ * frames it had to drop, so receivers can count lost frames from the gaps.
+ */
+typedef struct {
+    uint8_t sync[2];            ///< AN_FRAME_SYNC0, AN_FRAME_SYNC1.
+    uint8_t version;            ///< AN_FRAME_VERSION.
+    uint8_t adc_id;             ///< ADC instance (1-3), 0 if unknown.
+    uint8_t channels;           ///< Interleaved channels per frame of samples.
+    uint8_t resolution;         ///< AN_RESOLUTION_x of the samples.
+    uint8_t encoding;           ///< AN_FRAME_x payload encoding.
+    uint8_t flags;              ///< AN_FRAME_x flags.
+    uint32_t sequence;          ///< Frame sequence number.
+    uint32_t timestamp;         ///< Time of the first sample, in us.
+    uint32_t n_samples;         ///< Samples in the payload (all channels).
+    uint32_t payload_bytes;     ///< Payload size in bytes.
+} frame_header_t;
+
+/**
+ * @brief Check that a frame header is consistent
+ * @param hdr Frame header
+ * @return true if the sync, version, channels, resolution and encoding are
+ * valid, n_samples is a whole number of frames up to AN_FRAME_MAX_SAMPLES, and
+ * payload_bytes matches n_samples for the encoding
+ *
+ * Receivers use this to reject false syncs before waiting for the payload.
+ * Needs AdvancedPack.cpp and AdvancedCodec.cpp to be linked in.
+ */
+bool an_frame_check(const frame_header_t *hdr);
+
+/**
+ * @brief Update a CRC32 (IEEE 802.3, reflected) with a block of data
+ * @param crc Running CRC, start with 0
+ * @param data Data to add
+ * @param len Size of data in bytes
+ * @return Updated CRC
+ */
+uint32_t an_crc32(uint32_t crc, const void *data, size_t len);
+
+#endif // __ADVANCED_FRAME_H__
@@ -0,0 +1,247 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedHistogram.h"
+
+static const uint8_t HIST_RES_BITS[] = {8, 10, 12, 14, 16};
+
+AdvancedHistogram::AdvancedHistogram(size_t n_channels, uint32_t resolution, uint32_t bin_bits) :
+    n_channels(n_channels), n_bins(0), shift(0), n_quantiles(0), counts(nullptr), p2(nullptr), seq(0) {
+    if (this->n_channels > AN_MAX_ADC_CHANNELS) {
+        this->n_channels = AN_MAX_ADC_CHANNELS;
+    }
+
+    uint32_t bits = (resolution < AN_ARRAY_SIZE(HIST_RES_BITS)) ? HIST_RES_BITS[resolution] : 16;
+    if (bin_bits > bits) {
+        bin_bits = bits;
+    }
+    n_bins = 1UL << bin_bits;
+    shift = bits - bin_bits;
+
+    counts = new uint32_t[this->n_channels * n_bins];
+    p2 = new p2_t[this->n_channels * AN_HIST_MAX_QUANTILES];
+    clear();
+}
+
+AdvancedHistogram::~AdvancedHistogram() {
+    delete[] counts;
+    delete[] p2;
+}
+
+void AdvancedHistogram::clear() {
+    seq++;
+    __DMB();
+    for (size_t i = 0; i < n_channels * n_bins; i++) {
+        counts[i] = 0;
+    }
+    for (size_t i = 0; i < n_channels * AN_HIST_MAX_QUANTILES; i++) {
+        p2[i].count = 0;
+    }
+    __DMB();
+    seq++;
+}
+
+bool AdvancedHistogram::quantiles(const float *p, size_t n) {
+    if (n > AN_HIST_MAX_QUANTILES) {
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (!(p[i] > 0.0f && p[i] < 1.0f)) {
+            return false;
+        }
+    }
+
+    seq++;
+    __DMB();
+    for (size_t i = 0; i < n; i++) {
+        prob[i] = p[i];
+    }
+    n_quantiles = n;
+    for (size_t i = 0; i < n_channels * AN_HIST_MAX_QUANTILES; i++) {
+        p2[i].count = 0;
+    }
+    __DMB();
+    seq++;
+    return true;
+}
+
+void AdvancedHistogram::p2_update(p2_t *m, float p, float x) {
+    // Startup: collect the first five samples, sorted.
+    if (m->count < 5) {
+        size_t i = m->count++;
+        for (; i > 0 && m->q[i - 1] > x; i--) {
+            m->q[i] = m->q[i - 1];
+        }
+        m->q[i] = x;
+        if (m->count == 5) {
+            for (size_t j = 0; j < 5; j++) {
+                m->n[j] = j;
+            }
+            m->np[0] = 0.0f;
+            m->np[1] = 2.0f * p;
+            m->np[2] = 4.0f * p;
+            m->np[3] = 2.0f + 2.0f * p;
+            m->np[4] = 4.0f;
+        }
+        return;
+    }
+
+    // Find the cell of x, extending the extremes if needed.
+    size_t k;
+    if (x < m->q[0]) {
+        m->q[0] = x;
+        k = 0;
+    } else if (x >= m->q[4]) {
+        m->q[4] = x;
+        k = 3;
+    } else {
+        k = 0;
+        while (x >= m->q[k + 1]) {
+            k++;
+        }
+    }
+
+    for (size_t i = k + 1; i < 5; i++) {
+        m->n[i]++;
+    }
+    m->np[1] += p * 0.5f;
+    m->np[2] += p;
+    m->np[3] += (1.0f + p) * 0.5f;
+    m->np[4] += 1.0f;
+
+    // Move the middle markers towards their desired positions.
+    for (size_t i = 1; i < 4; i++) {
+        float d = m->np[i] - m->n[i];
+        if ((d >= 1.0f && m->n[i + 1] - m->n[i] > 1) || (d <= -1.0f && m->n[i - 1] - m->n[i] < -1)) {
+            int32_t ds = (d > 0.0f) ? 1 : -1;
+            float n0 = m->n[i - 1], n1 = m->n[i], n2 = m->n[i + 1];
+            float q0 = m->q[i - 1], q1 = m->q[i], q2 = m->q[i + 1];
+            // Piecewise-parabolic prediction, linear if it breaks monotonicity.
+            float qp = q1 + ds / (n2 - n0) * ((n1 - n0 + ds) * (q2 - q1) / (n2 - n1) +
+                                              (n2 - n1 - ds) * (q1 - q0) / (n1 - n0));
+            if (!(q0 < qp && qp < q2)) {
+                qp = q1 + ds * (m->q[i + ds] - q1) / (float)(m->n[i + ds] - m->n[i]);
+            }
+            m->q[i] = qp;
+            m->n[i] += ds;
+        }
+    }
+}
+
+void AdvancedHistogram::process(const Sample *in, size_t n_frames) {
+    seq++;
+    __DMB();
+
+    for (size_t ch = 0; ch < n_channels; ch++) {
+        uint32_t *h = &counts[ch * n_bins];
+        const Sample *src = in + ch;
+        const uint32_t s = shift;
+        const uint32_t last = n_bins - 1;
+        for (size_t i = 0; i < n_frames; i++) {
+            uint32_t b = src[i * n_channels] >> s;
+            h[(b < last) ? b : last]++;
+        }
+
+        for (size_t j = 0; j < n_quantiles; j++) {
+            p2_t *m = &p2[ch * AN_HIST_MAX_QUANTILES + j];
+            for (size_t i = 0; i < n_frames; i++) {
+                p2_update(m, prob[j], src[i * n_channels]);
+            }
+        }
+    }
+
+    __DMB();
+    seq++;
+}
+
+bool AdvancedHistogram::process(SampleBuffer buf) {
+    if (!buf || buf.channels() != n_channels) {
+        return false;
+    }
+    process(buf.data(), buf.size() / n_channels);
+    return true;
+}
+
+bool AdvancedHistogram::begin_read(uint32_t *s, size_t attempt) const {
+    // Back off on retries; yield() only lets threads of the same priority
+    // run, so sleep to let a lower-priority writer finish its update.
+    if (attempt >= 4) {
+        delay(1);
+    } else if (attempt) {
+        yield();
+    }
+    *s = seq;
+    __DMB();
+    return (*s & 1) == 0;
+}
+
+bool AdvancedHistogram::end_read(uint32_t s) const {
+    __DMB();
+    return seq == s;
+}
+
+uint32_t AdvancedHistogram::snapshot(size_t channel, uint32_t *out) const {
+    if (channel >= n_channels) {
+        return 0;
+    }
+
+    uint32_t s, total;
+    for (size_t attempt = 0; attempt < AN_HIST_MAX_RETRIES; attempt++) {
+        if (!begin_read(&s, attempt)) {
+            continue;
+        }
+        total = 0;
+        const uint32_t *h = &counts[channel * n_bins];
+        for (size_t i = 0; i < n_bins; i++) {
+            out[i] = h[i];
+            total += h[i];
+        }
+        if (end_read(s)) {
+            return total;
+        }
+    }
+    return 0;
+}
+
+float AdvancedHistogram::quantile(size_t channel, size_t index) const {
+    if (channel >= n_channels || index >= n_quantiles) {
+        return NAN;
+    }
+
+    uint32_t s;
+    float v;
+    for (size_t attempt = 0; attempt < AN_HIST_MAX_RETRIES; attempt++) {
+        if (!begin_read(&s, attempt)) {
+            continue;
+        }
+        const p2_t *m = &p2[channel * AN_HIST_MAX_QUANTILES + index];
+        if (m->count == 0) {
+            v = NAN;
+        } else if (m->count < 5) {
+            // Not enough samples for the markers, use the sorted startup samples.
+            v = m->q[(size_t)(prob[index] * (m->count - 1) + 0.5f)];
+        } else {
+            v = m->q[2];
+        }
+        if (end_read(s)) {
+            return v;
+        }
+    }
+    return NAN;
+}
@@ -0,0 +1,160 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_HISTOGRAM_H__
+#define __ADVANCED_HISTOGRAM_H__
+
+#include "AdvancedAnalog.h"
+
+#define AN_HIST_MAX_QUANTILES   (4)     // Max quantiles tracked per channel.
+#define AN_HIST_MAX_RETRIES     (100)   // Read attempts before a snapshot gives up, about 1ms each.
+
+/**
+ * @brief Streaming histogram and quantile estimation stage
+ *
+ * Accumulates a per-channel histogram of 2^bin_bits bins, indexed directly by
+ * the top bits of each sample code: one shift, one clamp and one increment per
+ * sample, with no branches; codes above the resolution's range count in the
+ * last bin. Optionally, up to AN_HIST_MAX_QUANTILES quantiles per channel are
+ * tracked with the P-square algorithm (Jain & Chlamtac), which keeps five
+ * markers per quantile instead of the samples themselves.
+ *
+ * Snapshots can be taken from another thread while process() runs: updates
+ * are bracketed by a sequence counter, and readers retry until they get a
+ * consistent copy. After a few retries the reader sleeps for 1ms between
+ * attempts, so a process() call in a lower-priority thread can finish, and it
+ * gives up after AN_HIST_MAX_RETRIES attempts. Readers in a higher-priority
+ * thread therefore wait at most about that many ms, and fail if process() is
+ * busy for that long. Don't take snapshots from an interrupt handler, which
+ * can't sleep, or from one that may preempt process().
+ *
+ * quantiles() and clear() update the state with the same counter as
+ * process(), so they must be called from the thread that calls process():
+ * two writers at once can leave the counter even mid-update.
+ */
+class AdvancedHistogram {
+  private:
+    typedef struct {
+        float q[5];     // Marker heights.
+        float np[5];    // Desired marker positions.
+        int32_t n[5];   // Actual marker positions.
+        uint32_t count; // Samples seen, up to 5 during startup.
+    } p2_t;
+
+    size_t n_channels;
+    size_t n_bins;
+    uint32_t shift;
+    size_t n_quantiles;
+    float prob[AN_HIST_MAX_QUANTILES];
+    uint32_t *counts;
+    p2_t *p2;
+    volatile uint32_t seq;
+
+    void p2_update(p2_t *m, float p, float x);
+    bool begin_read(uint32_t *s, size_t attempt) const;
+    bool end_read(uint32_t s) const;
+
+  public:
+    /**
+     * @brief Constructor for AdvancedHistogram
+     * @param n_channels Number of interleaved channels
+     * @param resolution ADC resolution (AN_RESOLUTION_8..16)
+     * @param bin_bits Log2 of the number of bins, capped at the resolution (default: 6)
+     */
+    AdvancedHistogram(size_t n_channels, uint32_t resolution, uint32_t bin_bits = 6);
+
+    /**
+     * @brief Destructor for AdvancedHistogram
+     */
+    ~AdvancedHistogram();
+
+    /**
+     * @brief Select the quantiles to track
+     * @param p Probabilities, each between 0 and 1 (e.g. 0.5 for the median)
+     * @param n Number of quantiles, up to AN_HIST_MAX_QUANTILES (0 disables tracking)
+     * @return true on success, false on invalid arguments
+     *
+     * Restarts quantile tracking on all channels. Call it from the thread
+     * that calls process().
+     */
+    bool quantiles(const float *p, size_t n);
+
+    /**
+     * @brief Accumulate interleaved samples
+     * @param in Interleaved samples
+     * @param n_frames Number of frames (samples per channel)
+     */
+    void process(const Sample *in, size_t n_frames);
+
+    /**
+     * @brief Accumulate a sample buffer
+     * @param buf Sample buffer, must have channels() channels
+     * @return true on success, false on channel mismatch
+     */
+    bool process(SampleBuffer buf);
+
+    /**
+     * @brief Copy the histogram of a channel
+     * @param channel Channel index
+     * @param out Output array of bins() counts
+     * @return Total number of samples counted, 0 if the channel is invalid or no
+     * consistent copy could be taken
+     */
+    uint32_t snapshot(size_t channel, uint32_t *out) const;
+
+    /**
+     * @brief Get a quantile estimate
+     * @param channel Channel index
+     * @param index Index of the quantile, in the order passed to quantiles()
+     * @return Estimated quantile in codes, or NAN if not available yet or no
+     * consistent copy could be taken
+     */
+    float quantile(size_t channel, size_t index) const;
+
+    /**
+     * @brief Clear the histograms and quantile estimates
+     *
+     * Call it from the thread that calls process().
+     */
+    void clear();
+
+    /**
+     * @brief Get the number of bins per channel
+     */
+    size_t bins() const {
+        return n_bins;
+    }
+
+    /**
+     * @brief Get the number of codes per bin, as a shift
+     * @return Bin b covers codes (b << bin_shift()) to ((b + 1) << bin_shift()) - 1
+     */
+    uint32_t bin_shift() const {
+        return shift;
+    }
+
+    /**
+     * @brief Get the number of channels
+     */
+    size_t channels() const {
+        return n_channels;
+    }
+};
+
+#endif // __ADVANCED_HISTOGRAM_H__
@@ -0,0 +1,164 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedLockIn.h"
+
+static uint32_t lockin_gcd(uint32_t a, uint32_t b) {
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+AdvancedLockIn::AdvancedLockIn(size_t n_channels, uint32_t sample_rate, uint32_t ref_freq, size_t decimation,
+                               uint32_t smooth_shift) :
+    n_channels(n_channels), n_table(AN_LOCKIN_MAX_TABLE), n_dec(decimation), index(0), phase(0), step(0),
+    count(0), smooth(smooth_shift), seed(true), sin_t(nullptr), cos_t(nullptr) {
+    if (this->n_channels > AN_MAX_ADC_CHANNELS) {
+        this->n_channels = AN_MAX_ADC_CHANNELS;
+    }
+    if (n_dec == 0) {
+        n_dec = 1;
+    }
+    if (smooth > AN_LOCKIN_MAX_SMOOTH) {
+        smooth = AN_LOCKIN_MAX_SMOOTH;
+    }
+    if (sample_rate == 0 || ref_freq == 0) {
+        sample_rate = ref_freq = 1;
+    }
+
+    // rate / freq = len / cycles: the table holds `cycles` reference periods
+    // in `len` samples, and repeats exactly.
+    uint32_t g = lockin_gcd(sample_rate, ref_freq);
+    uint32_t len = sample_rate / g;
+    uint32_t cycles = ref_freq / g;
+    if (len <= AN_LOCKIN_MAX_TABLE) {
+        n_table = len;
+    } else {
+        n_table = AN_LOCKIN_MAX_TABLE;
+        cycles = 1;
+        step = (uint32_t)(((uint64_t)ref_freq << 32) / sample_rate);
+    }
+
+    sin_t = new int16_t[n_table];
+    cos_t = new int16_t[n_table];
+    for (size_t n = 0; n < n_table; n++) {
+        float w = 2.0f * PI * (float)((uint64_t)n * cycles % n_table) / (float)n_table;
+        sin_t[n] = (int16_t)lrintf(32767.0f * sinf(w));
+        cos_t[n] = (int16_t)lrintf(32767.0f * cosf(w));
+    }
+
+    reset();
+}
+
+AdvancedLockIn::~AdvancedLockIn() {
+    delete[] sin_t;
+    delete[] cos_t;
+}
+
+void AdvancedLockIn::reset() {
+    index = 0;
+    phase = 0;
+    count = 0;
+    seed = true;
+    acc_s = 0;
+    acc_c = 0;
+    for (size_t ch = 0; ch < AN_MAX_ADC_CHANNELS; ch++) {
+        acc_i[ch] = 0;
+        acc_q[ch] = 0;
+        acc_x[ch] = 0;
+        avg_i[ch] = 0.0f;
+        avg_q[ch] = 0.0f;
+    }
+}
+
+size_t AdvancedLockIn::process(const Sample *in, size_t n_frames, lockin_result_t *out, size_t max_outputs) {
+    size_t n_out = 0;
+    const uint32_t dds_shift = 32 - AN_LOCKIN_TABLE_BITS;
+
+    for (size_t n = 0; n < n_frames; n++) {
+        size_t k = step ? (phase >> dds_shift) : index;
+        int32_t s = sin_t[k];
+        int32_t c = cos_t[k];
+        const Sample *frame = &in[n * n_channels];
+
+        for (size_t ch = 0; ch < n_channels; ch++) {
+            // Offset to signed so the products fit 32 bits; the period's mean
+            // is removed when the integrators are dumped.
+            int32_t x = (int32_t)frame[ch] - 32768;
+            acc_i[ch] += (int64_t)(x * s);
+            acc_q[ch] += (int64_t)(x * c);
+            acc_x[ch] += x;
+        }
+        acc_s += s;
+        acc_c += c;
+
+        if (step) {
+            phase += step;
+        } else if (++index == n_table) {
+            index = 0;
+        }
+
+        if (++count < n_dec) {
+            continue;
+        }
+
+        // Dump the integrators. For x = A * sin(wn + p): I = A/2 * cos(p), Q = A/2 * sin(p).
+        const float scale = 2.0f / (32767.0f * (float)n_dec);
+        const float alpha = 1.0f / (float)(1UL << smooth);
+        for (size_t ch = 0; ch < n_channels; ch++) {
+            // sum((x - mean) * ref) = sum(x * ref) - sum(x) * sum(ref) / n.
+            double mean = (double)acc_x[ch] / (double)n_dec;
+            float i_v = (float)((double)acc_i[ch] - mean * (double)acc_s) * scale;
+            float q_v = (float)((double)acc_q[ch] - mean * (double)acc_c) * scale;
+            acc_i[ch] = 0;
+            acc_q[ch] = 0;
+            acc_x[ch] = 0;
+            if (seed) {
+                avg_i[ch] = i_v;
+                avg_q[ch] = q_v;
+            } else {
+                avg_i[ch] += (i_v - avg_i[ch]) * alpha;
+                avg_q[ch] += (q_v - avg_q[ch]) * alpha;
+            }
+            if (n_out < max_outputs) {
+                lockin_result_t *r = &out[n_out * n_channels + ch];
+                r->amplitude = sqrtf(avg_i[ch] * avg_i[ch] + avg_q[ch] * avg_q[ch]);
+                r->phase = atan2f(avg_q[ch], avg_i[ch]);
+            }
+        }
+        seed = false;
+        count = 0;
+        acc_s = 0;
+        acc_c = 0;
+        if (n_out < max_outputs) {
+            n_out++;
+        }
+    }
+    return n_out;
+}
+
+size_t AdvancedLockIn::process(SampleBuffer buf, lockin_result_t *out, size_t max_outputs) {
+    if (!buf || buf.channels() != n_channels) {
+        return 0;
+    }
+    return process(buf.data(), buf.size() / n_channels, out, max_outputs);
+}
@@ -0,0 +1,140 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_LOCKIN_H__
+#define __ADVANCED_LOCKIN_H__
+
+#include "AdvancedAnalog.h"
+
+#define AN_LOCKIN_TABLE_BITS    (10)    // Log2 of the max reference table length.
+#define AN_LOCKIN_MAX_TABLE     (1 << AN_LOCKIN_TABLE_BITS)     // Max reference table length, in samples.
+#define AN_LOCKIN_MAX_SMOOTH    (16)    // Max output averaging, log2 of outputs.
+
+/**
+ * @brief Demodulated output of one channel
+ */
+typedef struct {
+    float amplitude;    ///< Amplitude at the reference frequency, in codes (peak).
+    float phase;        ///< Phase relative to the sine reference, in radians.
+} lockin_result_t;
+
+/**
+ * @brief Software lock-in demodulation stage
+ *
+ * Multiplies every channel by sine and cosine references, integrates the
+ * products over `decimation` samples and outputs amplitude and phase once
+ * per decimation period. The reference advances by sample count, not time,
+ * so it is locked to the ADC trigger timer: if the excitation is derived
+ * from the same clock, there's no drift between the two.
+ *
+ * When sample_rate / ref_freq reduces to a fraction whose numerator is at most
+ * AN_LOCKIN_MAX_TABLE (e.g. 2000Hz / 125Hz = 16 samples per period, or
+ * 2000Hz / 300Hz = 3 periods in 20 samples), the references are a table that
+ * repeats exactly. Otherwise a 32-bit phase accumulator indexes a table of
+ * AN_LOCKIN_MAX_TABLE entries. The mean of each decimation period is removed
+ * from the products, so DC is rejected whatever the resolution or input level.
+ * Choosing a decimation that's a multiple of the exact repetition length also
+ * rejects the 2f product terms completely; an optional exponential average on
+ * the decimated outputs narrows the bandwidth further.
+ *
+ * References are Q15 and products are accumulated in 64 bits (SMLAL), two
+ * multiply-accumulates per sample and channel. Note that channels of a
+ * multi-channel sequence are converted one after the other, so each has a
+ * small constant phase offset of its position times the conversion time.
+ */
+class AdvancedLockIn {
+  private:
+    size_t n_channels;
+    size_t n_table;
+    size_t n_dec;
+    size_t index;       // Position in the table, exact mode.
+    uint32_t phase;     // Phase accumulator, DDS mode.
+    uint32_t step;      // Phase increment, DDS mode (0 in exact mode).
+    size_t count;       // Samples integrated so far.
+    uint32_t smooth;    // Output averaging, log2 of outputs (0 = off).
+    bool seed;
+    int16_t *sin_t;
+    int16_t *cos_t;
+    int64_t acc_i[AN_MAX_ADC_CHANNELS];
+    int64_t acc_q[AN_MAX_ADC_CHANNELS];
+    int64_t acc_x[AN_MAX_ADC_CHANNELS];    // Sum of the samples, for the mean.
+    int64_t acc_s;      // Sums of the references over the period.
+    int64_t acc_c;
+    float avg_i[AN_MAX_ADC_CHANNELS];
+    float avg_q[AN_MAX_ADC_CHANNELS];
+
+  public:
+    /**
+     * @brief Constructor for AdvancedLockIn
+     * @param n_channels Number of interleaved channels
+     * @param sample_rate ADC sample rate in Hz
+     * @param ref_freq Reference (excitation) frequency in Hz
+     * @param decimation Samples integrated per output, ideally a multiple of the period
+     * @param smooth_shift Exponential average of the outputs, log2 of outputs, up to AN_LOCKIN_MAX_SMOOTH (default: 0, off)
+     */
+    AdvancedLockIn(size_t n_channels, uint32_t sample_rate, uint32_t ref_freq, size_t decimation,
+                   uint32_t smooth_shift = 0);
+
+    /**
+     * @brief Destructor for AdvancedLockIn
+     */
+    ~AdvancedLockIn();
+
+    /**
+     * @brief Demodulate interleaved samples
+     * @param in Interleaved samples
+     * @param n_frames Number of frames (samples per channel)
+     * @param out Output array, channels() results per output
+     * @param max_outputs Capacity of out, in outputs
+     * @return Number of outputs written
+     */
+    size_t process(const Sample *in, size_t n_frames, lockin_result_t *out, size_t max_outputs);
+
+    /**
+     * @brief Demodulate a sample buffer
+     * @param buf Sample buffer, must have channels() channels
+     * @param out Output array, channels() results per output
+     * @param max_outputs Capacity of out, in outputs
+     * @return Number of outputs written, 0 on channel mismatch
+     */
+    size_t process(SampleBuffer buf, lockin_result_t *out, size_t max_outputs);
+
+    /**
+     * @brief Restart the reference at phase 0 and clear the integrators
+     */
+    void reset();
+
+    /**
+     * @brief Get the exact repetition length of the reference
+     * @return Samples after which the reference repeats exactly (a whole number
+     * of reference periods), or 0 if the phase accumulator is used
+     */
+    size_t period() const {
+        return step ? 0 : n_table;
+    }
+
+    /**
+     * @brief Get the number of channels
+     */
+    size_t channels() const {
+        return n_channels;
+    }
+};
+
+#endif // __ADVANCED_LOCKIN_H__
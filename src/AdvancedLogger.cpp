@@ -0,0 +1,314 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedLogger.h"
+#include "AdvancedPack.h"
+#include "AdvancedCodec.h"
+#include "mbed.h"
+
+typedef char capture_header_size_check[(sizeof(capture_header_t) <= AN_CAPTURE_HEADER_SIZE) ? 1 : -1];
+typedef char capture_chunk_size_check[(sizeof(capture_chunk_t) == AN_CAPTURE_CHUNK_SIZE) ? 1 : -1];
+typedef char capture_cal_size_check[(AN_CAL_MAX_POINTS == AN_CAPTURE_CAL_POINTS) ? 1 : -1];
+
+#define LOGGER_PACK_CHUNK   (128)   // Samples packed per step, a multiple of 4.
+#define WRITE_FLAG          (1U << 0)
+
+static uint32_t sample_time_halves(adc_sample_time_t t) {
+    switch (t) {
+        case AN_ADC_SAMPLETIME_1_5: return 3;
+        case AN_ADC_SAMPLETIME_2_5: return 5;
+        case AN_ADC_SAMPLETIME_8_5: return 17;
+        case AN_ADC_SAMPLETIME_16_5: return 33;
+        case AN_ADC_SAMPLETIME_32_5: return 65;
+        case AN_ADC_SAMPLETIME_64_5: return 129;
+        case AN_ADC_SAMPLETIME_387_5: return 775;
+        case AN_ADC_SAMPLETIME_810_5: return 1621;
+    }
+    return 0;
+}
+
+AdvancedLogger::AdvancedLogger(size_t block_bytes, size_t n_blocks) :
+    file(nullptr), mem(nullptr), queue(nullptr), block_size(AN_CAPTURE_HEADER_SIZE), q_size(0),
+    q_head(0), q_tail(0), running(false), failed(false), thread(nullptr), events(nullptr), header(nullptr),
+    index(nullptr), n_index(0), offset(0), scratch(nullptr), scratch_size(0), period(0.0f), seq(0), n_logged(0), n_dropped(0), drop_run(0), max_fill(0) {
+    // Powers of two, so blocks never wrap and the free-running indices wrap cleanly.
+    while (block_size < block_bytes) {
+        block_size <<= 1;
+    }
+    q_size = block_size * 2;
+    while (q_size < block_size * n_blocks) {
+        q_size <<= 1;
+    }
+}
+
+AdvancedLogger::~AdvancedLogger() {
+    end();
+}
+
+bool AdvancedLogger::begin(const char *path, AdvancedADC &adc, uint32_t resolution, uint32_t sample_rate,
+                           uint32_t encoding, const AdvancedCalibration *cal, int priority,
+                           size_t stack_size) {
+    size_t n_channels = adc.channels();
+    if (file || sample_rate == 0 || resolution > AN_RESOLUTION_16 || encoding > AN_FRAME_RICE
+            || n_channels == 0 || n_channels > AN_MAX_ADC_CHANNELS) {
+        return false;
+    }
+
+    // Align the queue to a cache line, for storage drivers that use DMA.
+    mem = new uint8_t[q_size + 31];
+    header = new capture_header_t;
+    index = new capture_index_t[AN_CAPTURE_INDEX_SIZE];
+    events = new rtos::EventFlags();
+    if (mem == nullptr || header == nullptr || index == nullptr || events == nullptr) {
+        end();
+        return false;
+    }
+    queue = (uint8_t *)(((uintptr_t)mem + 31) & ~(uintptr_t)31);
+
+    memset(header, 0, sizeof(*header));
+    header->magic = AN_CAPTURE_MAGIC;
+    header->version = AN_CAPTURE_VERSION;
+    header->header_bytes = AN_CAPTURE_HEADER_SIZE;
+    header->adc_id = (adc.id() > 0) ? adc.id() : 0;
+    header->channels = n_channels;
+    header->resolution = resolution;
+    header->encoding = encoding;
+    header->sample_rate = (adc.rate() > 0.0f) ? adc.rate() : sample_rate;
+    header->sample_time = sample_time_halves(adc.sampleTime());
+    header->index_stride = 1;
+    for (size_t i = 0; i < n_channels; i++) {
+        capture_cal_t &c = header->cal[i];
+        header->pins[i] = adc.pin(i);
+        if (cal == nullptr) {
+            c.gain = 1.0f;
+            continue;
+        }
+        const AdvancedCalibration::channel_t &src = cal->channel(i);
+        c.n_points = src.n_points;
+        c.gain = src.gain;
+        c.offset = src.offset;
+        for (size_t k = 0; k < src.n_points; k++) {
+            c.codes[k] = src.codes[k];
+            c.values[k] = src.values[k];
+        }
+    }
+
+    file = fopen(path, "wb");
+    if (file == nullptr) {
+        end();
+        return false;
+    }
+
+    // The header is padded to a whole number of sectors; the queue is free
+    // to use as the staging area.
+    memset(queue, 0, AN_CAPTURE_HEADER_SIZE);
+    memcpy(queue, header, sizeof(*header));
+    if (fwrite(queue, 1, AN_CAPTURE_HEADER_SIZE, file) != AN_CAPTURE_HEADER_SIZE) {
+        end();
+        return false;
+    }
+
+    period = 1e6f / header->sample_rate;
+    q_head = q_tail = 0;
+    offset = AN_CAPTURE_HEADER_SIZE;
+    n_index = 0;
+    seq = n_logged = n_dropped = drop_run = 0;
+    max_fill = 0;
+    failed = false;
+    running = true;
+
+    thread = new rtos::Thread((osPriority)priority, stack_size, nullptr, "an_logger");
+    if (thread == nullptr || thread->start(mbed::callback(this, &AdvancedLogger::write_loop)) != osOK) {
+        running = false;
+        delete thread;
+        thread = nullptr;
+        end();
+        return false;
+    }
+    return true;
+}
+
+void AdvancedLogger::push(const void *data, size_t len) {
+    // Caller checked there's room; copy in up to two pieces around the wrap.
+    const uint8_t *src = (const uint8_t *)data;
+    size_t off = q_head & (q_size - 1);
+    size_t first = (len < q_size - off) ? len : q_size - off;
+    memcpy(&queue[off], src, first);
+    memcpy(&queue[0], src + first, len - first);
+    __DMB();
+    q_head += len;
+}
+
+bool AdvancedLogger::write(SampleBuffer buf) {
+    if (!running || failed || !buf || buf.channels() != header->channels) {
+        return false;
+    }
+
+    capture_chunk_t chunk;
+    size_t n_frames = buf.size() / buf.channels();
+    chunk.magic = AN_CAPTURE_CHUNK_MAGIC;
+    chunk.sequence = seq++;
+    // The buffer timestamp is taken when its last frame completes.
+    chunk.timestamp = buf.timestamp() - (uint32_t)((n_frames - 1) * period + 0.5f);
+    chunk.n_samples = buf.size();
+    chunk.flags = (buf.get_flags(DMA_BUFFER_DISCONT) || drop_run) ? AN_FRAME_DISCONT : 0;
+    chunk.dropped = (drop_run < 0xFFFF) ? drop_run : 0xFFFF;
+
+    if (header->encoding == AN_FRAME_RICE) {
+        // Compressed chunks vary in size, so encode them up front.
+        size_t max_bytes = an_codec_max_bytes(header->channels, n_frames);
+        if (scratch_size < max_bytes) {
+            delete[] scratch;
+            scratch = new uint8_t[max_bytes];
+            scratch_size = (scratch != nullptr) ? max_bytes : 0;
+            if (scratch == nullptr) {
+                return false;
+            }
+        }
+        chunk.payload_bytes = an_encode(buf.data(), header->channels, n_frames, scratch);
+    } else if (header->encoding == AN_FRAME_PACKED) {
+        chunk.payload_bytes = an_packed_bytes(header->resolution, buf.size());
+    } else {
+        chunk.payload_bytes = buf.bytes();
+    }
+
+    size_t padding = (4 - (chunk.payload_bytes & 3)) & 3;
+    size_t total = AN_CAPTURE_CHUNK_SIZE + chunk.payload_bytes + padding;
+    if (q_size - (q_head - q_tail) < total) {
+        // Storage is behind; drop the buffer and note it in the next chunk.
+        n_dropped++;
+        drop_run++;
+        return false;
+    }
+
+    push(&chunk, sizeof(chunk));
+    if (header->encoding == AN_FRAME_RICE) {
+        push(scratch, chunk.payload_bytes);
+    } else if (header->encoding == AN_FRAME_PACKED) {
+        uint8_t packed[LOGGER_PACK_CHUNK * 2];
+        for (size_t i = 0; i < buf.size(); i += LOGGER_PACK_CHUNK) {
+            size_t n = buf.size() - i;
+            n = (n < LOGGER_PACK_CHUNK) ? n : LOGGER_PACK_CHUNK;
+            push(packed, an_pack(header->resolution, buf.data() + i, n, packed));
+        }
+    } else {
+        push(buf.data(), chunk.payload_bytes);
+    }
+    uint32_t zero = 0;
+    push(&zero, padding);
+
+    // Index every index_stride-th chunk; when the index is full, keep every
+    // other entry and double the stride.
+    if (n_index == AN_CAPTURE_INDEX_SIZE) {
+        for (size_t i = 0; i < AN_CAPTURE_INDEX_SIZE / 2; i++) {
+            index[i] = index[2 * i];
+        }
+        n_index = AN_CAPTURE_INDEX_SIZE / 2;
+        header->index_stride *= 2;
+    }
+    if (header->chunks % header->index_stride == 0) {
+        index[n_index].sequence = chunk.sequence;
+        index[n_index].timestamp = chunk.timestamp;
+        index[n_index].offset = offset;
+        n_index++;
+    }
+    offset += total;
+
+    drop_run = 0;
+    n_logged++;
+    header->chunks++;
+    size_t fill = q_head - q_tail;
+    max_fill = (fill > max_fill) ? fill : max_fill;
+    if (fill >= block_size) {
+        events->set(WRITE_FLAG);
+    }
+    return true;
+}
+
+void AdvancedLogger::write_loop() {
+    uint64_t written = 0;
+    for (;;) {
+        bool stopping = !running;
+        __DMB();
+        size_t avail = q_head - q_tail;
+        if (avail < block_size && !stopping) {
+            // Only whole blocks go out while logging, so every write is sector
+            // aligned; sleep until write() fills the next one.
+            events->wait_any(WRITE_FLAG);
+            continue;
+        }
+        if (avail == 0) {
+            break;
+        }
+        // q_tail stays block aligned until the final partial block, so this never wraps.
+        size_t len = (avail < block_size) ? avail : block_size;
+        if (fwrite(&queue[q_tail & (q_size - 1)], 1, len, file) != len) {
+            failed = true;
+            break;
+        }
+        written += len;
+        __DMB();
+        q_tail += len;
+    }
+    header->data_bytes = written;
+}
+
+bool AdvancedLogger::end() {
+    bool ok = false;
+    if (thread) {
+        running = false;
+        events->set(WRITE_FLAG);
+        thread->join();
+        delete thread;
+        thread = nullptr;
+
+        // Append the index and fill in the totals; a failed capture has to be
+        // read by walking the chunks.
+        header->dropped = n_dropped;
+        static const uint8_t zero[8] = {0};
+        size_t padding = (8 - (header->data_bytes & 7)) & 7;    // Chunks are only 4-byte aligned.
+        if (!failed && fwrite(zero, 1, padding, file) == padding
+                && fwrite(index, sizeof(capture_index_t), n_index, file) == n_index) {
+            header->index_offset = AN_CAPTURE_HEADER_SIZE + header->data_bytes + padding;
+            header->index_entries = n_index;
+        } else {
+            failed = true;
+            header->chunks = 0;
+        }
+        ok = !failed && fflush(file) == 0 && fseek(file, 0, SEEK_SET) == 0
+             && fwrite(header, sizeof(*header), 1, file) == 1;
+    }
+    if (file) {
+        ok = (fclose(file) == 0) && ok;
+        file = nullptr;
+    }
+    delete[] mem;
+    mem = nullptr;
+    queue = nullptr;
+    delete header;
+    header = nullptr;
+    delete[] index;
+    index = nullptr;
+    delete events;
+    events = nullptr;
+    delete[] scratch;
+    scratch = nullptr;
+    scratch_size = 0;
+    return ok;
+}
@@ -0,0 +1,149 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_LOGGER_H__
+#define __ADVANCED_LOGGER_H__
+
+#include <stdio.h>
+#include "AdvancedADC.h"
+#include "AdvancedConverter.h"
+#include "AdvancedCapture.h"
+
+namespace rtos {
+class Thread;
+class EventFlags;
+}
+
+/**
+ * @brief Binary capture logger for SD cards and USB mass storage
+ *
+ * Logs sample buffers to a capture file (see AdvancedCapture.h) on any
+ * mounted file system. write() only appends the buffer to a queue of large
+ * blocks and returns; a lower-priority thread writes whole blocks, which are
+ * sector aligned in the file, so slow or bursty storage never stalls
+ * acquisition. If the queue fills up anyway, buffers are dropped and the
+ * count is recorded both in the next chunk and in the file header. When the
+ * file is closed, an index is appended for random access.
+ *
+ * Size the queue for the data rate times the worst write latency of the
+ * storage; SD cards can stall for a few hundred milliseconds.
+ */
+class AdvancedLogger {
+  private:
+    FILE *file;
+    uint8_t *mem;
+    uint8_t *queue;
+    size_t block_size;
+    size_t q_size;
+    volatile size_t q_head;
+    volatile size_t q_tail;
+    volatile bool running;
+    volatile bool failed;
+    rtos::Thread *thread;
+    rtos::EventFlags *events;
+    capture_header_t *header;
+    capture_index_t *index;
+    uint32_t n_index;
+    uint64_t offset;
+    uint8_t *scratch;
+    size_t scratch_size;
+    float period;
+    uint32_t seq;
+    uint32_t n_logged;
+    uint32_t n_dropped;
+    uint32_t drop_run;
+    size_t max_fill;
+
+    void push(const void *data, size_t len);
+    void write_loop();
+
+  public:
+    /**
+     * @brief Constructor for AdvancedLogger
+     * @param block_bytes Size of each storage write, rounded up to a power of two >= 512 (default: 16384)
+     * @param n_blocks Number of blocks in the queue, rounded up to a power of two (default: 8)
+     */
+    AdvancedLogger(size_t block_bytes = 16384, size_t n_blocks = 8);
+
+    /**
+     * @brief Destructor for AdvancedLogger
+     *
+     * Closes the capture file if still open.
+     */
+    ~AdvancedLogger();
+
+    /**
+     * @brief Create a capture file and start the writer thread
+     * @param path File path on a mounted file system, e.g. "/usb/capture.bin"
+     * @param adc ADC the buffers come from, for the channel map, ADC id, rate and sampling time
+     * @param resolution ADC resolution
+     * @param sample_rate Sample rate in Hz, only used if the ADC isn't running yet
+     * @param encoding Chunk encoding, AN_FRAME_RAW, AN_FRAME_PACKED or AN_FRAME_RICE (default: AN_FRAME_RAW)
+     * @param cal Calibration to record in the file, or nullptr (default: nullptr)
+     * @param priority Writer thread priority, as osPriority (default: osPriorityBelowNormal)
+     * @param stack_size Writer thread stack size in bytes, enough for the file system and storage driver (default: 4096)
+     * @return true on success, false on error
+     */
+    bool begin(const char *path, AdvancedADC &adc, uint32_t resolution, uint32_t sample_rate,
+               uint32_t encoding = AN_FRAME_RAW, const AdvancedCalibration *cal = nullptr, int priority = 16,
+               size_t stack_size = 4096);
+
+    /**
+     * @brief Queue a sample buffer for logging
+     * @param buf Sample buffer, can be released as soon as this returns
+     * @return true if queued, false if the buffer was dropped
+     */
+    bool write(SampleBuffer buf);
+
+    /**
+     * @brief Flush the queue, write the index, update the file header and close the file
+     * @return true if every queued byte was written, false on a storage error
+     */
+    bool end();
+
+    /**
+     * @brief Get the number of buffers logged
+     */
+    uint32_t logged() const {
+        return n_logged;
+    }
+
+    /**
+     * @brief Get the number of buffers dropped because the queue was full
+     */
+    uint32_t dropped() const {
+        return n_dropped;
+    }
+
+    /**
+     * @brief Get the highest number of queued bytes seen, to check the headroom
+     */
+    size_t max_pending() const {
+        return max_fill;
+    }
+
+    /**
+     * @brief Check if writing to storage has failed
+     */
+    bool error() const {
+        return failed;
+    }
+};
+
+#endif // __ADVANCED_LOGGER_H__
@@ -0,0 +1,203 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedMerger.h"
+
+static inline size_t merge_frames(DMABuffer<Sample> *b) {
+    return b->size() / b->channels();
+}
+
+AdvancedMerger::AdvancedMerger(uint32_t sample_rate) :
+    n_sources(0), period(1e6f / (sample_rate ? sample_rate : 1)), discont(false), last_error(0), peak_error(0), n_dropped(0) {
+    for (size_t i = 0; i < AN_MERGE_MAX_SOURCES; i++) {
+        adc[i] = nullptr;
+        buf[i] = nullptr;
+        pos[i] = 0;
+    }
+}
+
+AdvancedMerger::~AdvancedMerger() {
+    release();
+}
+
+bool AdvancedMerger::source(AdvancedADC &source) {
+    if (n_sources >= AN_MERGE_MAX_SOURCES) {
+        return false;
+    }
+    adc[n_sources++] = &source;
+    return true;
+}
+
+size_t AdvancedMerger::channels() {
+    size_t n = 0;
+    for (size_t i = 0; i < n_sources; i++) {
+        n += adc[i]->channels();
+    }
+    return n;
+}
+
+void AdvancedMerger::release() {
+    for (size_t i = 0; i < AN_MERGE_MAX_SOURCES; i++) {
+        if (buf[i]) {
+            buf[i]->release();
+            buf[i] = nullptr;
+        }
+        pos[i] = 0;
+    }
+}
+
+bool AdvancedMerger::fetch(size_t i) {
+    if (buf[i] && pos[i] < merge_frames(buf[i])) {
+        return true;
+    }
+
+    // Return the exhausted buffer before taking the next one.
+    if (buf[i]) {
+        buf[i]->release();
+        buf[i] = nullptr;
+    }
+
+    if (!adc[i]->available()) {
+        return false;
+    }
+
+    DMABuffer<Sample> *b = &adc[i]->read();
+    if (!*b || b->channels() == 0) {
+        return false;
+    }
+
+    if (b->get_flags(DMA_BUFFER_DISCONT)) {
+        discont = true;
+    }
+    buf[i] = b;
+    pos[i] = 0;
+    return true;
+}
+
+float AdvancedMerger::time(size_t i) {
+    // The timestamp is taken when the last frame of the buffer completes.
+    // Times are relative to source 0's buffer to stay clear of wrap-around.
+    int32_t rel = (int32_t)(buf[i]->timestamp() - buf[0]->timestamp());
+    return (float)rel - (float)(merge_frames(buf[i]) - 1 - pos[i]) * period;
+}
+
+bool AdvancedMerger::align() {
+    for (;;) {
+        for (size_t i = 0; i < n_sources; i++) {
+            if (!fetch(i)) {
+                return false;
+            }
+        }
+
+        float t_max = time(0);
+        for (size_t i = 1; i < n_sources; i++) {
+            float t = time(i);
+            t_max = (t > t_max) ? t : t_max;
+        }
+
+        // Skip the samples of any source lagging by a full period or more.
+        // Timestamps jitter with interrupt latency, which at high rates is
+        // more than half a period, so a lower threshold would keep dropping
+        // single samples from alternate sources.
+        bool refetch = false;
+        for (size_t i = 0; i < n_sources; i++) {
+            float lag = t_max - time(i);
+            if (lag >= period) {
+                size_t skip = (size_t)(lag / period + 0.5f);
+                size_t remain = merge_frames(buf[i]) - pos[i];
+                if (skip >= remain) {
+                    skip = remain;
+                    refetch = true;
+                }
+                pos[i] += skip;
+                n_dropped += skip;
+                discont = true;
+            }
+        }
+
+        if (!refetch) {
+            return true;
+        }
+    }
+}
+
+size_t AdvancedMerger::read(merge_view_t &view, size_t max_frames) {
+    view.n_frames = 0;
+    if (n_sources == 0 || !align()) {
+        return 0;
+    }
+
+    size_t n = max_frames;
+    float t_min = time(0), t_max = t_min;
+    for (size_t i = 0; i < n_sources; i++) {
+        size_t remain = merge_frames(buf[i]) - pos[i];
+        n = (remain < n) ? remain : n;
+
+        float t = time(i);
+        t_min = (t < t_min) ? t : t_min;
+        t_max = (t > t_max) ? t : t_max;
+    }
+
+    for (size_t i = 0; i < AN_MERGE_MAX_SOURCES; i++) {
+        if (i < n_sources) {
+            view.src[i] = buf[i]->data() + pos[i] * buf[i]->channels();
+            view.channels[i] = buf[i]->channels();
+        } else {
+            view.src[i] = nullptr;
+            view.channels[i] = 0;
+        }
+    }
+
+    view.n_frames = n;
+    view.timestamp = buf[0]->timestamp() + (int32_t)(time(0) - 0.5f);
+    view.error = (uint32_t)(t_max - t_min + 0.5f);
+    view.discont = discont;
+
+    last_error = view.error;
+    peak_error = (view.error > peak_error) ? view.error : peak_error;
+    discont = false;
+
+    // Consume the frames now, buffers are only released on the next call.
+    for (size_t i = 0; i < n_sources; i++) {
+        pos[i] += n;
+    }
+    return n;
+}
+
+size_t AdvancedMerger::read(Sample *out, size_t n_frames) {
+    size_t done = 0;
+    merge_view_t view;
+
+    while (done < n_frames) {
+        size_t n = read(view, n_frames - done);
+        if (n == 0) {
+            break;
+        }
+        for (size_t f = 0; f < n; f++) {
+            for (size_t i = 0; i < n_sources; i++) {
+                const Sample *src = view.src[i] + f * view.channels[i];
+                for (size_t ch = 0; ch < view.channels[i]; ch++) {
+                    *out++ = src[ch];
+                }
+            }
+        }
+        done += n;
+    }
+    return done;
+}
@@ -0,0 +1,150 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_MERGER_H__
+#define __ADVANCED_MERGER_H__
+
+#include "AdvancedADC.h"
+
+#define AN_MERGE_MAX_SOURCES    (3)     // One source per ADC instance.
+
+/**
+ * @brief Time-aligned view over several sources
+ *
+ * Points directly into each source's sample buffer; valid until the next
+ * call to AdvancedMerger::read() or AdvancedMerger::release().
+ */
+typedef struct {
+    const Sample *src[AN_MERGE_MAX_SOURCES];    ///< First frame of each source (interleaved).
+    size_t channels[AN_MERGE_MAX_SOURCES];      ///< Channels (frame stride) of each source.
+    size_t n_frames;                            ///< Number of aligned frames in the view.
+    uint32_t timestamp;                         ///< Time of the first frame of source 0, in us.
+    uint32_t error;                             ///< Spread of the sources' first frame times, in us.
+    bool discont;                               ///< Data was skipped or lost before this view.
+} merge_view_t;
+
+/**
+ * @brief Time-aligned frame merger across independent ADC instances
+ *
+ * Consumes buffers from several AdvancedADC instances running at the same
+ * sample rate, and hands out frames aligned by sample time rather than by
+ * buffer count. The time of each sample is derived from its buffer timestamp
+ * (taken when the buffer completes) and the sample period, so sources with
+ * different buffer sizes or phases line up. When a source runs ahead (for
+ * example after being started later, or after a DISCONT buffer) the samples
+ * of the lagging sources are skipped until all sources are within one sample
+ * period; lags below a period are left alone, as they're within the jitter of
+ * the buffer timestamps at high rates.
+ *
+ * read(view) is zero-copy: the view points into the sources' own buffers, and
+ * covers the longest run of frames available in all of them. read(out, n)
+ * copies a fixed number of merged frames, crossing buffer boundaries as needed.
+ */
+class AdvancedMerger {
+  private:
+    AdvancedADC *adc[AN_MERGE_MAX_SOURCES];
+    DMABuffer<Sample> *buf[AN_MERGE_MAX_SOURCES];
+    size_t pos[AN_MERGE_MAX_SOURCES];
+    size_t n_sources;
+    float period;
+    bool discont;
+    uint32_t last_error;
+    uint32_t peak_error;
+    uint32_t n_dropped;
+
+    bool fetch(size_t i);
+    float time(size_t i);
+    bool align();
+
+  public:
+    /**
+     * @brief Constructor for AdvancedMerger
+     * @param sample_rate Sample rate of all sources in Hz, 0 is taken as 1
+     */
+    AdvancedMerger(uint32_t sample_rate);
+
+    /**
+     * @brief Destructor for AdvancedMerger
+     *
+     * Releases any buffers still held.
+     */
+    ~AdvancedMerger();
+
+    /**
+     * @brief Add a source
+     * @param source An AdvancedADC instance, configured and started by the caller
+     * @return true on success, false if all sources are in use
+     */
+    bool source(AdvancedADC &source);
+
+    /**
+     * @brief Get the next run of aligned frames without copying
+     * @param view View to fill
+     * @param max_frames Maximum number of frames in the view (default: no limit)
+     * @return Number of frames in the view, 0 if some source has no data yet
+     *
+     * Buffers exhausted by the previous view are released on entry.
+     */
+    size_t read(merge_view_t &view, size_t max_frames = (size_t)-1);
+
+    /**
+     * @brief Copy aligned frames into an interleaved array
+     * @param out Output array of n_frames frames, each frame holds the channels
+     * of all sources in the order they were added
+     * @param n_frames Number of frames requested
+     * @return Number of frames copied, fewer if the sources ran out of data
+     */
+    size_t read(Sample *out, size_t n_frames);
+
+    /**
+     * @brief Release all held buffers back to their pools
+     *
+     * The next read re-aligns the sources from scratch.
+     */
+    void release();
+
+    /**
+     * @brief Get the total number of channels of a merged frame
+     * @return Sum of all sources' channels
+     */
+    size_t channels();
+
+    /**
+     * @brief Get the alignment error of the last view, in microseconds
+     */
+    uint32_t error() const {
+        return last_error;
+    }
+
+    /**
+     * @brief Get the largest alignment error seen, in microseconds
+     */
+    uint32_t max_error() const {
+        return peak_error;
+    }
+
+    /**
+     * @brief Get the number of samples skipped to keep the sources aligned
+     */
+    uint32_t dropped() const {
+        return n_dropped;
+    }
+};
+
+#endif // __ADVANCED_MERGER_H__
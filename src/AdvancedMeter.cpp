@@ -0,0 +1,137 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedMeter.h"
+
+AdvancedMeter::AdvancedMeter(size_t n_channels, meter_dc_t dc_removal, uint32_t track_shift) :
+    n_channels(n_channels), dc_mode(dc_removal), dc_shift(track_shift), dc_seed(true) {
+    if (this->n_channels > AN_MAX_ADC_CHANNELS) {
+        this->n_channels = AN_MAX_ADC_CHANNELS;
+    }
+    if (dc_shift > 15) {
+        dc_shift = 15;
+    }
+    for (size_t ch = 0; ch < AN_MAX_ADC_CHANNELS; ch++) {
+        dc[ch] = 0;
+    }
+}
+
+bool AdvancedMeter::process(const Sample *in, size_t n_frames, meter_record_t &rec) {
+    if (n_frames == 0 || n_frames > 0xFFFF) {
+        return false;
+    }
+
+    rec.timestamp = 0;
+    rec.flags = 0;
+    rec.n_frames = n_frames;
+    rec.n_channels = n_channels;
+
+    for (size_t ch = 0; ch < n_channels; ch++) {
+        const Sample *src = in + ch;
+        uint32_t sum = 0;
+        uint64_t sum_sq = 0;
+        uint32_t lo = 0xFFFF, hi = 0;
+        size_t i = 0;
+
+#if defined(__ARM_FEATURE_DSP)
+        if (n_channels == 1) {
+            // Contiguous samples, square two per instruction. SMLALD is signed,
+            // so samples are offset to signed 16 bits and the offset is added
+            // back below: sum(x^2) = sum(y^2) + 2^16 * sum(y) + n * 2^30.
+            int64_t sum_sq_s = 0;
+            int32_t sum_s = 0;
+            for (; i + 2 <= n_frames; i += 2) {
+                uint32_t x2;
+                memcpy(&x2, &src[i], sizeof(x2));
+                uint32_t y2 = x2 ^ 0x80008000UL;
+                sum_sq_s = __SMLALD(y2, y2, sum_sq_s);
+                sum_s += (int16_t)(y2 & 0xFFFF) + (int16_t)(y2 >> 16);
+                uint32_t a = x2 & 0xFFFF, b = x2 >> 16;
+                lo = (a < lo) ? a : lo;
+                lo = (b < lo) ? b : lo;
+                hi = (a > hi) ? a : hi;
+                hi = (b > hi) ? b : hi;
+            }
+            sum = (uint32_t)(sum_s + (int32_t)(i * 32768));
+            sum_sq = (uint64_t)(sum_sq_s + ((int64_t)sum_s << 16) + ((int64_t)i << 30));
+        }
+#endif
+        for (; i < n_frames; i++) {
+            uint32_t x = src[i * n_channels];
+            sum += x;
+            sum_sq += x * x;
+            lo = (x < lo) ? x : lo;
+            hi = (x > hi) ? x : hi;
+        }
+
+        // Reference level: 0, this block's mean, or the running mean.
+        uint32_t mean = (sum + n_frames / 2) / n_frames;
+        int32_t ref = 0;
+        if (dc_mode == AN_METER_DC_BLOCK) {
+            ref = mean;
+        } else if (dc_mode == AN_METER_DC_TRACK) {
+            if (dc_seed) {
+                dc[ch] = (int64_t)mean << 16;
+            } else {
+                dc[ch] += (((int64_t)mean << 16) - dc[ch]) >> dc_shift;
+            }
+            ref = (int32_t)((dc[ch] + 0x8000) >> 16);
+        }
+
+        // Sum of squares around ref, exact in 64 bits so a small AC signal
+        // riding on a large DC level doesn't cancel out.
+        int64_t ss = (int64_t)sum_sq - 2 * (int64_t)ref * sum + (int64_t)n_frames * ref * ref;
+        float rms = (ss > 0) ? sqrtf((float)ss / n_frames) : 0.0f;
+
+        int32_t pk_hi = (int32_t)hi - ref;
+        int32_t pk_lo = ref - (int32_t)lo;
+        int32_t peak = (pk_hi > pk_lo) ? pk_hi : pk_lo;
+        peak = (peak < 0) ? 0 : peak;
+
+        float crest = (rms > 0.0f) ? (peak * 256.0f / rms) : 0.0f;
+
+        rec.ch[ch].mean = mean;
+        rec.ch[ch].rms = (rms > 65535.0f) ? 65535 : (uint16_t)(rms + 0.5f);
+        rec.ch[ch].peak = (peak > 0xFFFF) ? 0xFFFF : peak;
+        rec.ch[ch].crest = (crest > 65535.0f) ? 65535 : (uint16_t)(crest + 0.5f);
+    }
+
+    dc_seed = false;
+    return true;
+}
+
+bool AdvancedMeter::process(SampleBuffer buf, meter_record_t &rec) {
+    if (!buf || buf.channels() != n_channels) {
+        return false;
+    }
+    // Samples were lost before this buffer, so the DC tracker re-seeds from
+    // it rather than carrying the old mean across the gap.
+    bool discont = buf.get_flags(DMA_BUFFER_DISCONT);
+    if (discont) {
+        dc_seed = true;
+    }
+    if (!process(buf.data(), buf.size() / n_channels, rec)) {
+        return false;
+    }
+    rec.timestamp = buf.timestamp();
+    if (discont) {
+        rec.flags |= AN_METER_DISCONT;
+    }
+    return true;
+}
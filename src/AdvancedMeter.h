@@ -0,0 +1,116 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_METER_H__
+#define __ADVANCED_METER_H__
+
+#include "AdvancedAnalog.h"
+
+/**
+ * @brief DC removal mode for metering
+ */
+typedef enum {
+    AN_METER_DC_NONE  = 0U,     ///< Measure relative to code 0.
+    AN_METER_DC_BLOCK = 1U,     ///< Remove the mean of each block.
+    AN_METER_DC_TRACK = 2U,     ///< Remove a running mean, averaged across blocks.
+} meter_dc_t;
+
+#define AN_METER_DISCONT        (1U << 0)   // Record flag, the block followed a discontinuity.
+
+/**
+ * @brief Per-channel block metrics
+ */
+typedef struct {
+    uint16_t mean;      ///< Mean (DC level) in codes.
+    uint16_t rms;       ///< RMS in codes, after DC removal.
+    uint16_t peak;      ///< Peak absolute value in codes, after DC removal.
+    uint16_t crest;     ///< Crest factor (peak / rms), Q8.8.
+} meter_channel_t;
+
+/**
+ * @brief Compact metrics record for one block
+ */
+typedef struct {
+    uint32_t timestamp;                         ///< Timestamp of the block, in us.
+    uint16_t n_frames;                          ///< Samples per channel in the block.
+    uint8_t n_channels;                         ///< Number of valid entries in ch.
+    uint8_t flags;                              ///< AN_METER_x flags.
+    meter_channel_t ch[AN_MAX_ADC_CHANNELS];    ///< Per-channel metrics.
+} meter_record_t;
+
+/**
+ * @brief RMS, peak and crest-factor metering stage
+ *
+ * Reduces each interleaved block to a compact record of per-channel mean, RMS,
+ * peak absolute value and crest factor, so metrics can be logged instead of raw
+ * data. Everything is computed in a single pass: sum, sum of squares (64-bit),
+ * minimum and maximum, from which the DC-removed RMS and peak are derived.
+ * Single-channel blocks use dual 16-bit multiply-accumulates into a 64-bit
+ * accumulator (SMLALD) on Cortex-M7.
+ */
+class AdvancedMeter {
+  private:
+    size_t n_channels;
+    meter_dc_t dc_mode;
+    uint32_t dc_shift;
+    int64_t dc[AN_MAX_ADC_CHANNELS];    // Running mean, Q16 codes, 64 bits to hold 16-bit codes.
+    bool dc_seed;
+
+  public:
+    /**
+     * @brief Constructor for AdvancedMeter
+     * @param n_channels Number of interleaved channels
+     * @param dc_removal DC removal mode (default: AN_METER_DC_NONE)
+     * @param track_shift Running mean time constant, log2 of blocks (default: 4)
+     */
+    AdvancedMeter(size_t n_channels, meter_dc_t dc_removal = AN_METER_DC_NONE, uint32_t track_shift = 4);
+
+    /**
+     * @brief Meter interleaved samples
+     * @param in Interleaved samples
+     * @param n_frames Number of frames (samples per channel)
+     * @param rec Record to fill, the timestamp and flags are left as zero
+     * @return true on success, false if n_frames is 0
+     */
+    bool process(const Sample *in, size_t n_frames, meter_record_t &rec);
+
+    /**
+     * @brief Meter a sample buffer
+     * @param buf Sample buffer, must have channels() channels
+     * @param rec Record to fill, including the buffer timestamp and discontinuity flag
+     * @return true on success, false on channel mismatch
+     */
+    bool process(SampleBuffer buf, meter_record_t &rec);
+
+    /**
+     * @brief Reset the running means
+     */
+    void reset() {
+        dc_seed = true;
+    }
+
+    /**
+     * @brief Get the number of channels
+     */
+    size_t channels() const {
+        return n_channels;
+    }
+};
+
+#endif // __ADVANCED_METER_H__
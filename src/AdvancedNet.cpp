@@ -0,0 +1,244 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedNet.h"
+#include "AdvancedPack.h"
+#include "AdvancedCodec.h"
+#include "mbed.h"
+#include "netsocket/NetworkInterface.h"
+#include "netsocket/UDPSocket.h"
+#include "netsocket/TCPSocket.h"
+
+#define TX_FLAG     (1U << 0)
+
+AdvancedNet::AdvancedNet(NetworkInterface *net, size_t queue_bytes, size_t mtu) :
+    net(net), sock(nullptr), queue(nullptr), lengths(nullptr), mtu(mtu), n_slots(2), q_head(0), q_tail(0),
+    running(false), thread(nullptr), events(nullptr), res(0), enc(AN_FRAME_RAW), period(0.0f), frame_channels(0), frame_max(0),
+    seq(0), n_sent(0), n_dropped(0), n_errors(0), discont(false) {
+    // Power of two, so the free-running indices wrap cleanly.
+    while (n_slots * mtu < queue_bytes) {
+        n_slots <<= 1;
+    }
+}
+
+AdvancedNet::~AdvancedNet() {
+    end();
+}
+
+bool AdvancedNet::begin(const char *host, uint16_t port, uint32_t resolution, uint32_t sample_rate,
+                        net_protocol_t protocol, uint32_t encoding, int priority,
+                        size_t stack_size) {
+    if (running || net == nullptr || sample_rate == 0 || resolution > AN_RESOLUTION_16 || encoding > AN_FRAME_RICE
+            || mtu <= AN_FRAME_HEADER_SIZE + AN_FRAME_TRAILER_SIZE) {
+        return false;
+    }
+
+    SocketAddress addr;
+    if (net->gethostbyname(host, &addr) != NSAPI_ERROR_OK) {
+        return false;
+    }
+    addr.set_port(port);
+
+    if (protocol == AN_NET_TCP) {
+        TCPSocket *tcp = new TCPSocket();
+        if (tcp == nullptr || tcp->open(net) != NSAPI_ERROR_OK) {
+            delete tcp;
+            return false;
+        }
+        sock = tcp;
+    } else {
+        UDPSocket *udp = new UDPSocket();
+        if (udp == nullptr || udp->open(net) != NSAPI_ERROR_OK) {
+            delete udp;
+            return false;
+        }
+        sock = udp;
+    }
+    // For UDP this only sets the default peer, so send() can be used for both.
+    if (sock->connect(addr) != NSAPI_ERROR_OK) {
+        end();
+        return false;
+    }
+    // A send() blocked on a stalled TCP peer would otherwise hold end() in join() forever.
+    sock->set_timeout(AN_NET_TIMEOUT);
+
+    if (queue == nullptr) {
+        queue = new uint8_t[n_slots * mtu];
+        lengths = new size_t[n_slots];
+        events = new rtos::EventFlags();
+        if (queue == nullptr || lengths == nullptr || events == nullptr) {
+            end();
+            return false;
+        }
+    }
+
+    res = resolution;
+    enc = encoding;
+    period = 1e6f / sample_rate;
+    frame_channels = 0;
+    q_head = q_tail = 0;
+    running = true;
+
+    // The socket calls into the network stack, which needs more stack than a plain port write.
+    thread = new rtos::Thread((osPriority)priority, stack_size, nullptr, "an_net");
+    if (thread == nullptr || thread->start(mbed::callback(this, &AdvancedNet::tx_loop)) != osOK) {
+        running = false;
+        delete thread;
+        thread = nullptr;
+        end();
+        return false;
+    }
+    return true;
+}
+
+void AdvancedNet::end() {
+    if (thread) {
+        running = false;
+        events->set(TX_FLAG);
+        thread->join();
+        delete thread;
+        thread = nullptr;
+    }
+    if (sock) {
+        sock->close();
+        delete sock;
+        sock = nullptr;
+    }
+    delete[] queue;
+    queue = nullptr;
+    delete[] lengths;
+    lengths = nullptr;
+    delete events;
+    events = nullptr;
+}
+
+size_t AdvancedNet::payload_max(size_t channels, size_t n_frames) const {
+    if (enc == AN_FRAME_RICE) {
+        return an_codec_max_bytes(channels, n_frames);
+    } else if (enc == AN_FRAME_PACKED) {
+        return an_packed_bytes(res, channels * n_frames);
+    }
+    return channels * n_frames * sizeof(Sample);
+}
+
+bool AdvancedNet::write(SampleBuffer buf, int adc_id) {
+    if (!running || !buf) {
+        return false;
+    }
+
+    size_t channels = buf.channels();
+    if (channels != frame_channels) {
+        // Most sample frames that fit in a datagram in the worst case; only changes with the channel count.
+        size_t budget = mtu - AN_FRAME_HEADER_SIZE - AN_FRAME_TRAILER_SIZE;
+        frame_max = budget / (channels * sizeof(Sample)) + 1;
+        while (frame_max > 0 && payload_max(channels, frame_max) > budget) {
+            frame_max--;
+        }
+        frame_channels = channels;
+    }
+    if (frame_max == 0) {
+        return false;
+    }
+
+    size_t n_frames = buf.size() / channels;
+    size_t n_datagrams = (n_frames + frame_max - 1) / frame_max;
+    if (n_slots - (q_head - q_tail) < n_datagrams) {
+        // Drop the whole buffer, the next datagram sent is flagged as discontinuous.
+        seq += n_datagrams;
+        n_dropped += n_datagrams;
+        discont = true;
+        return false;
+    }
+
+    // The buffer timestamp is taken when its last frame completes.
+    uint32_t t_last = buf.timestamp();
+    for (size_t first = 0; first < n_frames; first += frame_max) {
+        size_t n = n_frames - first;
+        n = (n < frame_max) ? n : frame_max;
+        const Sample *src = buf.data() + first * channels;
+        size_t slot = q_head & (n_slots - 1);
+        uint8_t *dst = &queue[slot * mtu];
+
+        frame_header_t hdr;
+        hdr.sync[0] = AN_FRAME_SYNC0;
+        hdr.sync[1] = AN_FRAME_SYNC1;
+        hdr.version = AN_FRAME_VERSION;
+        hdr.adc_id = adc_id;
+        hdr.channels = channels;
+        hdr.resolution = res;
+        hdr.encoding = enc;
+        hdr.flags = ((first == 0 && buf.get_flags(DMA_BUFFER_DISCONT)) || discont) ? AN_FRAME_DISCONT : 0;
+        hdr.sequence = seq++;
+        hdr.timestamp = t_last - (uint32_t)((n_frames - 1 - first) * period + 0.5f);
+        hdr.n_samples = n * channels;
+        // Encode straight into the slot, frame_max guarantees it fits.
+        if (enc == AN_FRAME_RICE) {
+            hdr.payload_bytes = an_encode(src, channels, n, dst + AN_FRAME_HEADER_SIZE);
+        } else if (enc == AN_FRAME_PACKED) {
+            hdr.payload_bytes = an_pack(res, src, n * channels, dst + AN_FRAME_HEADER_SIZE);
+        } else {
+            hdr.payload_bytes = n * channels * sizeof(Sample);
+            memcpy(dst + AN_FRAME_HEADER_SIZE, src, hdr.payload_bytes);
+        }
+        memcpy(dst, &hdr, sizeof(hdr));
+
+        size_t len = AN_FRAME_HEADER_SIZE + hdr.payload_bytes;
+        uint32_t crc = an_crc32(0, dst, len);
+        memcpy(dst + len, &crc, sizeof(crc));
+        lengths[slot] = len + AN_FRAME_TRAILER_SIZE;
+        __DMB();
+        q_head++;
+        discont = false;
+    }
+    events->set(TX_FLAG);
+    return true;
+}
+
+void AdvancedNet::tx_loop() {
+    while (running) {
+        if (q_head == q_tail) {
+            // Nothing queued, sleep until write() queues the next datagram.
+            events->wait_any(TX_FLAG);
+            continue;
+        }
+        // The socket blocks this thread, not the caller.
+        size_t slot = q_tail & (n_slots - 1);
+        const uint8_t *data = &queue[slot * mtu];
+        size_t len = lengths[slot];
+        while (len > 0) {
+            // UDP sends the whole datagram at once, TCP may take it in pieces.
+            nsapi_size_or_error_t ret = sock->send(data, len);
+            if (ret == NSAPI_ERROR_WOULD_BLOCK && running) {
+                // Timed out, only so end() gets a chance to stop the thread.
+                continue;
+            }
+            if (ret <= 0) {
+                n_errors++;
+                break;
+            }
+            data += ret;
+            len -= ret;
+        }
+        if (len == 0) {
+            n_sent++;
+        }
+        __DMB();
+        q_tail++;
+    }
+}
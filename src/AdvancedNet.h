@@ -0,0 +1,167 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_NET_H__
+#define __ADVANCED_NET_H__
+
+#include "AdvancedAnalog.h"
+#include "AdvancedFrame.h"
+
+#define AN_NET_MTU      (1472)  // Largest UDP payload in an Ethernet frame without IP fragmentation.
+#define AN_NET_TIMEOUT  (100)   // Socket send timeout in ms, how long end() may wait for a blocked send().
+
+namespace rtos {
+class Thread;
+class EventFlags;
+}
+class NetworkInterface;
+class Socket;
+
+/**
+ * @brief Network transport
+ */
+typedef enum {
+    AN_NET_UDP,     ///< One frame per datagram, lost or reordered datagrams are detected by the receiver.
+    AN_NET_TCP,     ///< Frame stream over a TCP connection, same format as AdvancedStream.
+} net_protocol_t;
+
+/**
+ * @brief Network streaming sink
+ *
+ * Sends sample buffers to a host over UDP or TCP, as the binary frames of
+ * AdvancedFrame.h. Each buffer is split into frames of whole sample frames
+ * that fit in one datagram, each with its own sequence number and the
+ * timestamp of its first sample, so every datagram can be decoded on its own
+ * and the receiver can measure loss and reordering from the sequence numbers.
+ * write() only encodes the frames into a queue of datagram slots and returns;
+ * a sender thread owns the socket, so a slow link or a blocking socket never
+ * stalls acquisition. If the queue is full the whole buffer is dropped and
+ * counted, and its sequence numbers are skipped.
+ *
+ * See extras/host/an_netrecv.cpp for a matching receiver.
+ */
+class AdvancedNet {
+  private:
+    NetworkInterface *net;
+    Socket *sock;
+    uint8_t *queue;
+    size_t *lengths;
+    size_t mtu;
+    size_t n_slots;
+    volatile size_t q_head;
+    volatile size_t q_tail;
+    volatile bool running;
+    rtos::Thread *thread;
+    rtos::EventFlags *events;
+    uint32_t res;
+    uint32_t enc;
+    float period;
+    size_t frame_channels;
+    size_t frame_max;
+    uint32_t seq;
+    volatile uint32_t n_sent;
+    uint32_t n_dropped;
+    volatile uint32_t n_errors;
+    bool discont;
+
+    size_t payload_max(size_t channels, size_t n_frames) const;
+    void tx_loop();
+
+  public:
+    /**
+     * @brief Constructor for AdvancedNet
+     * @param net Connected network interface, e.g. WiFi.getNetwork() or Ethernet.getNetwork()
+     * @param queue_bytes Size of the transmit queue, in datagram slots of mtu bytes (default: 16384)
+     * @param mtu Largest datagram, including the frame header and CRC (default: AN_NET_MTU)
+     */
+    AdvancedNet(NetworkInterface *net, size_t queue_bytes = 16384, size_t mtu = AN_NET_MTU);
+
+    /**
+     * @brief Destructor for AdvancedNet
+     *
+     * Stops the sender thread and closes the socket.
+     */
+    ~AdvancedNet();
+
+    /**
+     * @brief Open the socket and start the sender thread
+     *
+     * With AN_NET_TCP this connects to the host first and blocks until the
+     * connection is made or fails.
+     *
+     * @param host Receiver host name or IP address
+     * @param port Receiver port
+     * @param resolution ADC resolution, recorded in every frame
+     * @param sample_rate Sample rate in Hz, used to timestamp the first sample of each frame
+     * @param protocol AN_NET_UDP or AN_NET_TCP (default: AN_NET_UDP)
+     * @param encoding Payload encoding, AN_FRAME_RAW, AN_FRAME_PACKED or AN_FRAME_RICE (default: AN_FRAME_RAW)
+     * @param priority Sender thread priority, as osPriority (default: osPriorityBelowNormal)
+     * @param stack_size Sender thread stack size in bytes, enough for the network stack (default: 4096)
+     * @return true on success, false on error
+     */
+    bool begin(const char *host, uint16_t port, uint32_t resolution, uint32_t sample_rate,
+               net_protocol_t protocol = AN_NET_UDP, uint32_t encoding = AN_FRAME_RAW, int priority = 16,
+               size_t stack_size = 4096);
+
+    /**
+     * @brief Queue a sample buffer for transmission
+     * @param buf Sample buffer, can be released as soon as this returns
+     * @param adc_id ADC instance the buffer came from (1-3), for the frame header
+     * @return true if queued, false if the buffer was dropped
+     */
+    bool write(SampleBuffer buf, int adc_id = 0);
+
+    /**
+     * @brief Stop the sender thread and close the socket
+     *
+     * Datagrams still in the queue are discarded. Waits for up to
+     * AN_NET_TIMEOUT ms for a send() in progress.
+     */
+    void end();
+
+    /**
+     * @brief Get the number of datagrams waiting in the queue
+     */
+    size_t pending() const {
+        return q_head - q_tail;
+    }
+
+    /**
+     * @brief Get the number of datagrams sent by the socket
+     */
+    uint32_t sent() const {
+        return n_sent;
+    }
+
+    /**
+     * @brief Get the number of datagrams dropped because the queue was full
+     */
+    uint32_t dropped() const {
+        return n_dropped;
+    }
+
+    /**
+     * @brief Get the number of datagrams the socket failed to send
+     */
+    uint32_t errors() const {
+        return n_errors;
+    }
+};
+
+#endif // __ADVANCED_NET_H__
@@ -0,0 +1,132 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+#include "AdvancedPack.h"
+
+// The kernels work on groups of 4 samples, which always fill BITS / 2 whole
+// bytes. A group is assembled in a 64-bit register and moved with a single
+// fixed-size memcpy, which compiles to plain (unaligned) word loads/stores on
+// the Cortex-M7 and x86; both are little-endian, which the format relies on.
+template <int BITS> static void pack(const uint16_t *in, size_t n, uint8_t *out) {
+    const uint64_t mask = (1U << BITS) - 1;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8, in += 8, out += BITS) {
+        uint64_t v0 = (in[0] & mask) | ((in[1] & mask) << BITS)
+                    | ((in[2] & mask) << (2 * BITS)) | ((in[3] & mask) << (3 * BITS));
+        uint64_t v1 = (in[4] & mask) | ((in[5] & mask) << BITS)
+                    | ((in[6] & mask) << (2 * BITS)) | ((in[7] & mask) << (3 * BITS));
+        memcpy(out, &v0, BITS / 2);
+        memcpy(out + BITS / 2, &v1, BITS / 2);
+    }
+    if (i + 4 <= n) {
+        uint64_t v = (in[0] & mask) | ((in[1] & mask) << BITS)
+                   | ((in[2] & mask) << (2 * BITS)) | ((in[3] & mask) << (3 * BITS));
+        memcpy(out, &v, BITS / 2);
+        i += 4, in += 4, out += BITS / 2;
+    }
+    if (i < n) {
+        // Leftover samples, padded with zero bits up to the next whole byte.
+        uint64_t v = 0;
+        for (size_t r = 0; i < n; i++, r++) {
+            v |= (*in++ & mask) << (r * BITS);
+        }
+        memcpy(out, &v, ((n % 4) * BITS + 7) / 8);
+    }
+}
+
+template <int BITS> static void unpack(const uint8_t *in, size_t n, uint16_t *out) {
+    const uint64_t mask = (1U << BITS) - 1;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 4, in += BITS / 2, out += 4) {
+        // The next group follows, so a full 8-byte load stays in bounds.
+        uint64_t v;
+        memcpy(&v, in, sizeof(v));
+        out[0] = v & mask;
+        out[1] = (v >> BITS) & mask;
+        out[2] = (v >> (2 * BITS)) & mask;
+        out[3] = (v >> (3 * BITS)) & mask;
+    }
+    for (; i + 4 <= n; i += 4, in += BITS / 2, out += 4) {
+        uint64_t v = 0;
+        memcpy(&v, in, BITS / 2);
+        out[0] = v & mask;
+        out[1] = (v >> BITS) & mask;
+        out[2] = (v >> (2 * BITS)) & mask;
+        out[3] = (v >> (3 * BITS)) & mask;
+    }
+    if (i < n) {
+        // Only read the bytes that hold the leftover samples.
+        uint64_t v = 0;
+        memcpy(&v, in, ((n - i) * BITS + 7) / 8);
+        for (; i < n; i++, v >>= BITS) {
+            *out++ = v & mask;
+        }
+    }
+}
+
+size_t an_packed_bytes(uint32_t resolution, size_t n) {
+    if (resolution > 4) {
+        return 0;
+    }
+    size_t bits = 8 + 2 * resolution;
+    return (n / 4) * (bits / 2) + ((n % 4) * bits + 7) / 8;
+}
+
+size_t an_pack(uint32_t resolution, const uint16_t *in, size_t n, uint8_t *out) {
+    switch (resolution) {
+        case 0: pack<8>(in, n, out); break;
+        case 1: pack<10>(in, n, out); break;
+        case 2: pack<12>(in, n, out); break;
+        case 3: pack<14>(in, n, out); break;
+        case 4: memcpy(out, in, n * sizeof(uint16_t)); break;
+        default: return 0;
+    }
+    return an_packed_bytes(resolution, n);
+}
+
+size_t an_unpack(uint32_t resolution, const uint8_t *in, size_t first, size_t n, uint16_t *out) {
+    if (resolution > 4) {
+        return 0;
+    }
+
+    // Start at the group holding the first sample, and unpack the samples
+    // before the next group boundary on their own.
+    size_t bits = 8 + 2 * resolution;
+    in += (first / 4) * (bits / 2);
+    size_t skip = first % 4;
+    size_t done = 0;
+    if (skip && n) {
+        uint16_t group[4];
+        an_unpack(resolution, in, 0, (skip + n < 4) ? skip + n : 4, group);
+        for (; skip < 4 && done < n; skip++) {
+            out[done++] = group[skip];
+        }
+        in += bits / 2;
+    }
+
+    switch (resolution) {
+        case 0: unpack<8>(in, n - done, out + done); break;
+        case 1: unpack<10>(in, n - done, out + done); break;
+        case 2: unpack<12>(in, n - done, out + done); break;
+        case 3: unpack<14>(in, n - done, out + done); break;
+        case 4: memcpy(out + done, in, (n - done) * sizeof(uint16_t)); break;
+    }
+    return n;
+}
@@ -0,0 +1,65 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_PACK_H__
+#define __ADVANCED_PACK_H__
+
+// NOTE: This header is shared with the host tools in extras/, so it must
+// only depend on the standard C headers.
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Packed sample format: samples are stored back to back, each using exactly
+ * the number of bits of the resolution (8 + 2 * AN_RESOLUTION_x), least
+ * significant bit first. Every 4 samples therefore take a whole number of
+ * bytes (4, 5, 6, 7 or 8), e.g. four 10-bit samples in 5 bytes or four
+ * 12-bit samples in 6 bytes. Interleaved buffers stay interleaved.
+ */
+
+/**
+ * @brief Get the number of bytes needed to pack samples
+ * @param resolution Sample resolution, AN_RESOLUTION_x
+ * @param n Number of samples
+ * @return Packed size in bytes
+ */
+size_t an_packed_bytes(uint32_t resolution, size_t n);
+
+/**
+ * @brief Pack samples
+ * @param resolution Sample resolution, AN_RESOLUTION_x; extra high bits are dropped
+ * @param in Samples to pack
+ * @param n Number of samples
+ * @param out Output buffer of at least an_packed_bytes(resolution, n) bytes
+ * @return Number of bytes written, 0 if the resolution is invalid
+ */
+size_t an_pack(uint32_t resolution, const uint16_t *in, size_t n, uint8_t *out);
+
+/**
+ * @brief Unpack samples
+ * @param resolution Sample resolution, AN_RESOLUTION_x
+ * @param in Packed samples
+ * @param first Index of the first sample to unpack, for random access into long captures
+ * @param n Number of samples to unpack
+ * @param out Output samples
+ * @return Number of samples unpacked, 0 if the resolution is invalid
+ */
+size_t an_unpack(uint32_t resolution, const uint8_t *in, size_t first, size_t n, uint16_t *out);
+
+#endif // __ADVANCED_PACK_H__
@@ -0,0 +1,74 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedPipeline.h"
+#include "mbed.h"
+
+AdvancedPipeline::AdvancedPipeline(AdvancedADC &adc) :
+    adc(adc), fn(nullptr), arg(nullptr), running(false), thread(nullptr), n_processed(0), max_delay(0) {
+}
+
+AdvancedPipeline::~AdvancedPipeline() {
+    end();
+}
+
+bool AdvancedPipeline::begin(pipeline_fn_t fn, void *arg, int priority, size_t stack_size) {
+    if (running || fn == nullptr) {
+        return false;
+    }
+    this->fn = fn;
+    this->arg = arg;
+    n_processed = 0;
+    max_delay = 0;
+    running = true;
+
+    thread = new rtos::Thread((osPriority)priority, stack_size, nullptr, "an_pipeline");
+    if (thread == nullptr || thread->start(mbed::callback(this, &AdvancedPipeline::loop)) != osOK) {
+        running = false;
+        delete thread;
+        thread = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void AdvancedPipeline::end() {
+    if (thread) {
+        running = false;
+        thread->join();
+        delete thread;
+        thread = nullptr;
+    }
+}
+
+void AdvancedPipeline::loop() {
+    while (running) {
+        // Time out now and then, so end() doesn't wait for a stopped ADC.
+        if (!adc.wait(10)) {
+            continue;
+        }
+        SampleBuffer buf = adc.read();
+        // Buffers are timestamped when they complete.
+        uint32_t delay = us_ticker_read() - buf.timestamp();
+        max_delay = (delay > max_delay) ? delay : max_delay;
+        fn(buf, arg);
+        buf.release();
+        n_processed++;
+    }
+}
@@ -0,0 +1,103 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_PIPELINE_H__
+#define __ADVANCED_PIPELINE_H__
+
+#include "AdvancedADC.h"
+
+namespace rtos {
+class Thread;
+}
+
+/**
+ * @brief Buffer handler run by AdvancedPipeline
+ * @param buf Sample buffer, released by the pipeline when the handler returns
+ * @param arg Argument passed to AdvancedPipeline::begin()
+ */
+typedef void (*pipeline_fn_t)(SampleBuffer buf, void *arg);
+
+/**
+ * @brief Runs a buffer handler in a dedicated RTOS thread
+ *
+ * The thread blocks in AdvancedADC::wait() until the DMA interrupt signals
+ * a completed buffer, then calls the handler with it and releases it. With
+ * a priority above the application's, every buffer is handled with a short,
+ * predictable delay, and the rest of the time other threads, including
+ * loop(), run undisturbed.
+ */
+class AdvancedPipeline {
+  private:
+    AdvancedADC &adc;
+    pipeline_fn_t fn;
+    void *arg;
+    volatile bool running;
+    rtos::Thread *thread;
+    uint32_t n_processed;
+    uint32_t max_delay;
+
+    void loop();
+
+  public:
+    /**
+     * @brief Constructor for AdvancedPipeline
+     * @param adc ADC to take buffers from
+     */
+    AdvancedPipeline(AdvancedADC &adc);
+
+    /**
+     * @brief Destructor for AdvancedPipeline
+     *
+     * Stops the thread.
+     */
+    ~AdvancedPipeline();
+
+    /**
+     * @brief Start the pipeline thread
+     * @param fn Handler called for every buffer
+     * @param arg Argument passed to the handler (default: nullptr)
+     * @param priority Thread priority, as osPriority (default: osPriorityAboveNormal)
+     * @param stack_size Thread stack size in bytes (default: 4096)
+     * @return true on success, false on error
+     */
+    bool begin(pipeline_fn_t fn, void *arg = nullptr, int priority = 32, size_t stack_size = 4096);
+
+    /**
+     * @brief Stop the pipeline thread
+     *
+     * Waits for the handler to finish the current buffer.
+     */
+    void end();
+
+    /**
+     * @brief Get the number of buffers handled
+     */
+    uint32_t processed() const {
+        return n_processed;
+    }
+
+    /**
+     * @brief Get the longest delay from a buffer's completion to its handler, in us
+     */
+    uint32_t max_latency() const {
+        return max_delay;
+    }
+};
+
+#endif // __ADVANCED_PIPELINE_H__
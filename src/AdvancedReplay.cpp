@@ -0,0 +1,254 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedReplay.h"
+#include "AdvancedPack.h"
+#include "AdvancedCodec.h"
+
+AdvancedReplay::AdvancedReplay() :
+    pool(nullptr), mem(nullptr), mem_frames(0), file(nullptr), data_start(0), scratch(nullptr),
+    encoding(AN_FRAME_RAW), res(0), n_channels(0), n_samples(0), sample_rate(0.0f), mode(AN_REPLAY_REALTIME),
+    repeat(false), pending(false), finished(true), discont(false), resync(true), pos(0), index(0), src_time(0),
+    src_first(0), src_offset(0), t_start(0), every(0), length(0), n_replayed(0), n_dropped(0) {
+}
+
+AdvancedReplay::~AdvancedReplay() {
+    end();
+}
+
+bool AdvancedReplay::begin(const Sample *data, size_t n_frames, size_t n_channels, uint32_t sample_rate,
+                           size_t n_samples, size_t n_buffers, replay_mode_t mode, bool repeat) {
+    if (pool || data == nullptr || n_channels == 0 || n_channels > AN_MAX_ADC_CHANNELS
+            || sample_rate == 0 || n_samples == 0) {
+        return false;
+    }
+    mem = data;
+    mem_frames = n_frames;
+    this->n_channels = n_channels;
+    this->n_samples = n_samples;
+    this->sample_rate = sample_rate;
+    return start(n_buffers, mode, repeat);
+}
+
+bool AdvancedReplay::begin(const char *path, size_t n_buffers, replay_mode_t mode, bool repeat) {
+    if (pool || (file = fopen(path, "rb")) == nullptr) {
+        return false;
+    }
+
+    capture_header_t hdr;
+    if (fread(&hdr, sizeof(hdr), 1, file) != 1 || hdr.magic != AN_CAPTURE_MAGIC
+            || hdr.version != AN_CAPTURE_VERSION || hdr.channels == 0 || hdr.channels > AN_MAX_ADC_CHANNELS
+            || hdr.encoding > AN_FRAME_RICE || hdr.sample_rate <= 0.0f) {
+        end();
+        return false;
+    }
+
+    // The first chunk sets the buffer size.
+    data_start = hdr.header_bytes;
+    if (fseek(file, data_start, SEEK_SET) != 0 || fread(&chunk, sizeof(chunk), 1, file) != 1
+            || chunk.magic != AN_CAPTURE_CHUNK_MAGIC || chunk.n_samples == 0
+            || chunk.n_samples % hdr.channels || fseek(file, data_start, SEEK_SET) != 0) {
+        end();
+        return false;
+    }
+    n_channels = hdr.channels;
+    n_samples = chunk.n_samples / hdr.channels;
+    sample_rate = hdr.sample_rate;
+    encoding = hdr.encoding;
+    res = hdr.resolution;
+
+    // Large enough for any encoding, including the padding.
+    scratch = new uint8_t[an_codec_max_bytes(n_channels, n_samples) + 4];
+    if (scratch == nullptr) {
+        end();
+        return false;
+    }
+    return start(n_buffers, mode, repeat);
+}
+
+bool AdvancedReplay::start(size_t n_buffers, replay_mode_t mode, bool repeat) {
+    pool = new DMAPool<Sample>(n_samples, n_channels, n_buffers);
+    if (pool == nullptr) {
+        end();
+        return false;
+    }
+    this->mode = mode;
+    this->repeat = repeat;
+    pending = false;
+    finished = false;
+    discont = false;
+    resync = true;
+    pos = 0;
+    index = 0;
+    src_time = src_offset = 0;
+    n_replayed = n_dropped = 0;
+    t_start = micros();
+    return true;
+}
+
+void AdvancedReplay::inject(uint32_t every, uint32_t length) {
+    this->every = every;
+    this->length = (length < every) ? length : every;
+}
+
+bool AdvancedReplay::fetch() {
+    // Sets src_time to the end of the next buffer, relative to the start.
+    if (mem) {
+        if (pos + n_samples > mem_frames) {
+            if (!repeat || n_samples > mem_frames) {
+                return false;
+            }
+            pos = 0;
+        }
+        src_time = (uint32_t)((index + 1) * (double)n_samples * 1e6 / sample_rate);
+        return true;
+    }
+
+    size_t max_bytes = an_codec_max_bytes(n_channels, n_samples);
+    for (;;) {
+        if (fread(&chunk, sizeof(chunk), 1, file) == 1 && chunk.magic == AN_CAPTURE_CHUNK_MAGIC) {
+            size_t padded = (chunk.payload_bytes + 3) & ~3UL;
+            if (chunk.n_samples != n_samples * n_channels || chunk.payload_bytes > max_bytes) {
+                // Not a buffer of this capture's size, skip it.
+                if (fseek(file, padded, SEEK_CUR) != 0) {
+                    return false;
+                }
+                continue;
+            }
+            if (fread(scratch, 1, padded, file) != padded) {
+                return false;
+            }
+            // Chunks are stamped with their first sample, buffers with their last.
+            uint32_t t = chunk.timestamp + (uint32_t)((n_samples - 1) * 1e6f / sample_rate + 0.5f);
+            if (resync) {
+                src_first = t - (uint32_t)(n_samples * 1e6f / sample_rate + 0.5f);
+                resync = false;
+            }
+            src_time = t - src_first + src_offset;
+            return true;
+        }
+        // End of the chunks; continue the timeline after the last buffer.
+        if (!repeat || index == 0 || fseek(file, data_start, SEEK_SET) != 0) {
+            return false;
+        }
+        src_offset = src_time;
+        resync = true;
+    }
+}
+
+void AdvancedReplay::deliver(DMABuffer<Sample> *buf) {
+    size_t n = n_samples * n_channels;
+    bool ok = true;
+    if (mem) {
+        memcpy(buf->data(), &mem[pos * n_channels], n * sizeof(Sample));
+    } else if (encoding == AN_FRAME_RICE) {
+        ok = an_decode(scratch, chunk.payload_bytes, n_channels, n_samples, buf->data()) == chunk.payload_bytes;
+    } else if (encoding == AN_FRAME_PACKED) {
+        ok = chunk.payload_bytes == an_packed_bytes(res, n) && an_unpack(res, scratch, 0, n, buf->data()) == n;
+    } else {
+        ok = chunk.payload_bytes == n * sizeof(Sample);
+        memcpy(buf->data(), scratch, ok ? n * sizeof(Sample) : 0);
+    }
+    if (!ok) {
+        memset(buf->data(), 0, n * sizeof(Sample));
+        discont = true;
+    }
+
+    // Same timestamps and flags as the ADC's DMA callback.
+    buf->timestamp(t_start + src_time);
+    buf->clr_flags(DMA_BUFFER_DISCONT | DMA_BUFFER_INTRLVD);
+    if (n_channels > 1) {
+        buf->set_flags(DMA_BUFFER_INTRLVD);
+    }
+    if (discont || (!mem && (chunk.flags & AN_FRAME_DISCONT))) {
+        buf->set_flags(DMA_BUFFER_DISCONT);
+    }
+    discont = false;
+    buf->release();
+    n_replayed++;
+}
+
+void AdvancedReplay::produce() {
+    while (!finished) {
+        if (!pending) {
+            if (!fetch()) {
+                finished = true;
+                break;
+            }
+            pending = true;
+        }
+        if (mode == AN_REPLAY_REALTIME) {
+            if ((int32_t)(micros() - (t_start + src_time)) < 0) {
+                break;
+            }
+        } else if (!pool->writable()) {
+            break;
+        }
+
+        // Overruns: the buffer is lost and the next one is flagged.
+        if ((every && (index % every) >= every - length) || !pool->writable()) {
+            n_dropped++;
+            discont = true;
+        } else {
+            deliver(pool->alloc(DMA_BUFFER_WRITE));
+        }
+        pending = false;
+        index++;
+        pos += n_samples;
+    }
+}
+
+bool AdvancedReplay::available() {
+    if (pool == nullptr) {
+        return false;
+    }
+    produce();
+    return pool->readable();
+}
+
+SampleBuffer AdvancedReplay::read() {
+    static DMABuffer<Sample> NULLBUF;
+    if (pool != nullptr) {
+        while (!available()) {
+            if (finished) {
+                return NULLBUF;
+            }
+            yield();
+        }
+        return *pool->alloc(DMA_BUFFER_READ);
+    }
+    return NULLBUF;
+}
+
+bool AdvancedReplay::done() {
+    return pool == nullptr || (finished && !pool->readable());
+}
+
+void AdvancedReplay::end() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    delete pool;
+    pool = nullptr;
+    delete[] scratch;
+    scratch = nullptr;
+    mem = nullptr;
+    finished = true;
+}
@@ -0,0 +1,183 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_REPLAY_H__
+#define __ADVANCED_REPLAY_H__
+
+#include <stdio.h>
+#include "AdvancedAnalog.h"
+#include "AdvancedCapture.h"
+
+/**
+ * @brief Replay pacing modes
+ */
+typedef enum {
+    AN_REPLAY_REALTIME = 0,     ///< Buffers become available at the recorded rate.
+    AN_REPLAY_FAST     = 1,     ///< Buffers become available as fast as they're consumed.
+} replay_mode_t;
+
+/**
+ * @brief Replay source for recorded samples
+ *
+ * Presents a capture file or an in-memory array of interleaved samples
+ * through the same available()/read() interface as AdvancedADC, with the
+ * same buffer pool, timestamps and flags, so processing code can be tested
+ * and benchmarked on recorded data. Buffers are produced from within
+ * available() and read(), in the caller's thread, which keeps runs
+ * deterministic.
+ *
+ * In real-time mode, a consumer that falls behind causes overruns exactly
+ * like on the ADC: the late buffer is lost and the next one is flagged
+ * DMA_BUFFER_DISCONT. Overruns can also be injected at fixed intervals.
+ */
+class AdvancedReplay {
+  private:
+    DMAPool<Sample> *pool;
+    const Sample *mem;
+    size_t mem_frames;
+    FILE *file;
+    long data_start;
+    uint8_t *scratch;
+    capture_chunk_t chunk;
+    uint32_t encoding;
+    uint32_t res;
+    size_t n_channels;
+    size_t n_samples;
+    float sample_rate;
+    replay_mode_t mode;
+    bool repeat;
+    bool pending;
+    bool finished;
+    bool discont;
+    bool resync;
+    size_t pos;
+    uint32_t index;
+    uint32_t src_time;
+    uint32_t src_first;
+    uint32_t src_offset;
+    uint32_t t_start;
+    uint32_t every;
+    uint32_t length;
+    uint32_t n_replayed;
+    uint32_t n_dropped;
+
+    bool start(size_t n_buffers, replay_mode_t mode, bool repeat);
+    bool fetch();
+    void deliver(DMABuffer<Sample> *buf);
+    void produce();
+
+  public:
+    /**
+     * @brief Constructor for AdvancedReplay
+     */
+    AdvancedReplay();
+
+    /**
+     * @brief Destructor for AdvancedReplay
+     */
+    ~AdvancedReplay();
+
+    /**
+     * @brief Replay an in-memory array of samples
+     * @param data Interleaved samples, must stay valid until end()
+     * @param n_frames Number of frames in data
+     * @param n_channels Number of interleaved channels
+     * @param sample_rate Sample rate in Hz
+     * @param n_samples Number of samples per buffer per channel
+     * @param n_buffers Number of buffers in the queue
+     * @param mode Pacing mode (default: AN_REPLAY_REALTIME)
+     * @param repeat Start over at the end of the data (default: false)
+     * @return true on success, false on error
+     */
+    bool begin(const Sample *data, size_t n_frames, size_t n_channels, uint32_t sample_rate,
+               size_t n_samples, size_t n_buffers, replay_mode_t mode = AN_REPLAY_REALTIME, bool repeat = false);
+
+    /**
+     * @brief Replay a capture file written by AdvancedLogger
+     * @param path File path
+     * @param n_buffers Number of buffers in the queue
+     * @param mode Pacing mode (default: AN_REPLAY_REALTIME)
+     * @param repeat Start over at the end of the file (default: false)
+     * @return true on success, false on error
+     *
+     * The buffer size is taken from the first chunk of the file.
+     */
+    bool begin(const char *path, size_t n_buffers, replay_mode_t mode = AN_REPLAY_REALTIME, bool repeat = false);
+
+    /**
+     * @brief Inject overruns
+     * @param every Interval in buffers, 0 to disable
+     * @param length Number of buffers lost at the end of every interval
+     */
+    void inject(uint32_t every, uint32_t length = 1);
+
+    /**
+     * @brief Check if sample data is available
+     * @return true if a buffer is ready to be read
+     */
+    bool available();
+
+    /**
+     * @brief Read a sample buffer
+     * @return SampleBuffer, which must be released, or an empty buffer once the replay has finished
+     *
+     * Waits until a buffer is available, like AdvancedADC::read().
+     */
+    SampleBuffer read();
+
+    /**
+     * @brief Stop the replay and release all resources
+     */
+    void end();
+
+    /**
+     * @brief Get the number of channels
+     */
+    size_t channels() {
+        return n_channels;
+    }
+
+    /**
+     * @brief Get the sample rate
+     */
+    float rate() {
+        return sample_rate;
+    }
+
+    /**
+     * @brief Check if the whole source has been replayed and read
+     */
+    bool done();
+
+    /**
+     * @brief Get the number of buffers made available
+     */
+    uint32_t replayed() const {
+        return n_replayed;
+    }
+
+    /**
+     * @brief Get the number of buffers lost to overruns, injected or not
+     */
+    uint32_t dropped() const {
+        return n_dropped;
+    }
+};
+
+#endif // __ADVANCED_REPLAY_H__
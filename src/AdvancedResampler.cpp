@@ -0,0 +1,211 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedResampler.h"
+
+static const uint8_t RS_RES_BITS[] = {8, 10, 12, 14, 16};
+
+static uint32_t rs_gcd(uint32_t a, uint32_t b) {
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static float rs_kernel(float x, float fc, float half) {
+    // Blackman-windowed sinc, cutoff fc in cycles per input sample.
+    if (x <= -half || x >= half) {
+        return 0.0f;
+    }
+    float w = 0.42f + 0.5f * cosf(PI * x / half) + 0.08f * cosf(2.0f * PI * x / half);
+    float s = (x == 0.0f) ? 2.0f * fc : sinf(2.0f * PI * fc * x) / (PI * x);
+    return s * w;
+}
+
+AdvancedResampler::AdvancedResampler(size_t n_channels, uint32_t in_rate, uint32_t out_rate,
+                                     uint32_t resolution, size_t taps) :
+    n_channels(n_channels), n_taps(taps), n_phases(0), up(1), down(1), acc(0), max_code(0xFFFF),
+    mid(32768), head(0), primed(false), coefs(nullptr), hist(nullptr) {
+    if (this->n_channels > AN_MAX_ADC_CHANNELS) {
+        this->n_channels = AN_MAX_ADC_CHANNELS;
+    }
+
+    n_taps = (n_taps < 2) ? 2 : (n_taps > AN_RESAMPLE_MAX_TAPS) ? AN_RESAMPLE_MAX_TAPS : (n_taps & ~1UL);
+
+    if (resolution < AN_ARRAY_SIZE(RS_RES_BITS)) {
+        max_code = (1UL << RS_RES_BITS[resolution]) - 1;
+    }
+    mid = (int32_t)((max_code + 1) / 2);
+
+    if (in_rate == 0 || out_rate == 0) {
+        in_rate = out_rate = 1;
+    }
+    uint32_t g = rs_gcd(in_rate, out_rate);
+    up = out_rate / g;
+    down = in_rate / g;
+
+    // The cutoff scales down with the decimation ratio, so the window must
+    // grow with it to keep the same transition band relative to the cutoff.
+    // Outputs are fewer by the same ratio, so the cost per input stays put.
+    if (down > up) {
+        uint64_t t = ((uint64_t)n_taps * down + up - 1) / up;
+        n_taps = (t > AN_RESAMPLE_MAX_TAPS) ? AN_RESAMPLE_MAX_TAPS : ((size_t)t + 1) & ~1UL;
+    }
+
+    // One phase per output position if the ratio allows, otherwise interpolate.
+    // The extra phase (a full sample shift) closes the interpolation interval.
+    n_phases = (up <= AN_RESAMPLE_MAX_PHASES) ? up : AN_RESAMPLE_MAX_PHASES;
+    coefs = new int16_t[(n_phases + 1) * n_taps];
+    hist = new int16_t[this->n_channels * 2 * n_taps];
+
+    // Cutoff at 90% of the lower Nyquist frequency, in input-rate units.
+    float ratio = (float)up / (float)down;
+    float fc = 0.45f * ((ratio < 1.0f) ? ratio : 1.0f);
+    float half = n_taps / 2.0f;
+
+    for (size_t p = 0; p <= n_phases; p++) {
+        float mu = (float)p / (float)n_phases;
+        float h[AN_RESAMPLE_MAX_TAPS];
+        float sum = 0.0f;
+        // Tap k multiplies x[n - k], the output lies mu after x[n - taps/2].
+        for (size_t k = 0; k < n_taps; k++) {
+            h[k] = rs_kernel((float)k - half + mu, fc, half);
+            sum += h[k];
+        }
+
+        // Normalize each phase to unity DC gain, and put the rounding residue
+        // on the largest tap so the Q15 taps sum to exactly 32768.
+        int32_t q_sum = 0;
+        size_t k_max = 0;
+        int16_t *c = &coefs[p * n_taps];
+        for (size_t k = 0; k < n_taps; k++) {
+            float v = h[k] / sum * 32768.0f;
+            c[k] = (int16_t)((v < 0.0f) ? v - 0.5f : v + 0.5f);
+            q_sum += c[k];
+            k_max = (h[k] > h[k_max]) ? k : k_max;
+        }
+        c[k_max] += (int16_t)(32768 - q_sum);
+    }
+
+    reset();
+}
+
+AdvancedResampler::~AdvancedResampler() {
+    delete[] coefs;
+    delete[] hist;
+}
+
+void AdvancedResampler::reset() {
+    for (size_t i = 0; i < n_channels * 2 * n_taps; i++) {
+        hist[i] = 0;
+    }
+    head = 0;
+    acc = 0;
+    primed = false;
+}
+
+int16_t AdvancedResampler::offset(Sample code) const {
+    // Out-of-range codes are clamped, so the offset always fits 16 bits.
+    uint32_t c = (code > max_code) ? max_code : code;
+    return (int16_t)((int32_t)c - mid);
+}
+
+int32_t AdvancedResampler::dot(const int16_t *c, const int16_t *x) const {
+    int32_t sum = 0;
+#if defined(__ARM_FEATURE_DSP)
+    // Two 16x16 MACs per instruction. Taps are even, and the Q15 taps'
+    // absolute sum keeps the result well within 32 bits.
+    for (size_t k = 0; k < n_taps; k += 2) {
+        uint32_t c2, x2;
+        memcpy(&c2, &c[k], sizeof(c2));
+        memcpy(&x2, &x[k], sizeof(x2));
+        sum = __SMLAD(c2, x2, sum);
+    }
+#else
+    for (size_t k = 0; k < n_taps; k++) {
+        sum += (int32_t)c[k] * x[k];
+    }
+#endif
+    return sum;
+}
+
+size_t AdvancedResampler::process(const Sample *in, size_t n_frames, Sample *out, size_t max_frames) {
+    size_t n_out = 0;
+    const size_t t2 = 2 * n_taps;
+    const uint64_t p_scale = (uint64_t)n_phases;
+
+    if (!primed && n_frames) {
+        // Start as if the first frame had always been there, instead of
+        // filtering a step up from mid-scale.
+        for (size_t ch = 0; ch < n_channels; ch++) {
+            int16_t v = offset(in[ch]);
+            for (size_t k = 0; k < t2; k++) {
+                hist[ch * t2 + k] = v;
+            }
+        }
+        primed = true;
+    }
+
+    for (size_t n = 0; n < n_frames; n++) {
+        // Push the frame. Each history is stored newest-first twice over, so
+        // the window of the last taps samples is always contiguous.
+        head = (head == 0) ? n_taps - 1 : head - 1;
+        for (size_t ch = 0; ch < n_channels; ch++) {
+            int16_t v = offset(in[n * n_channels + ch]);
+            hist[ch * t2 + head] = v;
+            hist[ch * t2 + head + n_taps] = v;
+        }
+
+        // Emit every output that falls in the interval of this input sample.
+        while (acc < up) {
+            uint64_t pos = (uint64_t)acc * p_scale;
+            size_t p = (size_t)(pos / up);
+            uint32_t frac = (uint32_t)(((pos % up) << 16) / up);
+            const int16_t *c0 = &coefs[p * n_taps];
+
+            if (n_out < max_frames) {
+                Sample *dst = &out[n_out * n_channels];
+                for (size_t ch = 0; ch < n_channels; ch++) {
+                    const int16_t *x = &hist[ch * t2 + head];
+                    int64_t y = dot(c0, x);
+                    if (frac) {
+                        // Between two phases of the bank.
+                        int64_t y1 = dot(c0 + n_taps, x);
+                        y = (y * (65536 - frac) + y1 * frac) >> 16;
+                    }
+                    int32_t s = (int32_t)((y + (1 << 14)) >> 15) + mid;
+                    dst[ch] = (s < 0) ? 0 : ((uint32_t)s > max_code) ? max_code : s;
+                }
+                n_out++;
+            }
+            acc += down;
+        }
+        acc -= up;
+    }
+    return n_out;
+}
+
+size_t AdvancedResampler::process(SampleBuffer buf, Sample *out, size_t max_frames) {
+    if (!buf || buf.channels() != n_channels) {
+        return 0;
+    }
+    return process(buf.data(), buf.size() / n_channels, out, max_frames);
+}
@@ -0,0 +1,137 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_RESAMPLER_H__
+#define __ADVANCED_RESAMPLER_H__
+
+#include "AdvancedAnalog.h"
+
+#define AN_RESAMPLE_MAX_PHASES  (128)   // Phases in the filter bank, exact ratios up to L=128.
+#define AN_RESAMPLE_MAX_TAPS    (128)   // Max taps per phase, after scaling for decimation.
+
+/**
+ * @brief Polyphase fractional sample-rate converter
+ *
+ * Converts an interleaved stream from in_rate to out_rate. The ratio is kept
+ * as an exact fraction L/M, and the position of each output sample between
+ * two input samples is tracked with an integer accumulator, so there's no
+ * long-term drift. The filter bank is a Blackman-windowed sinc, designed once
+ * at construction, with its cutoff set below the lower of the two Nyquist
+ * frequencies. When decimating, the taps per phase are scaled by M/L so the
+ * transition band shrinks with the cutoff; past AN_RESAMPLE_MAX_TAPS / taps
+ * (8x at the default 16 taps) the window can't keep up and content above the
+ * output Nyquist frequency aliases, so larger ratios should be split over
+ * two resamplers in series. If L fits in AN_RESAMPLE_MAX_PHASES the bank has
+ * exactly L phases; otherwise output samples are linearly interpolated
+ * between the two nearest of AN_RESAMPLE_MAX_PHASES phases.
+ *
+ * Coefficients are Q15 and samples are stored as signed 16-bit offsets from
+ * the resolution's mid-scale, so the dot products run on 16-bit dual MACs
+ * (SMLAD) on Cortex-M7. Latency is taps / 2 input samples. Each channel keeps
+ * its own history, seeded with its first sample so the output doesn't ramp in.
+ */
+class AdvancedResampler {
+  private:
+    size_t n_channels;
+    size_t n_taps;
+    size_t n_phases;
+    uint32_t up;
+    uint32_t down;
+    uint32_t acc;
+    uint32_t max_code;
+    int32_t mid;
+    size_t head;
+    bool primed;
+    int16_t *coefs;
+    int16_t *hist;
+
+    int16_t offset(Sample code) const;
+    int32_t dot(const int16_t *c, const int16_t *x) const;
+
+  public:
+    /**
+     * @brief Constructor for AdvancedResampler
+     * @param n_channels Number of interleaved channels
+     * @param in_rate Input sample rate in Hz
+     * @param out_rate Output sample rate in Hz
+     * @param resolution ADC resolution, output is clamped to its range (AN_RESOLUTION_8..16)
+     * @param taps Taps per phase, even, up to AN_RESAMPLE_MAX_TAPS (default: 16);
+     * scaled by in_rate / out_rate when decimating
+     */
+    AdvancedResampler(size_t n_channels, uint32_t in_rate, uint32_t out_rate, uint32_t resolution,
+                      size_t taps = 16);
+
+    /**
+     * @brief Destructor for AdvancedResampler
+     */
+    ~AdvancedResampler();
+
+    /**
+     * @brief Resample interleaved frames
+     * @param in Interleaved input samples
+     * @param n_frames Number of input frames
+     * @param out Interleaved output samples
+     * @param max_frames Capacity of out in frames, see frames()
+     * @return Number of output frames written
+     *
+     * Output frames beyond max_frames are discarded, the stream position still advances.
+     */
+    size_t process(const Sample *in, size_t n_frames, Sample *out, size_t max_frames);
+
+    /**
+     * @brief Resample a sample buffer
+     * @param buf Sample buffer, must have channels() channels
+     * @param out Interleaved output samples
+     * @param max_frames Capacity of out in frames, see frames()
+     * @return Number of output frames written, 0 on channel mismatch
+     */
+    size_t process(SampleBuffer buf, Sample *out, size_t max_frames);
+
+    /**
+     * @brief Get the max number of output frames for a number of input frames
+     * @param n_frames Number of input frames
+     * @return Output capacity needed to never discard frames
+     */
+    size_t frames(size_t n_frames) const {
+        return (size_t)(((uint64_t)n_frames * up + down - 1) / down) + 1;
+    }
+
+    /**
+     * @brief Get the latency of the filter in input samples
+     */
+    size_t latency() const {
+        return n_taps / 2;
+    }
+
+    /**
+     * @brief Clear the channel histories and the output phase
+     *
+     * The histories are seeded again from the next processed frame.
+     */
+    void reset();
+
+    /**
+     * @brief Get the number of channels
+     */
+    size_t channels() const {
+        return n_channels;
+    }
+};
+
+#endif // __ADVANCED_RESAMPLER_H__
@@ -0,0 +1,147 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedRing.h"
+
+#if defined(ARDUINO)
+#include "Arduino.h"
+#endif
+
+typedef char ring_header_size_check[(sizeof(ring_header_t) == 3 * AN_RING_LINE) ? 1 : -1];
+
+// Only a core with a data cache (the M7) needs maintenance; the M4 and hosts are coherent.
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+#define RING_CLEAN(addr, size)      SCB_CleanDCache_by_Addr((uint32_t *)(addr), (int32_t)(size))
+#define RING_INVALIDATE(addr, size) SCB_InvalidateDCache_by_Addr((uint32_t *)(addr), (int32_t)(size))
+#else
+#define RING_CLEAN(addr, size)
+#define RING_INVALIDATE(addr, size)
+#endif
+
+// The three cache lines of the header, see ring_header_t.
+#define RING_SETUP(r)       ((uint8_t *)(r))
+#define RING_PRODUCER(r)    ((uint8_t *)(r) + AN_RING_LINE)
+#define RING_CONSUMER(r)    ((uint8_t *)(r) + 2 * AN_RING_LINE)
+
+static inline ring_slot_t *ring_slot(ring_header_t *ring, uint32_t index) {
+    uint8_t *slots = (uint8_t *)ring + sizeof(ring_header_t);
+    return (ring_slot_t *)(slots + (size_t)(index & (ring->n_slots - 1)) * ring->slot_bytes);
+}
+
+size_t an_ring_slot_bytes(size_t n_channels, size_t n_samples) {
+    size_t bytes = sizeof(ring_slot_t) + n_channels * n_samples * sizeof(uint16_t);
+    return (bytes + AN_RING_LINE - 1) & ~(size_t)(AN_RING_LINE - 1);
+}
+
+ring_header_t *an_ring_init(void *mem, size_t mem_bytes, size_t n_channels, size_t n_samples, float sample_rate) {
+    if (mem == nullptr || ((uintptr_t)mem & (AN_RING_LINE - 1)) || mem_bytes < sizeof(ring_header_t)
+            || n_channels == 0 || n_samples == 0) {
+        return nullptr;
+    }
+    size_t slot_bytes = an_ring_slot_bytes(n_channels, n_samples);
+    size_t n_slots = 1;
+    while (sizeof(ring_header_t) + 2 * n_slots * slot_bytes <= mem_bytes) {
+        n_slots <<= 1;
+    }
+    if (n_slots < 2) {
+        return nullptr;
+    }
+
+    ring_header_t *ring = (ring_header_t *)mem;
+    // Invalidate the magic first, in case a consumer is still attached to an old ring.
+    __atomic_store_n(&ring->magic, 0, __ATOMIC_RELEASE);
+    RING_CLEAN(RING_SETUP(ring), AN_RING_LINE);
+    ring->n_slots = n_slots;
+    ring->slot_bytes = slot_bytes;
+    ring->n_channels = n_channels;
+    ring->n_samples = n_samples;
+    ring->sample_rate = sample_rate;
+    ring->head = 0;
+    ring->dropped = 0;
+    ring->sequence = 0;
+    ring->discont = 0;
+    ring->tail = 0;
+    RING_CLEAN(ring, sizeof(ring_header_t));
+    __atomic_store_n(&ring->magic, AN_RING_MAGIC, __ATOMIC_RELEASE);
+    RING_CLEAN(RING_SETUP(ring), AN_RING_LINE);
+    return ring;
+}
+
+ring_header_t *an_ring_attach(void *mem, size_t mem_bytes) {
+    if (mem == nullptr || ((uintptr_t)mem & (AN_RING_LINE - 1)) || mem_bytes < sizeof(ring_header_t)) {
+        return nullptr;
+    }
+    ring_header_t *ring = (ring_header_t *)mem;
+    RING_INVALIDATE(ring, sizeof(ring_header_t));
+    if (__atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) != AN_RING_MAGIC || ring->n_slots < 2
+            || (ring->n_slots & (ring->n_slots - 1)) || ring->n_channels == 0 || ring->n_samples == 0
+            || ring->slot_bytes != an_ring_slot_bytes(ring->n_channels, ring->n_samples)
+            || sizeof(ring_header_t) + (size_t)ring->n_slots * ring->slot_bytes > mem_bytes) {
+        return nullptr;
+    }
+    return ring;
+}
+
+ring_slot_t *an_ring_reserve(ring_header_t *ring) {
+    RING_INVALIDATE(RING_CONSUMER(ring), AN_RING_LINE);
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (ring->head - tail >= ring->n_slots) {
+        // Full: the producer's counters are private to this side until the next publish.
+        ring->sequence++;
+        ring->dropped++;
+        ring->discont = 1;
+        return nullptr;
+    }
+    ring_slot_t *slot = ring_slot(ring, ring->head);
+    slot->sequence = ring->sequence;
+    slot->flags = ring->discont ? AN_RING_DISCONT : 0;
+    slot->reserved = 0;
+    return slot;
+}
+
+void an_ring_publish(ring_header_t *ring) {
+    // The slot must be visible before the head moves past it.
+    RING_CLEAN(ring_slot(ring, ring->head), ring->slot_bytes);
+    ring->sequence++;
+    ring->discont = 0;
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+    RING_CLEAN(RING_PRODUCER(ring), AN_RING_LINE);
+}
+
+const ring_slot_t *an_ring_peek(ring_header_t *ring) {
+    RING_INVALIDATE(RING_PRODUCER(ring), AN_RING_LINE);
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (head == ring->tail) {
+        return nullptr;
+    }
+    ring_slot_t *slot = ring_slot(ring, ring->tail);
+    RING_INVALIDATE(slot, ring->slot_bytes);
+    return slot;
+}
+
+void an_ring_consume(ring_header_t *ring) {
+    // Release ordering: the slot is read before the producer may reuse it.
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+    RING_CLEAN(RING_CONSUMER(ring), AN_RING_LINE);
+}
+
+uint32_t an_ring_dropped(ring_header_t *ring) {
+    RING_INVALIDATE(RING_PRODUCER(ring), AN_RING_LINE);
+    return __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,159 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_RING_H__
+#define __ADVANCED_RING_H__
+
+// NOTE: This header is shared with the host tools in extras/, so it must
+// only depend on the standard C headers.
+#include <stddef.h>
+#include <stdint.h>
+
+#define AN_RING_MAGIC       (0x474E5241UL)  // "ARNG"
+#define AN_RING_LINE        (32)            // Cache line size of the Cortex-M7.
+
+/**
+ * @brief Ring slot flags
+ */
+enum {
+    AN_RING_DISCONT     = (1U << 0),    ///< Buffers were dropped before this one.
+};
+
+/**
+ * @brief Shared ring header
+ *
+ * A single-producer, single-consumer ring of fixed-size sample buffers in
+ * memory shared by two cores (or two threads on a host). Each side only
+ * writes its own cache line: the producer owns the setup and head line, the
+ * consumer owns the tail line, and slots are written by the producer only.
+ * Indices are free-running and published with release/acquire ordering; on
+ * a core with a data cache, each side cleans what it wrote and invalidates
+ * what it reads, so the handoff works without coherent caches or locks.
+ */
+typedef struct {
+    // Set once by an_ring_init().
+    uint32_t magic;             ///< AN_RING_MAGIC once initialized.
+    uint32_t n_slots;           ///< Number of slots, a power of two.
+    uint32_t slot_bytes;        ///< Slot stride in bytes, a multiple of AN_RING_LINE.
+    uint32_t n_channels;        ///< Interleaved channels per buffer.
+    uint32_t n_samples;         ///< Samples per channel per buffer.
+    float sample_rate;          ///< Sample rate in Hz, for the consumer.
+    uint32_t reserved0[2];
+    // Written by the producer.
+    uint32_t head;              ///< Slots published.
+    uint32_t dropped;           ///< Buffers dropped because the ring was full.
+    uint32_t sequence;          ///< Sequence number of the next buffer.
+    uint32_t discont;           ///< Flag the next slot AN_RING_DISCONT.
+    uint32_t reserved1[4];
+    // Written by the consumer.
+    uint32_t tail;              ///< Slots consumed.
+    uint32_t reserved2[7];
+} ring_header_t;
+
+/**
+ * @brief Ring slot, followed by n_channels * n_samples interleaved samples
+ */
+typedef struct {
+    uint32_t sequence;          ///< Buffer number, including dropped buffers.
+    uint32_t timestamp;         ///< Buffer timestamp, in us of the producer's clock.
+    uint32_t flags;             ///< AN_RING_x flags.
+    uint32_t reserved;
+} ring_slot_t;
+
+/**
+ * @brief Get the slot stride for a buffer size
+ * @param n_channels Number of channels
+ * @param n_samples Samples per channel per buffer
+ * @return Slot size in bytes, including the slot header
+ */
+size_t an_ring_slot_bytes(size_t n_channels, size_t n_samples);
+
+/**
+ * @brief Initialize a ring in shared memory, from the producer side
+ *
+ * Uses as many slots as fit in the memory, rounded down to a power of two.
+ * The magic is written last, so a consumer never attaches to a ring that is
+ * only partly set up.
+ *
+ * @param mem Shared memory, aligned to AN_RING_LINE
+ * @param mem_bytes Size of the shared memory
+ * @param n_channels Number of channels
+ * @param n_samples Samples per channel per buffer
+ * @param sample_rate Sample rate in Hz
+ * @return Ring header, or nullptr if fewer than 2 slots fit or mem isn't aligned
+ */
+ring_header_t *an_ring_init(void *mem, size_t mem_bytes, size_t n_channels, size_t n_samples, float sample_rate);
+
+/**
+ * @brief Attach to a ring initialized by the producer, from the consumer side
+ * @param mem Shared memory, aligned to AN_RING_LINE
+ * @param mem_bytes Size of the shared memory
+ * @return Ring header, or nullptr if no valid ring is there (yet)
+ */
+ring_header_t *an_ring_attach(void *mem, size_t mem_bytes);
+
+/**
+ * @brief Get the next free slot, from the producer side
+ *
+ * If the ring is full, the buffer is counted as dropped and the next slot
+ * returned is flagged AN_RING_DISCONT.
+ *
+ * @param ring Ring header
+ * @return Slot to fill, or nullptr if the ring is full
+ */
+ring_slot_t *an_ring_reserve(ring_header_t *ring);
+
+/**
+ * @brief Publish the slot returned by an_ring_reserve(), from the producer side
+ * @param ring Ring header
+ */
+void an_ring_publish(ring_header_t *ring);
+
+/**
+ * @brief Get the oldest published slot, from the consumer side
+ * @param ring Ring header
+ * @return Slot to read, or nullptr if the ring is empty
+ */
+const ring_slot_t *an_ring_peek(ring_header_t *ring);
+
+/**
+ * @brief Release the slot returned by an_ring_peek(), from the consumer side
+ * @param ring Ring header
+ */
+void an_ring_consume(ring_header_t *ring);
+
+/**
+ * @brief Get the number of buffers the producer dropped, from the consumer side
+ * @param ring Ring header
+ * @return Buffers dropped as of the last publish
+ */
+uint32_t an_ring_dropped(ring_header_t *ring);
+
+/**
+ * @brief Get the samples of a slot
+ */
+static inline uint16_t *an_ring_samples(ring_slot_t *slot) {
+    return (uint16_t *)(slot + 1);
+}
+
+static inline const uint16_t *an_ring_samples(const ring_slot_t *slot) {
+    return (const uint16_t *)(slot + 1);
+}
+
+#endif // __ADVANCED_RING_H__
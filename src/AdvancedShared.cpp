@@ -0,0 +1,149 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedShared.h"
+
+AdvancedSharedWriter::AdvancedSharedWriter(void *mem, size_t mem_bytes) :
+    mem(mem), mem_bytes(mem_bytes), ring(nullptr), n_written(0) {
+}
+
+bool AdvancedSharedWriter::begin(AdvancedADC &adc, size_t n_samples) {
+    return begin(adc.channels(), n_samples, adc.rate());
+}
+
+bool AdvancedSharedWriter::begin(size_t n_channels, size_t n_samples, float sample_rate) {
+    if (n_channels == 0 || n_channels > AN_MAX_ADC_CHANNELS) {
+        return false;
+    }
+    ring = an_ring_init(mem, mem_bytes, n_channels, n_samples, sample_rate);
+    n_written = 0;
+    return ring != nullptr;
+}
+
+bool AdvancedSharedWriter::write(SampleBuffer buf) {
+    if (ring == nullptr || !buf || buf.size() != ring->n_channels * ring->n_samples) {
+        return false;
+    }
+    ring_slot_t *slot = an_ring_reserve(ring);
+    if (slot == nullptr) {
+        return false;
+    }
+    memcpy(an_ring_samples(slot), buf.data(), buf.bytes());
+    slot->timestamp = buf.timestamp();
+    if (buf.get_flags(DMA_BUFFER_DISCONT)) {
+        slot->flags |= AN_RING_DISCONT;
+    }
+    an_ring_publish(ring);
+    n_written++;
+    return true;
+}
+
+AdvancedSharedADC::AdvancedSharedADC(void *mem, size_t mem_bytes) :
+    mem(mem), mem_bytes(mem_bytes), ring(nullptr), pool(nullptr), n_buffers(0), n_read(0) {
+}
+
+AdvancedSharedADC::~AdvancedSharedADC() {
+    end();
+}
+
+bool AdvancedSharedADC::attach() {
+    if (ring != nullptr) {
+        return true;
+    }
+    if (n_buffers == 0 || (ring = an_ring_attach(mem, mem_bytes)) == nullptr) {
+        return false;
+    }
+    // The pool matches the producer's buffers, so slots copy straight across.
+    pool = new DMAPool<Sample>(ring->n_samples, ring->n_channels, n_buffers);
+    if (pool == nullptr) {
+        ring = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool AdvancedSharedADC::begin(size_t n_buffers, uint32_t timeout_ms) {
+    if (ring != nullptr || n_buffers == 0) {
+        return false;
+    }
+    this->n_buffers = n_buffers;
+    n_read = 0;
+    uint32_t t_start = millis();
+    while (!attach()) {
+        if (timeout_ms == 0) {
+            // Keep trying in available().
+            return true;
+        }
+        if (millis() - t_start >= timeout_ms) {
+            return false;
+        }
+        delay(1);
+    }
+    return true;
+}
+
+bool AdvancedSharedADC::available() {
+    if (!attach()) {
+        return false;
+    }
+    // Move published slots into local buffers, as long as the application has returned some.
+    while (pool->writable()) {
+        const ring_slot_t *slot = an_ring_peek(ring);
+        if (slot == nullptr) {
+            break;
+        }
+        DMABuffer<Sample> *buf = pool->alloc(DMA_BUFFER_WRITE);
+        memcpy(buf->data(), an_ring_samples(slot), buf->bytes());
+        // Same timestamps and flags as the ADC's DMA callback.
+        buf->timestamp(slot->timestamp);
+        buf->clr_flags(DMA_BUFFER_DISCONT | DMA_BUFFER_INTRLVD);
+        if (ring->n_channels > 1) {
+            buf->set_flags(DMA_BUFFER_INTRLVD);
+        }
+        if (slot->flags & AN_RING_DISCONT) {
+            buf->set_flags(DMA_BUFFER_DISCONT);
+        }
+        an_ring_consume(ring);
+        buf->release();
+        n_read++;
+    }
+    return pool->readable();
+}
+
+SampleBuffer AdvancedSharedADC::read() {
+    static DMABuffer<Sample> NULLBUF;
+    if (n_buffers != 0) {
+        while (!available()) {
+            yield();
+        }
+        return *pool->alloc(DMA_BUFFER_READ);
+    }
+    return NULLBUF;
+}
+
+uint32_t AdvancedSharedADC::dropped() const {
+    return ring ? an_ring_dropped(ring) : 0;
+}
+
+void AdvancedSharedADC::end() {
+    delete pool;
+    pool = nullptr;
+    ring = nullptr;
+    n_buffers = 0;
+}
@@ -0,0 +1,188 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_SHARED_H__
+#define __ADVANCED_SHARED_H__
+
+#include "AdvancedADC.h"
+#include "AdvancedRing.h"
+
+// Default shared memory: the upper half of SRAM4 (D3 domain), which both cores
+// can access. The lower half is left to RPC. Define both before including this
+// header to use another region; it must be the same on both cores.
+#ifndef AN_SHARED_MEM
+#define AN_SHARED_MEM       ((void *)0x38008000UL)
+#endif
+#ifndef AN_SHARED_MEM_SIZE
+#define AN_SHARED_MEM_SIZE  (0x8000UL)
+#endif
+
+/**
+ * @brief Publishes sample buffers to the other core
+ *
+ * Runs on the core that owns the ADC, normally the M4. write() copies a
+ * sample buffer into the next free slot of a lock-free ring in shared memory
+ * (see AdvancedRing.h) and returns; if the other core falls behind and the
+ * ring is full, the buffer is dropped and counted, and the next one is
+ * flagged as discontinuous.
+ */
+class AdvancedSharedWriter {
+  private:
+    void *mem;
+    size_t mem_bytes;
+    ring_header_t *ring;
+    uint32_t n_written;
+
+  public:
+    /**
+     * @brief Constructor for AdvancedSharedWriter
+     * @param mem Shared memory, aligned to 32 bytes (default: AN_SHARED_MEM)
+     * @param mem_bytes Size of the shared memory (default: AN_SHARED_MEM_SIZE)
+     */
+    AdvancedSharedWriter(void *mem = AN_SHARED_MEM, size_t mem_bytes = AN_SHARED_MEM_SIZE);
+
+    /**
+     * @brief Set up the ring for the buffers of a running ADC
+     * @param adc ADC the buffers come from, for the channel count and rate
+     * @param n_samples Number of samples per buffer per channel, as passed to adc.begin()
+     * @return true on success, false if not even 2 buffers fit in the shared memory
+     */
+    bool begin(AdvancedADC &adc, size_t n_samples);
+
+    /**
+     * @brief Set up the ring
+     * @param n_channels Number of channels
+     * @param n_samples Number of samples per buffer per channel
+     * @param sample_rate Sample rate in Hz
+     * @return true on success, false if not even 2 buffers fit in the shared memory
+     */
+    bool begin(size_t n_channels, size_t n_samples, float sample_rate);
+
+    /**
+     * @brief Copy a sample buffer to the ring
+     * @param buf Sample buffer, can be released as soon as this returns
+     * @return true if published, false if the buffer was dropped or doesn't match the ring
+     */
+    bool write(SampleBuffer buf);
+
+    /**
+     * @brief Get the number of buffers published
+     */
+    uint32_t written() const {
+        return n_written;
+    }
+
+    /**
+     * @brief Get the number of buffers dropped because the ring was full
+     */
+    uint32_t dropped() const {
+        return ring ? ring->dropped : 0;
+    }
+};
+
+/**
+ * @brief Reads sample buffers published by the other core
+ *
+ * Runs on the application core, normally the M7, and behaves like an
+ * AdvancedADC: available() moves published buffers from the shared ring into
+ * a local pool, and read() returns them as regular SampleBuffers, with the
+ * producer's timestamps and discontinuity flags. Nothing here touches the
+ * ADC, so its interrupts and DMA stay on the other core.
+ */
+class AdvancedSharedADC {
+  private:
+    void *mem;
+    size_t mem_bytes;
+    ring_header_t *ring;
+    DMAPool<Sample> *pool;
+    size_t n_buffers;
+    uint32_t n_read;
+
+    bool attach();
+
+  public:
+    /**
+     * @brief Constructor for AdvancedSharedADC
+     * @param mem Shared memory, aligned to 32 bytes (default: AN_SHARED_MEM)
+     * @param mem_bytes Size of the shared memory (default: AN_SHARED_MEM_SIZE)
+     */
+    AdvancedSharedADC(void *mem = AN_SHARED_MEM, size_t mem_bytes = AN_SHARED_MEM_SIZE);
+
+    /**
+     * @brief Destructor for AdvancedSharedADC
+     */
+    ~AdvancedSharedADC();
+
+    /**
+     * @brief Attach to the ring set up by the other core
+     *
+     * If the other core hasn't set up the ring yet, this waits up to
+     * timeout_ms; with a timeout of 0, available() keeps trying to attach.
+     *
+     * @param n_buffers Number of buffers in the local pool (default: 8)
+     * @param timeout_ms Time to wait for the ring, in ms (default: 1000)
+     * @return true if attached, or if waiting in available() with a 0 timeout
+     */
+    bool begin(size_t n_buffers = 8, uint32_t timeout_ms = 1000);
+
+    /**
+     * @brief Check if a sample buffer is available
+     */
+    bool available();
+
+    /**
+     * @brief Read a sample buffer
+     *
+     * Waits for a buffer if none is available.
+     */
+    SampleBuffer read();
+
+    /**
+     * @brief Detach from the ring and free the local pool
+     */
+    void end();
+
+    /**
+     * @brief Get the number of channels, or 0 if not attached yet
+     */
+    size_t channels() const {
+        return ring ? ring->n_channels : 0;
+    }
+
+    /**
+     * @brief Get the producer's sample rate, or 0 if not attached yet
+     */
+    float rate() const {
+        return ring ? ring->sample_rate : 0.0f;
+    }
+
+    /**
+     * @brief Get the number of buffers read from the ring
+     */
+    uint32_t received() const {
+        return n_read;
+    }
+
+    /**
+     * @brief Get the number of buffers the producer dropped because the ring was full
+     */
+    uint32_t dropped() const;
+};
+
+#endif // __ADVANCED_SHARED_H__
@@ -0,0 +1,189 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedStream.h"
+#include "AdvancedPack.h"
+#include "AdvancedCodec.h"
+#include "mbed.h"
+
+#define TX_FLAG     (1U << 0)
+
+AdvancedStream::AdvancedStream(Print &port, size_t queue_bytes) :
+    port(port), queue(nullptr), q_size(1024), q_head(0), q_tail(0), scratch(nullptr), scratch_size(0),
+    running(false), thread(nullptr), events(nullptr), res(0), enc(AN_FRAME_RAW), period(0.0f), seq(0), n_sent(0), n_dropped(0), discont(false) {
+    // Power of two, so the free-running indices wrap cleanly.
+    while (q_size < queue_bytes) {
+        q_size <<= 1;
+    }
+}
+
+AdvancedStream::~AdvancedStream() {
+    end();
+}
+
+bool AdvancedStream::begin(uint32_t resolution, uint32_t sample_rate, uint32_t encoding, int priority,
+                           size_t stack_size) {
+    if (running || sample_rate == 0 || resolution > AN_RESOLUTION_16 || encoding > AN_FRAME_RICE) {
+        return false;
+    }
+
+    if (queue == nullptr) {
+        queue = new uint8_t[q_size];
+        events = new rtos::EventFlags();
+        if (queue == nullptr || events == nullptr) {
+            end();
+            return false;
+        }
+    }
+
+    res = resolution;
+    enc = encoding;
+    period = 1e6f / sample_rate;
+    q_head = q_tail = 0;
+    running = true;
+
+    thread = new rtos::Thread((osPriority)priority, stack_size, nullptr, "an_stream");
+    if (thread == nullptr || thread->start(mbed::callback(this, &AdvancedStream::tx_loop)) != osOK) {
+        running = false;
+        delete thread;
+        thread = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void AdvancedStream::end() {
+    if (thread) {
+        running = false;
+        events->set(TX_FLAG);
+        thread->join();
+        delete thread;
+        thread = nullptr;
+    }
+    delete[] queue;
+    queue = nullptr;
+    delete events;
+    events = nullptr;
+    delete[] scratch;
+    scratch = nullptr;
+    scratch_size = 0;
+}
+
+void AdvancedStream::push(const void *data, size_t len) {
+    // Caller checked there's room; copy in up to two pieces around the wrap.
+    const uint8_t *src = (const uint8_t *)data;
+    size_t off = q_head & (q_size - 1);
+    size_t first = (len < q_size - off) ? len : q_size - off;
+    memcpy(&queue[off], src, first);
+    memcpy(&queue[0], src + first, len - first);
+    __DMB();
+    q_head += len;
+}
+
+bool AdvancedStream::write(SampleBuffer buf, int adc_id) {
+    if (!running || !buf || buf.channels() > AN_FRAME_MAX_CHANNELS || buf.size() > AN_FRAME_MAX_SAMPLES) {
+        return false;
+    }
+
+    frame_header_t hdr;
+    hdr.sync[0] = AN_FRAME_SYNC0;
+    hdr.sync[1] = AN_FRAME_SYNC1;
+    hdr.version = AN_FRAME_VERSION;
+    hdr.adc_id = adc_id;
+    hdr.channels = buf.channels();
+    hdr.resolution = res;
+    hdr.encoding = enc;
+    hdr.flags = 0;
+    hdr.sequence = seq++;
+    // The buffer timestamp is taken when its last frame completes.
+    size_t n_frames = buf.size() / buf.channels();
+    hdr.timestamp = buf.timestamp() - (uint32_t)((n_frames - 1) * period + 0.5f);
+    hdr.n_samples = buf.size();
+    if (enc == AN_FRAME_RICE) {
+        // Compressed frames vary in size, so encode them up front.
+        size_t max_bytes = an_codec_max_bytes(hdr.channels, n_frames);
+        if (scratch_size < max_bytes) {
+            delete[] scratch;
+            scratch = new uint8_t[max_bytes];
+            scratch_size = (scratch != nullptr) ? max_bytes : 0;
+            if (scratch == nullptr) {
+                return false;
+            }
+        }
+        hdr.payload_bytes = an_encode(buf.data(), hdr.channels, n_frames, scratch);
+    } else if (enc == AN_FRAME_PACKED) {
+        hdr.payload_bytes = an_packed_bytes(res, buf.size());
+    } else {
+        hdr.payload_bytes = buf.bytes();
+    }
+
+    size_t frame_bytes = AN_FRAME_HEADER_SIZE + hdr.payload_bytes + AN_FRAME_TRAILER_SIZE;
+    if (buf.get_flags(DMA_BUFFER_DISCONT) || discont) {
+        hdr.flags |= AN_FRAME_DISCONT;
+    }
+
+    if (q_size - (q_head - q_tail) < frame_bytes) {
+        // Drop the frame, the next one sent is flagged as discontinuous.
+        n_dropped++;
+        discont = true;
+        return false;
+    }
+    discont = false;
+
+    uint32_t crc = an_crc32(0, &hdr, sizeof(hdr));
+    push(&hdr, sizeof(hdr));
+    if (enc == AN_FRAME_PACKED) {
+        // Pack in small chunks; a multiple of 4 samples keeps every chunk byte aligned.
+        uint8_t chunk[AN_STREAM_PACK_CHUNK * 2];
+        for (size_t i = 0; i < buf.size(); i += AN_STREAM_PACK_CHUNK) {
+            size_t n = buf.size() - i;
+            n = (n < AN_STREAM_PACK_CHUNK) ? n : AN_STREAM_PACK_CHUNK;
+            size_t len = an_pack(res, buf.data() + i, n, chunk);
+            crc = an_crc32(crc, chunk, len);
+            push(chunk, len);
+        }
+    } else if (enc == AN_FRAME_RICE) {
+        crc = an_crc32(crc, scratch, hdr.payload_bytes);
+        push(scratch, hdr.payload_bytes);
+    } else {
+        crc = an_crc32(crc, buf.data(), hdr.payload_bytes);
+        push(buf.data(), hdr.payload_bytes);
+    }
+    push(&crc, sizeof(crc));
+    n_sent++;
+    events->set(TX_FLAG);
+    return true;
+}
+
+void AdvancedStream::tx_loop() {
+    while (running) {
+        size_t avail = q_head - q_tail;
+        if (avail == 0) {
+            // Nothing queued, sleep until write() queues the next frame.
+            events->wait_any(TX_FLAG);
+            continue;
+        }
+        // Write the contiguous part; the port blocks this thread, not the caller.
+        size_t off = q_tail & (q_size - 1);
+        size_t len = (avail < q_size - off) ? avail : q_size - off;
+        len = port.write(&queue[off], len);
+        __DMB();
+        q_tail += len;
+    }
+}
@@ -0,0 +1,132 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_STREAM_H__
+#define __ADVANCED_STREAM_H__
+
+#include "AdvancedAnalog.h"
+#include "AdvancedFrame.h"
+
+#define AN_STREAM_PACK_CHUNK    (128)   // Samples packed per step, a multiple of 4.
+
+namespace rtos {
+class Thread;
+class EventFlags;
+}
+
+/**
+ * @brief Binary framed streaming sink
+ *
+ * Sends whole sample buffers as binary frames (see AdvancedFrame.h) over any
+ * Print port, e.g. the USB CDC Serial. write() encodes the frame into a byte
+ * queue and returns right away, so the caller can release the buffer at once;
+ * a transmit thread drains the queue into the port. If the port can't keep
+ * up and the queue is full, the frame is dropped and counted, and its sequence
+ * number is skipped, so acquisition never stalls on the port and the receiver
+ * can tell how many frames were lost.
+ */
+class AdvancedStream {
+  private:
+    Print &port;
+    uint8_t *queue;
+    size_t q_size;
+    volatile size_t q_head;
+    volatile size_t q_tail;
+    uint8_t *scratch;
+    size_t scratch_size;
+    volatile bool running;
+    rtos::Thread *thread;
+    rtos::EventFlags *events;
+    uint32_t res;
+    uint32_t enc;
+    float period;
+    uint32_t seq;
+    uint32_t n_sent;
+    uint32_t n_dropped;
+    bool discont;
+
+    void push(const void *data, size_t len);
+    void tx_loop();
+
+  public:
+    /**
+     * @brief Constructor for AdvancedStream
+     * @param port Output port, e.g. Serial
+     * @param queue_bytes Size of the transmit queue, rounded up to a power of two (default: 16384)
+     */
+    AdvancedStream(Print &port, size_t queue_bytes = 16384);
+
+    /**
+     * @brief Destructor for AdvancedStream
+     *
+     * Stops the transmit thread and frees the queue.
+     */
+    ~AdvancedStream();
+
+    /**
+     * @brief Start the transmit thread
+     * @param resolution ADC resolution, recorded in every frame
+     * @param sample_rate Sample rate in Hz, used to timestamp the first sample
+     * @param encoding Payload encoding, AN_FRAME_RAW, AN_FRAME_PACKED or AN_FRAME_RICE (default: AN_FRAME_RAW)
+     * @param priority Transmit thread priority, as osPriority (default: osPriorityBelowNormal)
+     * @param stack_size Transmit thread stack size in bytes (default: 4096)
+     * @return true on success, false on error
+     */
+    bool begin(uint32_t resolution, uint32_t sample_rate, uint32_t encoding = AN_FRAME_RAW, int priority = 16,
+               size_t stack_size = 4096);
+
+    /**
+     * @brief Queue a sample buffer for transmission
+     * @param buf Sample buffer, can be released as soon as this returns
+     * @param adc_id ADC instance the buffer came from (1-3), for the frame header
+     * @return true if queued, false if the frame was dropped, or the buffer has
+     * more than AN_FRAME_MAX_CHANNELS channels or AN_FRAME_MAX_SAMPLES samples
+     */
+    bool write(SampleBuffer buf, int adc_id = 0);
+
+    /**
+     * @brief Stop the transmit thread
+     *
+     * Frames still in the queue are discarded.
+     */
+    void end();
+
+    /**
+     * @brief Get the number of bytes waiting in the queue
+     */
+    size_t pending() const {
+        return q_head - q_tail;
+    }
+
+    /**
+     * @brief Get the number of frames queued
+     */
+    uint32_t sent() const {
+        return n_sent;
+    }
+
+    /**
+     * @brief Get the number of frames dropped because the queue was full
+     */
+    uint32_t dropped() const {
+        return n_dropped;
+    }
+};
+
+#endif // __ADVANCED_STREAM_H__
@@ -0,0 +1,170 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedWAV.h"
+#if defined(ARDUINO)
+#include "AdvancedADC.h"
+#endif
+
+#define WAV_HEADER_PCM          (44)
+#define WAV_HEADER_EXTENSIBLE   (68)
+
+void an_pcm16(const Sample *in, size_t n, uint32_t resolution, int16_t *out) {
+    // Left-justify and flip the sign bit, two samples per 32-bit word. Codes
+    // are masked to the resolution first, so a stray high bit can't spill
+    // into the other half and both paths give the same result.
+    uint32_t shift = 16 - (8 + 2 * resolution);
+    uint32_t mask = (1UL << (16 - shift)) - 1;
+    uint32_t mask2 = mask | (mask << 16);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint32_t w[4];
+        memcpy(w, &in[i], sizeof(w));
+        w[0] = ((w[0] & mask2) << shift) ^ 0x80008000UL;
+        w[1] = ((w[1] & mask2) << shift) ^ 0x80008000UL;
+        w[2] = ((w[2] & mask2) << shift) ^ 0x80008000UL;
+        w[3] = ((w[3] & mask2) << shift) ^ 0x80008000UL;
+        memcpy(&out[i], w, sizeof(w));
+    }
+    for (; i < n; i++) {
+        out[i] = (int16_t)(((in[i] & mask) << shift) ^ 0x8000);
+    }
+}
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    put16(p, v);
+    put16(p + 2, v >> 16);
+}
+
+AdvancedWAV::AdvancedWAV() : file(nullptr), block(nullptr), n_channels(0), res(0), data_bytes(0), failed(false) {
+}
+
+AdvancedWAV::~AdvancedWAV() {
+    end();
+}
+
+#if defined(ARDUINO)
+bool AdvancedWAV::begin(const char *path, AdvancedADC &adc, uint32_t resolution, uint32_t sample_rate) {
+    return begin(path, adc.channels(), resolution, (adc.rate() > 0.0f) ? adc.rate() : sample_rate);
+}
+#endif
+
+bool AdvancedWAV::begin(const char *path, size_t n_channels, uint32_t resolution, float sample_rate) {
+    if (file || n_channels == 0 || n_channels > AN_MAX_ADC_CHANNELS || resolution > AN_RESOLUTION_16
+            || sample_rate < 1.0f) {
+        return false;
+    }
+
+    // WAV only stores an integer rate.
+    uint32_t rate = (uint32_t)(sample_rate + 0.5f);
+    uint32_t align = n_channels * sizeof(int16_t);
+    bool extensible = n_channels > 2;
+    uint8_t hdr[WAV_HEADER_EXTENSIBLE] = { 0 };
+    uint8_t *p = hdr;
+    memcpy(p, "RIFF", 4);
+    memcpy(p + 8, "WAVE", 4);
+    memcpy(p + 12, "fmt ", 4);
+    put32(p + 16, extensible ? 40 : 16);
+    put16(p + 20, extensible ? 0xFFFE : 1);     // WAVE_FORMAT_EXTENSIBLE or PCM.
+    put16(p + 22, n_channels);
+    put32(p + 24, rate);
+    put32(p + 28, rate * align);
+    put16(p + 32, align);
+    put16(p + 34, 16);
+    p += 36;
+    if (extensible) {
+        put16(p, 22);
+        put16(p + 2, 8 + 2 * resolution);       // Valid bits.
+        put32(p + 4, 0);                        // No speaker positions.
+        // KSDATAFORMAT_SUBTYPE_PCM.
+        static const uint8_t pcm_guid[16] = {
+            0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+        };
+        memcpy(p + 8, pcm_guid, 16);
+        p += 24;
+    }
+    memcpy(p, "data", 4);
+    size_t hdr_size = (p + 8) - hdr;
+
+    this->n_channels = n_channels;
+    res = resolution;
+    data_bytes = 0;
+    failed = false;
+    block = new int16_t[AN_WAV_BLOCK];
+    file = fopen(path, "wb");
+    if (block == nullptr || file == nullptr || fwrite(hdr, 1, hdr_size, file) != hdr_size) {
+        failed = true;
+        end();
+        return false;
+    }
+    return true;
+}
+
+bool AdvancedWAV::write(const Sample *in, size_t n_frames) {
+    if (file == nullptr || failed) {
+        return false;
+    }
+    size_t n = n_frames * n_channels;
+    if (n * sizeof(int16_t) > 0xFFFFFFF0UL - WAV_HEADER_EXTENSIBLE - data_bytes) {
+        // RIFF sizes are 32-bit.
+        return false;
+    }
+    for (size_t i = 0; i < n; i += AN_WAV_BLOCK) {
+        size_t len = (n - i < AN_WAV_BLOCK) ? n - i : AN_WAV_BLOCK;
+        an_pcm16(in + i, len, res, block);
+        // Both the M7 and x86 are little-endian, like WAV.
+        if (fwrite(block, sizeof(int16_t), len, file) != len) {
+            failed = true;
+            return false;
+        }
+        data_bytes += len * sizeof(int16_t);
+    }
+    return true;
+}
+
+bool AdvancedWAV::write(SampleBuffer buf) {
+    if (!buf || buf.channels() != n_channels) {
+        return false;
+    }
+    return write(buf.data(), buf.size() / n_channels);
+}
+
+bool AdvancedWAV::end() {
+    bool ok = false;
+    if (file) {
+        // Patch the RIFF and data chunk sizes.
+        uint8_t size[4];
+        uint32_t hdr_size = (n_channels > 2) ? WAV_HEADER_EXTENSIBLE : WAV_HEADER_PCM;
+        ok = !failed;
+        put32(size, hdr_size - 8 + data_bytes);
+        ok = ok && fseek(file, 4, SEEK_SET) == 0 && fwrite(size, 1, 4, file) == 4;
+        put32(size, data_bytes);
+        ok = ok && fseek(file, hdr_size - 4, SEEK_SET) == 0 && fwrite(size, 1, 4, file) == 4;
+        ok = (fclose(file) == 0) && ok;
+        file = nullptr;
+    }
+    delete[] block;
+    block = nullptr;
+    return ok;
+}
@@ -0,0 +1,124 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_WAV_H__
+#define __ADVANCED_WAV_H__
+
+#include <stdio.h>
+#include "AdvancedAnalog.h"
+
+class AdvancedADC;
+
+#define AN_WAV_BLOCK            (1024)  // Samples converted per write.
+
+/**
+ * @brief Streaming WAV file writer
+ *
+ * Writes sample buffers to a WAV file as interleaved 16-bit signed PCM,
+ * one WAV channel per ADC channel, at the achieved sample rate. Codes are
+ * left-justified, so full scale maps to full scale at any resolution, and
+ * files with more than 2 channels use WAVE_FORMAT_EXTENSIBLE to record the
+ * valid bits. The sizes in the header are filled in by end().
+ *
+ * Writes go straight to the file system, in the caller's thread; for slow
+ * storage, log with AdvancedLogger instead and convert on the host.
+ */
+class AdvancedWAV {
+  private:
+    FILE *file;
+    int16_t *block;
+    size_t n_channels;
+    uint32_t res;
+    uint32_t data_bytes;
+    bool failed;
+
+  public:
+    /**
+     * @brief Constructor for AdvancedWAV
+     */
+    AdvancedWAV();
+
+    /**
+     * @brief Destructor for AdvancedWAV
+     *
+     * Closes the file if still open.
+     */
+    ~AdvancedWAV();
+
+    /**
+     * @brief Create a WAV file for the buffers of an ADC
+     * @param path File path
+     * @param adc ADC the buffers come from, for the channel count and achieved rate
+     * @param resolution ADC resolution
+     * @param sample_rate Sample rate in Hz, only used if the ADC isn't running yet
+     * @return true on success, false on error
+     *
+     * Only available on the target; host builds use the overload below.
+     */
+    bool begin(const char *path, AdvancedADC &adc, uint32_t resolution, uint32_t sample_rate);
+
+    /**
+     * @brief Create a WAV file
+     * @param path File path
+     * @param n_channels Number of interleaved channels
+     * @param resolution Sample resolution
+     * @param sample_rate Sample rate in Hz
+     * @return true on success, false on error
+     */
+    bool begin(const char *path, size_t n_channels, uint32_t resolution, float sample_rate);
+
+    /**
+     * @brief Append interleaved samples
+     * @param in Interleaved samples
+     * @param n_frames Number of frames
+     * @return true on success, false on a storage error or when the file is full (4 GiB)
+     */
+    bool write(const Sample *in, size_t n_frames);
+
+    /**
+     * @brief Append a sample buffer
+     * @param buf Sample buffer
+     * @return true on success, false on error
+     */
+    bool write(SampleBuffer buf);
+
+    /**
+     * @brief Fill in the header sizes and close the file
+     * @return true if everything was written, false on a storage error
+     */
+    bool end();
+
+    /**
+     * @brief Get the number of frames written
+     */
+    uint32_t frames() const {
+        return n_channels ? data_bytes / (n_channels * sizeof(int16_t)) : 0;
+    }
+};
+
+/**
+ * @brief Convert ADC codes to 16-bit signed PCM
+ * @param in ADC codes (offset binary), masked to the resolution
+ * @param n Number of samples
+ * @param resolution Resolution of the codes
+ * @param out Output samples, may be the same buffer as in
+ */
+void an_pcm16(const Sample *in, size_t n, uint32_t resolution, int16_t *out);
+
+#endif // __ADVANCED_WAV_H__
@@ -0,0 +1,196 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AdvancedWork.h"
+#include "mbed.h"
+
+#define WORK_FLAG   (1U << 0)
+
+AdvancedWorkQueue::AdvancedWorkQueue(size_t capacity) :
+    jobs(nullptr), capacity(2), head(0), tail(0), running(false), thread(nullptr), events(nullptr),
+    n_posted(0), n_run(0), n_dropped(0), n_missed(0), max_delay(0), sum_delay(0), deadline_us(0) {
+    // Power of two, so the free-running indices wrap cleanly.
+    while (this->capacity < capacity) {
+        this->capacity <<= 1;
+    }
+    for (size_t i = 0; i < AN_WORK_MAX_SOURCES; i++) {
+        sources[i].adc = nullptr;
+    }
+}
+
+AdvancedWorkQueue::~AdvancedWorkQueue() {
+    end();
+}
+
+bool AdvancedWorkQueue::begin(int priority, size_t stack_size) {
+    if (running) {
+        return false;
+    }
+    if (jobs == nullptr) {
+        jobs = new job_t[capacity];
+        events = new rtos::EventFlags();
+        if (jobs == nullptr || events == nullptr) {
+            end();
+            return false;
+        }
+    }
+    // Each slot's sequence says whose turn it is: head == seq to fill it, tail + 1 == seq to run it.
+    for (size_t i = 0; i < capacity; i++) {
+        jobs[i].seq = i;
+    }
+    head = tail = 0;
+    reset();
+    running = true;
+
+    thread = new rtos::Thread((osPriority)priority, stack_size, nullptr, "an_work");
+    if (thread == nullptr || thread->start(mbed::callback(this, &AdvancedWorkQueue::loop)) != osOK) {
+        running = false;
+        delete thread;
+        thread = nullptr;
+        end();
+        return false;
+    }
+    return true;
+}
+
+void AdvancedWorkQueue::end() {
+    for (size_t i = 0; i < AN_WORK_MAX_SOURCES; i++) {
+        if (sources[i].adc) {
+            detach(*sources[i].adc);
+        }
+    }
+    if (thread) {
+        running = false;
+        events->set(WORK_FLAG);
+        thread->join();
+        delete thread;
+        thread = nullptr;
+    }
+    delete[] jobs;
+    jobs = nullptr;
+    delete events;
+    events = nullptr;
+}
+
+void AdvancedWorkQueue::reset() {
+    n_posted = n_run = n_dropped = n_missed = 0;
+    max_delay = 0;
+    sum_delay = 0;
+}
+
+bool AdvancedWorkQueue::post(work_fn_t fn, void *arg) {
+    if (!running || fn == nullptr) {
+        return false;
+    }
+    // Claim a slot with a compare-and-swap on the head, so interrupts of any
+    // priority can post concurrently without locks.
+    uint32_t pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    job_t *job;
+    for (;;) {
+        job = &jobs[pos & (capacity - 1)];
+        int32_t diff = (int32_t)(__atomic_load_n(&job->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // The worker hasn't run the job a full lap ago yet.
+            __atomic_fetch_add(&n_dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        } else {
+            pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+        }
+    }
+    job->fn = fn;
+    job->arg = arg;
+    job->t_post = us_ticker_read();
+    __atomic_store_n(&job->seq, pos + 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&n_posted, 1, __ATOMIC_RELAXED);
+    events->set(WORK_FLAG);
+    return true;
+}
+
+void AdvancedWorkQueue::loop() {
+    while (running) {
+        job_t *job = &jobs[tail & (capacity - 1)];
+        if (__atomic_load_n(&job->seq, __ATOMIC_ACQUIRE) != tail + 1) {
+            // Empty, or the next job is still being written by an interrupt that was preempted.
+            events->wait_any(WORK_FLAG);
+            continue;
+        }
+        work_fn_t fn = job->fn;
+        void *arg = job->arg;
+        uint32_t delay = us_ticker_read() - job->t_post;
+        // Hand the slot back for the next lap before running the job.
+        __atomic_store_n(&job->seq, tail + capacity, __ATOMIC_RELEASE);
+        tail++;
+
+        max_delay = (delay > max_delay) ? delay : max_delay;
+        sum_delay += delay;
+        n_run++;
+        if (deadline_us && delay > deadline_us) {
+            n_missed++;
+        }
+        fn(arg);
+    }
+}
+
+void AdvancedWorkQueue::post_buffer(void *source) {
+    // Runs in the DMA interrupt.
+    source_t *src = (source_t *)source;
+    src->queue->post(&AdvancedWorkQueue::run_buffer, src);
+}
+
+void AdvancedWorkQueue::run_buffer(void *source) {
+    source_t *src = (source_t *)source;
+    AdvancedADC *adc = src->adc;
+    // Drain the queue: if a post was dropped because the ring was full, its
+    // buffer is handled by the next job instead of stalling the ADC's pool.
+    while (adc && adc->available()) {
+        SampleBuffer buf = adc->read();
+        src->fn(buf, src->arg);
+        buf.release();
+    }
+}
+
+bool AdvancedWorkQueue::attach(AdvancedADC &adc, pipeline_fn_t fn, void *arg) {
+    if (fn == nullptr) {
+        return false;
+    }
+    for (size_t i = 0; i < AN_WORK_MAX_SOURCES; i++) {
+        if (sources[i].adc == nullptr) {
+            sources[i].queue = this;
+            sources[i].fn = fn;
+            sources[i].arg = arg;
+            sources[i].adc = &adc;
+            adc.onReady(&AdvancedWorkQueue::post_buffer, &sources[i]);
+            return true;
+        }
+    }
+    return false;
+}
+
+void AdvancedWorkQueue::detach(AdvancedADC &adc) {
+    for (size_t i = 0; i < AN_WORK_MAX_SOURCES; i++) {
+        if (sources[i].adc == &adc) {
+            adc.onReady(nullptr);
+            sources[i].adc = nullptr;
+        }
+    }
+}
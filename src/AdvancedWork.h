@@ -0,0 +1,192 @@
+/*
+  This file is part of the GigaR1_AdvancedAnalog library.
+  Copyright (c) 2023 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ADVANCED_WORK_H__
+#define __ADVANCED_WORK_H__
+
+#include "AdvancedADC.h"
+#include "AdvancedPipeline.h"
+
+#define AN_WORK_MAX_SOURCES     (3)     // One per ADC instance.
+
+namespace rtos {
+class Thread;
+class EventFlags;
+}
+
+/**
+ * @brief Job run by AdvancedWorkQueue
+ * @param arg Argument passed to AdvancedWorkQueue::post()
+ */
+typedef void (*work_fn_t)(void *arg);
+
+/**
+ * @brief Deferred work queue, fed from interrupts and run in a thread
+ *
+ * post() is lock-free and safe to call from any interrupt handler, at any
+ * priority: it appends a job to a fixed-capacity ring and wakes the worker
+ * thread, which runs the jobs in order at thread priority, below every
+ * interrupt. attach() posts a job for every buffer an ADC completes, so
+ * per-buffer processing runs outside interrupt context without polling from
+ * loop(). The delay from post() to the start of each job is measured, to
+ * check processing deadlines.
+ */
+class AdvancedWorkQueue {
+  private:
+    typedef struct {
+        uint32_t seq;
+        work_fn_t fn;
+        void *arg;
+        uint32_t t_post;
+    } job_t;
+
+    typedef struct {
+        AdvancedWorkQueue *queue;
+        AdvancedADC *adc;
+        pipeline_fn_t fn;
+        void *arg;
+    } source_t;
+
+    job_t *jobs;
+    size_t capacity;
+    uint32_t head;
+    uint32_t tail;
+    volatile bool running;
+    rtos::Thread *thread;
+    rtos::EventFlags *events;
+    source_t sources[AN_WORK_MAX_SOURCES];
+    uint32_t n_posted;
+    uint32_t n_run;
+    uint32_t n_dropped;
+    uint32_t n_missed;
+    uint32_t max_delay;
+    uint64_t sum_delay;
+    uint32_t deadline_us;
+
+    void loop();
+    static void post_buffer(void *source);
+    static void run_buffer(void *source);
+
+  public:
+    /**
+     * @brief Constructor for AdvancedWorkQueue
+     * @param capacity Maximum number of queued jobs, rounded up to a power of two (default: 32)
+     */
+    AdvancedWorkQueue(size_t capacity = 32);
+
+    /**
+     * @brief Destructor for AdvancedWorkQueue
+     *
+     * Detaches from any ADC and stops the worker thread.
+     */
+    ~AdvancedWorkQueue();
+
+    /**
+     * @brief Start the worker thread
+     * @param priority Worker thread priority, as osPriority (default: osPriorityAboveNormal)
+     * @param stack_size Worker thread stack size in bytes (default: 4096)
+     * @return true on success, false on error
+     */
+    bool begin(int priority = 32, size_t stack_size = 4096);
+
+    /**
+     * @brief Detach from any ADC and stop the worker thread
+     *
+     * Jobs still in the queue are discarded.
+     */
+    void end();
+
+    /**
+     * @brief Queue a job, from an interrupt handler or a thread
+     * @param fn Function to run in the worker thread
+     * @param arg Argument passed to the function (default: nullptr)
+     * @return true if queued, false if the queue was full
+     */
+    bool post(work_fn_t fn, void *arg = nullptr);
+
+    /**
+     * @brief Handle every buffer an ADC completes in the worker thread
+     *
+     * Sets the ADC's ready callback to post a job per buffer; the job reads
+     * every buffer that is ready, calls the handler with each, and releases
+     * it, so buffers whose post was dropped are still handled.
+     *
+     * @param adc ADC to take buffers from
+     * @param fn Handler called for every buffer
+     * @param arg Argument passed to the handler (default: nullptr)
+     * @return true on success, false if AN_WORK_MAX_SOURCES ADCs are already attached
+     */
+    bool attach(AdvancedADC &adc, pipeline_fn_t fn, void *arg = nullptr);
+
+    /**
+     * @brief Stop handling the buffers of an ADC
+     * @param adc ADC passed to attach()
+     */
+    void detach(AdvancedADC &adc);
+
+    /**
+     * @brief Set the queueing deadline counted by missed()
+     * @param us Longest acceptable delay from post() to the start of a job, in us, or 0 for none
+     */
+    void deadline(uint32_t us) {
+        deadline_us = us;
+    }
+
+    /**
+     * @brief Get the number of jobs queued
+     */
+    uint32_t posted() const {
+        return n_posted;
+    }
+
+    /**
+     * @brief Get the number of jobs dropped because the queue was full
+     */
+    uint32_t dropped() const {
+        return n_dropped;
+    }
+
+    /**
+     * @brief Get the number of jobs that started later than the deadline
+     */
+    uint32_t missed() const {
+        return n_missed;
+    }
+
+    /**
+     * @brief Get the longest delay from post() to the start of a job, in us
+     */
+    uint32_t max_latency() const {
+        return max_delay;
+    }
+
+    /**
+     * @brief Get the average delay from post() to the start of a job, in us
+     */
+    float avg_latency() const {
+        return n_run ? (float)sum_delay / n_run : 0.0f;
+    }
+
+    /**
+     * @brief Reset the latency statistics and counters
+     */
+    void reset();
+};
+
+#endif // __ADVANCED_WORK_H__
@@ -67,6 +67,14 @@ bool hal_tim_config(TIM_HandleTypeDef *tim, uint32_t t_freq) {
     return true;
 }
 
+float hal_tim_rate(TIM_HandleTypeDef *tim) {
+    if (tim->State == HAL_TIM_STATE_RESET) {
+        return 0.0f;
+    }
+    // The integer prescaler and period rarely divide the clock exactly.
+    return (float)hal_tim_freq(tim) / ((tim->Init.Prescaler + 1) * (tim->Init.Period + 1));
+}
+
 bool hal_dma_config(DMA_HandleTypeDef *dma, IRQn_Type irqn, uint32_t direction) {
     // Enable DMA clock
     __HAL_RCC_DMA1_CLK_ENABLE();
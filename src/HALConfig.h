@@ -24,6 +24,7 @@
 #include "Arduino.h"
 
 bool hal_tim_config(TIM_HandleTypeDef *tim, uint32_t t_freq);
+float hal_tim_rate(TIM_HandleTypeDef *tim);
 bool hal_dma_config(DMA_HandleTypeDef *dma, IRQn_Type irqn, uint32_t direction);
 size_t hal_dma_get_ct(DMA_HandleTypeDef *dma);
 void hal_dma_enable_dbm(DMA_HandleTypeDef *dma, void *m0 = nullptr, void *m1 = nullptr);